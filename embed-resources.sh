@@ -5,6 +5,26 @@ SRCLOC="$( cd "$( dirname "${BASH_SOURCE[0]}" )" && pwd )"
 # overwrite existing resources
 cp -f $SRCLOC/../resources/rendering_styles/default.render.xml  $SRCLOC/embeddable-resources/
 
+# Style bitmaps are named as in OsmAnd resources: "h_<name>.png" are shaders and text shields,
+# "mm_<name>.png" are point icons. They are embedded as "map/{shaders,shields,icons}/<name>.png"
+styleIcons="$SRCLOC/../resources/rendering_styles/style-icons/drawable-mdpi"
+rm -rf $SRCLOC/embeddable-resources/map
+mkdir -p $SRCLOC/embeddable-resources/map/shaders $SRCLOC/embeddable-resources/map/shields $SRCLOC/embeddable-resources/map/icons
+for styleIcon in $styleIcons/h_*.png ; do
+	[ -f "$styleIcon" ] || continue
+	name=$(basename $styleIcon)
+	name=${name#h_}
+	case "$name" in
+		*_shield*) cp -f $styleIcon $SRCLOC/embeddable-resources/map/shields/$name ;;
+		*) cp -f $styleIcon $SRCLOC/embeddable-resources/map/shaders/$name ;;
+	esac
+done
+for styleIcon in $styleIcons/mm_*.png ; do
+	[ -f "$styleIcon" ] || continue
+	name=$(basename $styleIcon)
+	cp -f $styleIcon $SRCLOC/embeddable-resources/map/icons/${name#mm_}
+done
+
 export LC_ALL=C
 
 bundle="$SRCLOC/src/EmbeddedResources_bundle.cpp"
@@ -18,10 +38,12 @@ echo -e "#include \"EmbeddedResources_private.h\"" >&3
 echo -e "namespace OsmAnd {" >&3
 
 resourceCounter=0
-rm -f $SRCLOC/embeddable-resources/*.qz
+find "$SRCLOC/embeddable-resources" -type f -name '*.qz' -exec rm -f {} \;
 
-for resource in $SRCLOC/embeddable-resources/* ; do
-	echo -n "Packing '$(basename $resource)' "
+# Resources are looked up by path relative to embeddable-resources, e.g. "map/shaders/beach.png"
+while IFS= read -r resource ; do
+	resourceName="${resource#$SRCLOC/embeddable-resources/}"
+	echo -n "Packing '$resourceName' "
 	originalSize=`stat --printf="%s" $resource`
 	echo -n "from $originalSize "
 
@@ -30,7 +52,7 @@ for resource in $SRCLOC/embeddable-resources/* ; do
 	compressedSize=`stat --printf="%s" $zlibbedResource`
 	echo -n "to $compressedSize bytes..."
 
-	echo -e "\tconst QString __bundled_resource_name_$((resourceCounter)) = \"$(basename $resource)\";" >&3
+	echo -e "\tconst QString __bundled_resource_name_$((resourceCounter)) = \"$resourceName\";" >&3
 	echo -e "\tconst uint8_t __bundled_resource_data_$((resourceCounter))[] = {" >&3
 	echo -e -n "\t\t" >&3
 	osb=$((($originalSize&0xff000000)>>24))
@@ -66,7 +88,7 @@ for resource in $SRCLOC/embeddable-resources/* ; do
 	resourceCounter=$resourceCounter+1
 	rm -f $zlibbedResource
 	echo ""
-done
+done < <(find "$SRCLOC/embeddable-resources" -type f ! -name '.*' | sort)
 echo -e "\tOsmAnd::EmbeddedResource __bundled_resources[] = {" >&3
 for (( resourceIdx=0; resourceIdx<$((resourceCounter)); resourceIdx++ )); do
 	echo -e "\t\t{ __bundled_resource_name_$resourceIdx, __bundled_resource_size_$resourceIdx, &__bundled_resource_data_$resourceIdx[0] }," >&3
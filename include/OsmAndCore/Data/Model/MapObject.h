@@ -24,21 +24,21 @@
 #define __MODEL_MAP_OBJECT_H_
 
 #include <stdint.h>
+#include <memory>
 #include <tuple>
 
-#include <QList>
-#include <QMap>
-#include <QVector>
 #include <QString>
 #include <QHash>
 
 #include <OsmAndCore.h>
 #include <OsmAndCore/CommonTypes.h>
+#include <OsmAndCore/Data/Model/MapObjectsArena.h>
 
 namespace OsmAnd {
 
     class ObfMapSection;
     class Rasterizer;
+    class RasterizationStyleEvaluator;
 
     namespace Model {
 
@@ -51,18 +51,31 @@ namespace OsmAnd {
                 FullLand,
                 FullWater
             };
+
+            //! Tag id of TagValueDictionary and id of value in string table of the arena
+            struct Name
+            {
+                uint32_t tagId;
+                uint32_t stringId;
+            };
         private:
         protected:
-            MapObject(ObfMapSection* section);
+            MapObject(ObfMapSection* section, const MapObjectsArena* arena);
 
+            // Object, its reference counter and all its arrays are placed in arena, and arena is kept alive by the object
+            static std::shared_ptr<MapObject> create(ObfMapSection* section, const std::shared_ptr<MapObjectsArena>& arena);
+
+            const MapObjectsArena* const _arena;
             uint64_t _id;
             FoundationType _foundation;
             bool _isArea;
-            QVector< PointI > _points31;
-            QList< QVector< PointI > > _innerPolygonsPoints31;
-            QVector< TagValue > _types;
-            QVector< TagValue > _extraTypes;
-            QHash< QString, QString > _names;
+            ArenaArray< PointI > _points31;
+            // Points of all inner polygons are stored contiguously, each polygon is a view of part of them
+            ArenaArray< ArenaArray< PointI > > _innerPolygonsPoints31;
+            // Ids of TagValueDictionary
+            ArenaArray< uint32_t > _types;
+            ArenaArray< uint32_t > _extraTypes;
+            ArenaArray< Name > _names;
             AreaI _bbox31;
         public:
             virtual ~MapObject();
@@ -70,18 +83,24 @@ namespace OsmAnd {
             ObfMapSection* const section;
             const uint64_t& id;
             const FoundationType& foundation;
-            const QHash<QString, QString>& names;
+            const ArenaArray<Name>& names;
             const AreaI& bbox31;
 
+            const QString& getNameTag(const Name& name) const;
+            const QString& getNameValue(const Name& name) const;
+            QHash<QString, QString> getNames() const;
+
             int getSimpleLayerValue() const;
             bool isClosedFigure(bool checkInner = false) const;
 
+            bool containsType(const uint32_t typeId, bool checkAdditional = false) const;
             bool containsType(const QString& tag, const QString& value, bool checkAdditional = false) const;
 
             size_t calculateApproxConsumedMemory() const;
 
             friend class OsmAnd::ObfMapSection;
             friend class OsmAnd::Rasterizer;
+            friend class OsmAnd::RasterizationStyleEvaluator;
         };
 
     } // namespace Model
@@ -0,0 +1,257 @@
+/**
+* @file
+*
+* @section LICENSE
+*
+* OsmAnd - Android navigation software based on OSM maps.
+* Copyright (C) 2010-2013  OsmAnd Authors listed in AUTHORS file
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __MODEL_MAP_OBJECTS_ARENA_H_
+#define __MODEL_MAP_OBJECTS_ARENA_H_
+
+#include <stdint.h>
+#include <cstddef>
+#include <memory>
+#include <limits>
+#include <new>
+#include <type_traits>
+
+#include <cstring>
+
+#include <QList>
+#include <QByteArray>
+#include <QVector>
+#include <QString>
+#include <QStringList>
+
+#include <OsmAndCore.h>
+
+namespace OsmAnd {
+
+    namespace Model {
+
+        /**
+        View of array that is stored in MapObjectsArena. It does not own the elements, and is valid
+        as long as the arena is alive. Elements are never destructed, so only plain structures can be stored.
+        */
+        template<typename T>
+        class ArenaArray
+        {
+        private:
+            T* _data;
+            int _size;
+        public:
+            ArenaArray()
+                : _data(nullptr)
+                , _size(0)
+            {
+            }
+
+            ArenaArray(T* data, const int size)
+                : _data(data)
+                , _size(size)
+            {
+            }
+
+            inline int size() const
+            {
+                return _size;
+            }
+
+            inline bool isEmpty() const
+            {
+                return _size == 0;
+            }
+
+            inline T* data()
+            {
+                return _data;
+            }
+
+            inline const T* constData() const
+            {
+                return _data;
+            }
+
+            inline const T* begin() const
+            {
+                return _data;
+            }
+
+            inline const T* end() const
+            {
+                return _data + _size;
+            }
+
+            inline const T* cbegin() const
+            {
+                return _data;
+            }
+
+            inline const T* cend() const
+            {
+                return _data + _size;
+            }
+
+            inline const T& first() const
+            {
+                return _data[0];
+            }
+
+            inline const T& last() const
+            {
+                return _data[_size - 1];
+            }
+
+            inline const T& operator[](const int index) const
+            {
+                return _data[index];
+            }
+        };
+
+        /**
+        Bump allocator for map objects that are loaded together, along with their points, types and
+        names. Names are stored once per arena in its string table. Memory is never released
+        per-object, but all at once when last object allocated from arena is destroyed.
+        Allocation is not thread-safe, so one arena should be filled from one thread at a time.
+        */
+        class OSMAND_CORE_API MapObjectsArena
+        {
+        private:
+            MapObjectsArena(const MapObjectsArena& that);
+        protected:
+            const size_t _blockSize;
+            QList< QByteArray > _blocks;
+            size_t _blockUsed;
+            size_t _allocatedMemory;
+            QVector< QString > _strings;
+        public:
+            enum {
+                DefaultBlockSize = 64 * 1024,
+            };
+
+            MapObjectsArena(const size_t blockSize = DefaultBlockSize);
+            virtual ~MapObjectsArena();
+
+            //! Memory of all blocks and of strings in string table
+            const size_t& allocatedMemory;
+
+            void* allocate(const size_t size, const size_t alignment);
+
+            template<typename T>
+            ArenaArray<T> allocateArray(const int size)
+            {
+                if(size == 0)
+                    return ArenaArray<T>();
+                return ArenaArray<T>(static_cast<T*>(allocate(size * sizeof(T), std::alignment_of<T>::value)), size);
+            }
+
+            template<typename T>
+            ArenaArray<T> copyArray(const T* data, const int size)
+            {
+                auto array = allocateArray<T>(size);
+                if(size > 0)
+                    std::memcpy(array.data(), data, size * sizeof(T));
+                return array;
+            }
+
+            template<typename T>
+            ArenaArray<T> copyArray(const QVector<T>& vector)
+            {
+                return copyArray(vector.constData(), vector.size());
+            }
+
+            //! Strings are appended to the string table of arena, and id of the first one is returned
+            uint32_t appendStrings(const QStringList& strings);
+            uint32_t appendString(const QString& string);
+            const QString& getString(const uint32_t id) const;
+
+            template<typename T>
+            class Allocator
+            {
+            public:
+                typedef T value_type;
+                typedef T* pointer;
+                typedef const T* const_pointer;
+                typedef T& reference;
+                typedef const T& const_reference;
+                typedef size_t size_type;
+                typedef ptrdiff_t difference_type;
+
+                template<typename U>
+                struct rebind
+                {
+                    typedef Allocator<U> other;
+                };
+
+                Allocator(const std::shared_ptr<MapObjectsArena>& arena_)
+                    : arena(arena_)
+                {
+                }
+
+                template<typename U>
+                Allocator(const Allocator<U>& that)
+                    : arena(that.arena)
+                {
+                }
+
+                std::shared_ptr<MapObjectsArena> arena;
+
+                pointer allocate(size_type n, const void* hint = nullptr)
+                {
+                    return static_cast<pointer>(arena->allocate(n * sizeof(T), std::alignment_of<T>::value));
+                }
+
+                void deallocate(pointer p, size_type n)
+                {
+                    // Released together with the arena
+                }
+
+                void construct(pointer p, const T& value)
+                {
+                    new(p) T(value);
+                }
+
+                void destroy(pointer p)
+                {
+                    p->~T();
+                }
+
+                size_type max_size() const
+                {
+                    return std::numeric_limits<size_type>::max() / sizeof(T);
+                }
+
+                template<typename U>
+                bool operator==(const Allocator<U>& that) const
+                {
+                    return arena == that.arena;
+                }
+
+                template<typename U>
+                bool operator!=(const Allocator<U>& that) const
+                {
+                    return arena != that.arena;
+                }
+            };
+        };
+
+    } // namespace Model
+
+} // namespace OsmAnd
+
+#endif // __MODEL_MAP_OBJECTS_ARENA_H_
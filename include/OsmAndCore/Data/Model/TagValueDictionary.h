@@ -0,0 +1,88 @@
+/**
+* @file
+*
+* @section LICENSE
+*
+* OsmAnd - Android navigation software based on OSM maps.
+* Copyright (C) 2010-2013  OsmAnd Authors listed in AUTHORS file
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __MODEL_TAG_VALUE_DICTIONARY_H_
+#define __MODEL_TAG_VALUE_DICTIONARY_H_
+
+#include <stdint.h>
+
+#include <QString>
+
+#include <OsmAndCore.h>
+#include <OsmAndCore/CommonTypes.h>
+
+namespace OsmAnd {
+
+    namespace Model {
+
+        /**
+        Process-wide dictionary of interned tag-value pairs. Each distinct pair gets a compact id
+        that never changes during process lifetime, so map objects from all sections can be compared
+        by type using integers. A tag alone is interned as a pair with empty value, that id is
+        referred as tag id. Lookups by id are lock-free, interning itself is serialized.
+        */
+        class OSMAND_CORE_API TagValueDictionary
+        {
+        private:
+            TagValueDictionary();
+        public:
+            // These are registered before anything else, so their ids are known at compile time
+            enum PredefinedIds : uint32_t
+            {
+                // Tags
+                HighwayTag = 0,
+                NaturalTag,
+                OnewayTag,
+                LayerTag,
+                TunnelTag,
+                BridgeTag,
+
+                // Tag-value pairs
+                NaturalCoastline,
+                NaturalCoastlineBroken,
+                NaturalCoastlineLine,
+                NaturalLand,
+                OnewayYes,
+                OnewayReverse,
+                TunnelYes,
+                BridgeYes,
+
+                PredefinedIdsCount
+            };
+            enum : uint32_t {
+                InvalidId = 0xFFFFFFFFu,
+            };
+
+            static uint32_t obtainId(const QString& tag, const QString& value);
+            static bool lookupId(const QString& tag, const QString& value, uint32_t& outId);
+            static uint32_t obtainTagId(const QString& tag);
+            static uint32_t getIdsCount();
+
+            static const TagValue& resolve(const uint32_t id);
+            static uint32_t resolveTagId(const uint32_t id);
+        };
+
+    } // namespace Model
+
+} // namespace OsmAnd
+
+#endif // __MODEL_TAG_VALUE_DICTIONARY_H_
@@ -78,12 +78,12 @@ namespace OsmAnd {
                 std::function<bool (const std::shared_ptr<OsmAnd::Model::StreetGroup>&)> visitor,
                 IQueryController* controller);
             
-            static void read(ObfReader* reader, AddressBlocksSection* section);
-            static void readStreetGroups(ObfReader* reader, AddressBlocksSection* section,
+            static void read(ObfReader* reader, gpb::io::CodedInputStream* cis, AddressBlocksSection* section);
+            static void readStreetGroups(ObfReader* reader, gpb::io::CodedInputStream* cis, AddressBlocksSection* section,
                 QList< std::shared_ptr<Model::StreetGroup> >* resultOut,
                 std::function<bool (const std::shared_ptr<OsmAnd::Model::StreetGroup>&)> visitor,
                 IQueryController* controller);
-            static std::shared_ptr<Model::StreetGroup> readStreetGroupHeader(ObfReader* reader, AddressBlocksSection* section, unsigned int offset);
+            static std::shared_ptr<Model::StreetGroup> readStreetGroupHeader(ObfReader* reader, gpb::io::CodedInputStream* cis, AddressBlocksSection* section, unsigned int offset);
 
         public:
             virtual ~AddressBlocksSection();
@@ -102,27 +102,29 @@ namespace OsmAnd {
 
         QList< std::shared_ptr<AddressBlocksSection> > _blocksSections;
         
-        static void read(ObfReader* reader, ObfAddressSection* section);
-        static void readStreetGroups(ObfReader* reader, ObfAddressSection* section,
+        static void read(ObfReader* reader, gpb::io::CodedInputStream* cis, ObfAddressSection* section);
+        static void saveStructure(QDataStream& stream, const ObfAddressSection* section);
+        static void loadStructure(QDataStream& stream, ObfAddressSection* section);
+        static void readStreetGroups(ObfReader* reader, gpb::io::CodedInputStream* cis, ObfAddressSection* section,
             QList< std::shared_ptr<Model::StreetGroup> >* resultOut,
             std::function<bool (const std::shared_ptr<OsmAnd::Model::StreetGroup>&)> visitor,
             IQueryController* controller,
             uint8_t typeBitmask = std::numeric_limits<uint8_t>::max());
-        static void readStreetsFromGroup(ObfReader* reader, Model::StreetGroup* group,
+        static void readStreetsFromGroup(ObfReader* reader, gpb::io::CodedInputStream* cis, Model::StreetGroup* group,
             QList< std::shared_ptr<Model::Street> >* resultOut,
             std::function<bool (const std::shared_ptr<OsmAnd::Model::Street>&)> visitor,
             IQueryController* controller);
-        static void readStreet(ObfReader* reader, Model::StreetGroup* group, Model::Street* street);
-        static void readBuildingsFromStreet(ObfReader* reader, Model::Street* street,
+        static void readStreet(ObfReader* reader, gpb::io::CodedInputStream* cis, Model::StreetGroup* group, Model::Street* street);
+        static void readBuildingsFromStreet(ObfReader* reader, gpb::io::CodedInputStream* cis, Model::Street* street,
             QList< std::shared_ptr<Model::Building> >* resultOut,
             std::function<bool (const std::shared_ptr<OsmAnd::Model::Building>&)> visitor,
             IQueryController* controller);
-        static void readBuilding(ObfReader* reader, Model::Street* street, Model::Building* building);
-        static void readIntersectionsFromStreet(ObfReader* reader, Model::Street* street,
+        static void readBuilding(ObfReader* reader, gpb::io::CodedInputStream* cis, Model::Street* street, Model::Building* building);
+        static void readIntersectionsFromStreet(ObfReader* reader, gpb::io::CodedInputStream* cis, Model::Street* street,
             QList< std::shared_ptr<Model::StreetIntersection> >* resultOut,
             std::function<bool (const std::shared_ptr<OsmAnd::Model::StreetIntersection>&)> visitor,
             IQueryController* controller);
-        static void readIntersectedStreet(ObfReader* reader, Model::Street* street, Model::StreetIntersection* intersection);
+        static void readIntersectedStreet(ObfReader* reader, gpb::io::CodedInputStream* cis, Model::Street* street, Model::StreetIntersection* intersection);
 
     public:
         virtual ~ObfAddressSection();
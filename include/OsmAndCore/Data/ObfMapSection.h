@@ -32,12 +32,14 @@
 #include <QList>
 #include <QHash>
 #include <QMap>
+#include <QMutex>
 #include <QSet>
 #include <QVector>
 
 #include <OsmAndCore.h>
 #include <OsmAndCore/Data/ObfSection.h>
 #include <OsmAndCore/Data/Model/MapObject.h>
+#include <OsmAndCore/Data/Model/MapObjectsArena.h>
 #include <OsmAndCore/IQueryController.h>
 #include <OsmAndCore/CommonTypes.h>
 
@@ -64,6 +66,22 @@ namespace OsmAnd {
             AreaI _area31;
         };
 
+        // Compact in-memory form of a level tree node. Nodes of a level are stored
+        // in pre-order, and each one keeps index past its last descendant so that
+        // a subtree outside of query area can be skipped in one step.
+        struct FlatTreeNode
+        {
+            FlatTreeNode(const LevelTreeNode& node);
+
+            int32_t _top;
+            int32_t _left;
+            int32_t _bottom;
+            int32_t _right;
+            uint32_t _dataOffset;
+            uint32_t _subtreeEnd;
+            Model::MapObject::FoundationType _foundation;
+        };
+
         struct Rules
         {
             typedef std::tuple<QString, QString, uint32_t> DecodingRule;
@@ -72,6 +90,8 @@ namespace OsmAnd {
 
             QHash< QString, QHash<QString, uint32_t> > _encodingRules;
             QMap< uint32_t, DecodingRule > _decodingRules;
+            // TagValueDictionary ids of decoding rules, indexed by rule id
+            QVector< uint32_t > _decodingRulesTypeIds;
             uint32_t _nameEncodingType;
             uint32_t _refEncodingType;
             uint32_t _coastlineEncodingType;
@@ -94,6 +114,11 @@ namespace OsmAnd {
             uint32_t _minZoom;
             uint32_t _maxZoom;
             AreaI _area31;
+
+            QMutex _flatTreeNodesMutex;
+            std::shared_ptr< const QVector<FlatTreeNode> > _flatTreeNodes;
+            size_t _flatTreeNodesConsumedMemory;
+            bool _isFlatTreeNodesOverBudget;
         public:
             virtual ~MapLevel();
 
@@ -104,6 +129,9 @@ namespace OsmAnd {
 
             friend class OsmAnd::ObfMapSection;
         };
+
+        // Chooses arena for a decoded object by its bounds before the object is created, or rejects it with nullptr
+        typedef std::function<std::shared_ptr<Model::MapObjectsArena> (const AreaI& bbox31)> ArenaSelector;
     private:
     protected:
         ObfMapSection(ObfReader* owner);
@@ -111,31 +139,62 @@ namespace OsmAnd {
         bool _isBaseMap;
 
         QList< std::shared_ptr<MapLevel> > _mapLevels;
+        QMutex _rulesMutex;
         std::shared_ptr< Rules > _rules;
 
-        static void read(ObfReader* reader, ObfMapSection* section);
-        static void readMapLevelHeader(ObfReader* reader, ObfMapSection* section, MapLevel* level);
-        static void readRules(ObfReader* reader, Rules* rules);
-        static void readRule(ObfReader* reader, uint32_t defaultId, Rules* rules);
+        static QMutex _flatTreeNodesMemoryMutex;
+        static size_t _flatTreeNodesMemoryUsage;
+        static size_t _flatTreeNodesMemoryLimit;
+
+        static void read(ObfReader* reader, gpb::io::CodedInputStream* cis, ObfMapSection* section);
+        static void saveStructure(QDataStream& stream, const ObfMapSection* section);
+        static void loadStructure(QDataStream& stream, ObfMapSection* section);
+        static void readMapLevelHeader(ObfReader* reader, gpb::io::CodedInputStream* cis, ObfMapSection* section, MapLevel* level);
+        static void readRules(ObfReader* reader, gpb::io::CodedInputStream* cis, Rules* rules);
+        static void readRule(ObfReader* reader, gpb::io::CodedInputStream* cis, uint32_t defaultId, Rules* rules);
         static void createRule(Rules* rules, uint32_t type, uint32_t id, const QString& tag, const QString& val);
-        static void readMapLevelTreeNodes(ObfReader* reader, ObfMapSection* section, MapLevel* level, QList< std::shared_ptr<LevelTreeNode> >& nodes);
-        static void readTreeNode(ObfReader* reader, ObfMapSection* section, const AreaI& parentArea, LevelTreeNode* treeNode);
-        static void readTreeNodeChildren(ObfReader* reader, ObfMapSection* section,
+        static void readMapLevelTreeNodes(ObfReader* reader, gpb::io::CodedInputStream* cis, ObfMapSection* section, MapLevel* level, QList< std::shared_ptr<LevelTreeNode> >& nodes);
+        static void readTreeNode(ObfReader* reader, gpb::io::CodedInputStream* cis, ObfMapSection* section, const AreaI& parentArea, LevelTreeNode* treeNode);
+        static void readTreeNodeChildren(ObfReader* reader, gpb::io::CodedInputStream* cis, ObfMapSection* section,
             LevelTreeNode* treeNode,
             QList< std::shared_ptr<LevelTreeNode> >* nodesWithData,
             const AreaI* bbox31,
             IQueryController* controller);
-        static void readMapObjectsBlock(ObfReader* reader, ObfMapSection* section,
+        static void readFlatTreeNodeChildren(ObfReader* reader, gpb::io::CodedInputStream* cis, ObfMapSection* section,
+            LevelTreeNode* treeNode,
+            QVector<FlatTreeNode>& flatNodes);
+        static std::shared_ptr< const QVector<FlatTreeNode> > obtainFlatTreeNodes(ObfReader* reader, gpb::io::CodedInputStream* cis, ObfMapSection* section, MapLevel* level);
+        // Object is decoded into these first, and is copied to arena only if it's accepted. They are
+        // reused by all objects of one query, so decoding itself does not allocate per object.
+        struct MapObjectBuffers
+        {
+            MapObjectBuffers();
+
+            QVector< PointI > points31;
+            QVector< PointI > innerPolygonsPoints31;
+            QVector< int > innerPolygonsSizes;
+            QVector< uint32_t > types;
+            QVector< uint32_t > extraTypes;
+            QVector< Model::MapObject::Name > names;
+
+            void clear();
+        };
+        static void readMapObjectsBlock(ObfReader* reader, gpb::io::CodedInputStream* cis, ObfMapSection* section,
             LevelTreeNode* treeNode,
             QList< std::shared_ptr<OsmAnd::Model::MapObject> >* resultOut,
             const AreaI* bbox31,
             std::function<bool (const std::shared_ptr<OsmAnd::Model::MapObject>&)> visitor,
-            IQueryController* controller);
-        static void readMapObject(ObfReader* reader, ObfMapSection* section,
+            IQueryController* controller,
+            const ArenaSelector& arenaSelector,
+            MapObjectBuffers& buffers);
+        static void readMapObject(ObfReader* reader, gpb::io::CodedInputStream* cis, ObfMapSection* section,
             LevelTreeNode* treeNode,
             uint64_t baseId,
             std::shared_ptr<OsmAnd::Model::MapObject>& mapObjectOut,
-            const AreaI* bbox31);
+            std::shared_ptr<Model::MapObjectsArena>& arenaOut,
+            const AreaI* bbox31,
+            const ArenaSelector& arenaSelector,
+            MapObjectBuffers& buffers);
         enum {
             ShiftCoordinates = 5,
             MaskToRead = ~((1u << ShiftCoordinates) - 1),
@@ -145,12 +204,27 @@ namespace OsmAnd {
 
         const bool& isBaseMap;
         const QList< std::shared_ptr<MapLevel> >& mapLevels;
+
+        // Level trees are decoded once and kept in memory while total size of all of them fits this limit.
+        // Levels that do not fit are traversed on disk for every query.
+        static size_t getFlatTreeNodesMemoryLimit();
+        static void setFlatTreeNodesMemoryLimit(const size_t limit);
         
+        // If no arena is given, objects of this query are allocated from a new one
         static void loadMapObjects(ObfReader* reader, ObfMapSection* section,
             uint32_t zoom, const AreaI* bbox31 = nullptr,
             QList< std::shared_ptr<OsmAnd::Model::MapObject> >* resultOut = nullptr,
             std::function<bool (const std::shared_ptr<OsmAnd::Model::MapObject>&)> visitor = nullptr,
-            IQueryController* controller = nullptr);
+            IQueryController* controller = nullptr,
+            const std::shared_ptr<Model::MapObjectsArena>& arena = std::shared_ptr<Model::MapObjectsArena>());
+        // Each object is allocated from arena chosen for it, and objects that are rejected by selector are not
+        // allocated at all. Only names that are referenced by created objects are put into string tables of arenas.
+        static void loadMapObjects(ObfReader* reader, ObfMapSection* section,
+            uint32_t zoom, const AreaI* bbox31,
+            QList< std::shared_ptr<OsmAnd::Model::MapObject> >* resultOut,
+            std::function<bool (const std::shared_ptr<OsmAnd::Model::MapObject>&)> visitor,
+            IQueryController* controller,
+            const ArenaSelector& arenaSelector);
 
     friend class OsmAnd::ObfReader;
     };
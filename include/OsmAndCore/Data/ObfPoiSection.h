@@ -56,10 +56,10 @@ namespace OsmAnd {
             SubcategoryIdShift = 7,
             CategoryIdMask = (1u << SubcategoryIdShift) - 1,
         };
-        static void readBoundaries(ObfReader* reader, ObfPoiSection* section);
-        static void readCategories(ObfReader* reader, ObfPoiSection* section, QList< std::shared_ptr<Model::Amenity::Category> >& categories);
-        static void readCategory(ObfReader* reader, Model::Amenity::Category* category);
-        static void readAmenities(ObfReader* reader, ObfPoiSection* section,
+        static void readBoundaries(ObfReader* reader, gpb::io::CodedInputStream* cis, ObfPoiSection* section);
+        static void readCategories(ObfReader* reader, gpb::io::CodedInputStream* cis, ObfPoiSection* section, QList< std::shared_ptr<Model::Amenity::Category> >& categories);
+        static void readCategory(ObfReader* reader, gpb::io::CodedInputStream* cis, Model::Amenity::Category* category);
+        static void readAmenities(ObfReader* reader, gpb::io::CodedInputStream* cis, ObfPoiSection* section,
             QSet<uint32_t>* desiredCategories,
             QList< std::shared_ptr<OsmAnd::Model::Amenity> >* amenitiesOut,
             uint32_t zoom, uint32_t zoomDepth, const AreaI* bbox31,
@@ -73,30 +73,32 @@ namespace OsmAnd {
             uint64_t _hash;
             int32_t _offset;
         };
-        static bool readTile(ObfReader* reader, ObfPoiSection* section,
+        static bool readTile(ObfReader* reader, gpb::io::CodedInputStream* cis, ObfPoiSection* section,
             QList< std::shared_ptr<Tile> >& tiles,
             Tile* parent,
             QSet<uint32_t>* desiredCategories,
             uint32_t zoom, uint32_t zoomDepth, const AreaI* bbox31,
             IQueryController* controller,
             QSet< uint64_t >* tilesToSkip);
-        static bool checkTileCategories(ObfReader* reader, ObfPoiSection* section,
+        static bool checkTileCategories(ObfReader* reader, gpb::io::CodedInputStream* cis, ObfPoiSection* section,
             QSet<uint32_t>* desiredCategories);
-        static void readAmenitiesFromTile(ObfReader* reader, ObfPoiSection* section, Tile* tile,
+        static void readAmenitiesFromTile(ObfReader* reader, gpb::io::CodedInputStream* cis, ObfPoiSection* section, Tile* tile,
             QSet<uint32_t>* desiredCategories,
             QList< std::shared_ptr<OsmAnd::Model::Amenity> >* amenitiesOut,
             uint32_t zoom, uint32_t zoomDepth, const AreaI* bbox31,
             std::function<bool (const std::shared_ptr<OsmAnd::Model::Amenity>&)> visitor,
             IQueryController* controller,
             QSet< uint64_t >* amenitiesToSkip);
-        static void readAmenity(ObfReader* reader, ObfPoiSection* section, const PointI& pTile, uint32_t pzoom, std::shared_ptr<Model::Amenity>& amenity,
+        static void readAmenity(ObfReader* reader, gpb::io::CodedInputStream* cis, ObfPoiSection* section, const PointI& pTile, uint32_t pzoom, std::shared_ptr<Model::Amenity>& amenity,
             QSet<uint32_t>* desiredCategories,
             const AreaI* bbox31,
             IQueryController* controller);
     protected:
         ObfPoiSection(ObfReader* owner);
 
-        static void read(ObfReader* reader, ObfPoiSection* section);
+        static void read(ObfReader* reader, gpb::io::CodedInputStream* cis, ObfPoiSection* section);
+        static void saveStructure(QDataStream& stream, const ObfPoiSection* section);
+        static void loadStructure(QDataStream& stream, ObfPoiSection* section);
     public:
         virtual ~ObfPoiSection();
 
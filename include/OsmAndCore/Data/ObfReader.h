@@ -30,10 +30,15 @@
 #include <QIODevice>
 #include <QList>
 #include <QMultiHash>
+#include <QMutex>
+#include <QAtomicInt>
+#include <QVector>
 
 #include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/io/zero_copy_stream.h>
 
 #include <OsmAndCore.h>
+#include <OsmAndCore/CommonTypes.h>
 #include <OsmAndCore/Data/ObfReader.h>
 #include <OsmAndCore/Data/ObfSection.h>
 #include <OsmAndCore/Data/ObfMapSection.h>
@@ -53,7 +58,24 @@ namespace OsmAnd {
     class OSMAND_CORE_API ObfReader
     {
     private:
-        const std::shared_ptr<gpb::io::CodedInputStream> _codedInputStream;
+        struct Cursor
+        {
+            Cursor(gpb::io::ZeroCopyInputStream* zeroCopyInputStream);
+
+            const std::unique_ptr<gpb::io::ZeroCopyInputStream> zeroCopyInputStream;
+            const std::unique_ptr<gpb::io::CodedInputStream> codedInputStream;
+        };
+        static gpb::io::ZeroCopyInputStream* createZeroCopyInputStream(const std::shared_ptr<QIODevice>& input);
+
+        //! Cursor used to read file structure. If file can not be shared between threads, it's the only one
+        const std::shared_ptr<Cursor> _primaryCursor;
+
+        //! Cursors over same memory-mapped file that are not used by any query at the moment
+        bool _isThreadSafe;
+        QMutex _idleCursorsMutex;
+        QList< std::shared_ptr<Cursor> > _idleCursors;
+        std::shared_ptr<Cursor> acquireCursor();
+        void releaseCursor(const std::shared_ptr<Cursor>& cursor);
 
         int _version;
         long _creationTimestamp;
@@ -64,20 +86,81 @@ namespace OsmAnd {
         QList< std::shared_ptr<ObfPoiSection> > _poiSections;
         QList< std::shared_ptr<ObfTransportSection> > _transportSections;
         QList< ObfSection* > _sections;
+
+        //! In lazy mode, bit per SectionType which headers were not read yet
+        bool _isLazy;
+        QMutex _lazySectionsMutex;
+        QAtomicInt _unreadSectionTypesMask;
+
+        //! Structure cache file format
+        enum {
+            StructureCacheMagic = 0x4F424643, // 'OBFC'
+            StructureCacheVersion = 1,
+        };
+        bool obtainSourceFileInfo(qint64& sizeOut, qint64& modificationTimeOut) const;
+        bool loadStructureCache(const QString& filename);
+        void saveStructureCache(const QString& filename) const;
     protected:
+        /**
+        Cursor of one query, that is obtained once at entry point of the query and passed down to all readers.
+        If file can be shared between threads, each query gets own cursor that is returned to reader on
+        destruction, otherwise all queries use primary one.
+        */
+        class ScopedCursor
+        {
+        private:
+            ObfReader* const _reader;
+            const std::shared_ptr<Cursor> _cursor;
+        public:
+            ScopedCursor(ObfReader* reader);
+            ~ScopedCursor();
+
+            gpb::io::CodedInputStream* const cis;
+        };
+
         QString transliterate(QString input);
         static bool readQString(gpb::io::CodedInputStream* cis, QString& output);
         static int32_t readSInt32(gpb::io::CodedInputStream* cis);
         static int64_t readSInt64(gpb::io::CodedInputStream* cis);
+        static void readDeltaPoints(gpb::io::CodedInputStream* cis, const PointI& base31, const uint32_t shift, QVector<PointI>& pointsOut);
         static uint32_t readBigEndianInt(gpb::io::CodedInputStream* cis);
         static void readStringTable(gpb::io::CodedInputStream* cis, QStringList& stringTableOut);
         static void skipUnknownField(gpb::io::CodedInputStream* cis, int tag);
     public:
-        ObfReader(const std::shared_ptr<QIODevice>& input);
+#ifndef SWIG
+        enum class SectionType
+#else
+        enum SectionType
+#endif
+        {
+            Map = 0,
+            Address,
+            Routing,
+            Poi,
+            Transport
+        };
+
+        /**
+        If structureCacheFilename is given, parsed section headers are stored there and reused on next open,
+        as long as size, modification time and creation timestamp of the file are unchanged.
+
+        If lazySectionsReading is set, only offsets and lengths of sections are recorded on open, and headers
+        of all sections of one type are read on first query of that type (see ensureSectionsRead()).
+        Structure cache is not written in lazy mode, since headers are not known at that point.
+        */
+        ObfReader(const std::shared_ptr<QIODevice>& input, const QString& structureCacheFilename = QString(), const bool lazySectionsReading = false);
         virtual ~ObfReader();
 
         const std::shared_ptr<QIODevice> source;
 
+        const bool& isLazy;
+
+        //! Reads headers of sections of given type if they were not read yet. Thread-safe, cheap after first call
+        void ensureSectionsRead(const SectionType type);
+
+        //! If true, sections of this reader may be queried from several threads at once
+        const bool& isThreadSafe;
+
         const int& version;
         const long& creationTimestamp;
         const bool& isBaseMap;
@@ -32,6 +32,7 @@
 
 #include <QList>
 #include <QMap>
+#include <QMutex>
 #include <QString>
 #include <QVector>
 
@@ -122,6 +123,7 @@ namespace OsmAnd {
         };
         QList< std::shared_ptr<Subsection> > _subsections;
         QList< std::shared_ptr<Subsection> > _baseSubsections;
+        QMutex _subsectionsLoadMutex;
 
         class OSMAND_CORE_API BorderLineHeader
         {
@@ -194,29 +196,37 @@ namespace OsmAnd {
         enum {
             ShiftCoordinates = 4,
         };
-        static void read(ObfReader* reader, const std::shared_ptr<ObfRoutingSection>& section);
-        static void readEncodingRule(ObfReader* reader, ObfRoutingSection* section, EncodingRule* rule);
-        static void readSubsectionHeader(ObfReader* reader, const std::shared_ptr<Subsection>& subsection, Subsection* parent, uint32_t depth = std::numeric_limits<uint32_t>::max());
-        static void readSubsectionChildrenHeaders(ObfReader* reader, const std::shared_ptr<Subsection>& subsection, uint32_t depth = std::numeric_limits<uint32_t>::max());
-        static void readSubsectionData(ObfReader* reader, const std::shared_ptr<Subsection>& subsection,
+        static void read(ObfReader* reader, gpb::io::CodedInputStream* cis, const std::shared_ptr<ObfRoutingSection>& section);
+        static void saveStructure(QDataStream& stream, const ObfRoutingSection* section);
+        static void saveSubsectionStructure(QDataStream& stream, const Subsection* subsection);
+        static void loadStructure(QDataStream& stream, const std::shared_ptr<ObfRoutingSection>& section);
+        static void loadSubsectionStructure(QDataStream& stream, const std::shared_ptr<Subsection>& subsection);
+        static void readEncodingRule(ObfReader* reader, gpb::io::CodedInputStream* cis, ObfRoutingSection* section, EncodingRule* rule);
+        static void readSubsectionHeader(ObfReader* reader, gpb::io::CodedInputStream* cis, const std::shared_ptr<Subsection>& subsection, Subsection* parent, uint32_t depth = std::numeric_limits<uint32_t>::max());
+        static void querySubsections(ObfReader* reader, gpb::io::CodedInputStream* cis, const QList< std::shared_ptr<Subsection> >& in,
+            QList< std::shared_ptr<Subsection> >* resultOut,
+            IQueryFilter* filter,
+            std::function<bool (const std::shared_ptr<OsmAnd::ObfRoutingSection::Subsection>&)> visitor);
+        static void readSubsectionChildrenHeaders(ObfReader* reader, gpb::io::CodedInputStream* cis, const std::shared_ptr<Subsection>& subsection, uint32_t depth = std::numeric_limits<uint32_t>::max());
+        static void readSubsectionData(ObfReader* reader, gpb::io::CodedInputStream* cis, const std::shared_ptr<Subsection>& subsection,
             QList< std::shared_ptr<Model::Road> >* resultOut = nullptr,
             QMap< uint64_t, std::shared_ptr<Model::Road> >* resultMapOut = nullptr,
             IQueryFilter* filter = nullptr,
             std::function<bool (const std::shared_ptr<OsmAnd::Model::Road>&)> visitor = nullptr);
-        static void readSubsectionRoadsIds(ObfReader* reader, Subsection* subsection, QList<uint64_t>& ids);
-        static void readSubsectionRestriction(ObfReader* reader, Subsection* subsection, const QMap< uint32_t, std::shared_ptr<Model::Road> >& roads, const QList<uint64_t>& roadsInternalIdToGlobalIdMap);
-        static void readRoad(ObfReader* reader, Subsection* subsection, const QList<uint64_t>& idsTable, uint32_t& internalId, Model::Road* road);
+        static void readSubsectionRoadsIds(ObfReader* reader, gpb::io::CodedInputStream* cis, Subsection* subsection, QList<uint64_t>& ids);
+        static void readSubsectionRestriction(ObfReader* reader, gpb::io::CodedInputStream* cis, Subsection* subsection, const QMap< uint32_t, std::shared_ptr<Model::Road> >& roads, const QList<uint64_t>& roadsInternalIdToGlobalIdMap);
+        static void readRoad(ObfReader* reader, gpb::io::CodedInputStream* cis, Subsection* subsection, const QList<uint64_t>& idsTable, uint32_t& internalId, Model::Road* road);
 
-        static void readBorderBoxLinesHeaders(ObfReader* reader,
+        static void readBorderBoxLinesHeaders(ObfReader* reader, gpb::io::CodedInputStream* cis,
             QList< std::shared_ptr<BorderLineHeader> >* resultOut = nullptr,
             IQueryFilter* filter = nullptr,
             std::function<bool (const std::shared_ptr<BorderLineHeader>&)> visitor = nullptr);
-        static void readBorderLineHeader(ObfReader* reader, BorderLineHeader* borderLine, uint32_t outerOffset);
-        static void readBorderLinePoints(ObfReader* reader,
+        static void readBorderLineHeader(ObfReader* reader, gpb::io::CodedInputStream* cis, BorderLineHeader* borderLine, uint32_t outerOffset);
+        static void readBorderLinePoints(ObfReader* reader, gpb::io::CodedInputStream* cis,
             QList< std::shared_ptr<BorderLinePoint> >* resultOut = nullptr,
             IQueryFilter* filter = nullptr,
             std::function<bool (const std::shared_ptr<BorderLinePoint>&)> visitor = nullptr);
-        static void readBorderLinePoint(ObfReader* reader,
+        static void readBorderLinePoint(ObfReader* reader, gpb::io::CodedInputStream* cis,
             BorderLinePoint* point);
     private:
 
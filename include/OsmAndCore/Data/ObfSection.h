@@ -28,6 +28,7 @@
 
 #include <OsmAndCore.h>
 #include <QString>
+#include <QDataStream>
 
 namespace OsmAnd {
 
@@ -45,6 +46,9 @@ namespace OsmAnd {
         QString _name;
         uint32_t _length;
         uint32_t _offset;
+
+        static void saveStructure(QDataStream& stream, const ObfSection* section);
+        static void loadStructure(QDataStream& stream, ObfSection* section);
     public:
         virtual ~ObfSection();
 
@@ -45,7 +45,7 @@ namespace OsmAnd {
     class OSMAND_CORE_API ObfTransportSection : public ObfSection
     {
     private:
-        static void readTransportBounds(ObfReader* reader, ObfTransportSection* section);
+        static void readTransportBounds(ObfReader* reader, gpb::io::CodedInputStream* cis, ObfTransportSection* section);
     protected:
         ObfTransportSection(class ObfReader* owner);
 
@@ -53,7 +53,9 @@ namespace OsmAnd {
 
         int _stopsFileOffset;
         int _stopsFileLength;
-        static void read(ObfReader* reader, ObfTransportSection* section);
+        static void read(ObfReader* reader, gpb::io::CodedInputStream* cis, ObfTransportSection* section);
+        static void saveStructure(QDataStream& stream, const ObfTransportSection* section);
+        static void loadStructure(QDataStream& stream, ObfTransportSection* section);
     public:
         virtual ~ObfTransportSection();
 
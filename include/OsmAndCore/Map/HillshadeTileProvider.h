@@ -29,7 +29,11 @@
 
 #include <QString>
 #include <QDir>
-#include <QSqlDatabase>
+#include <QCache>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QHash>
+#include <QList>
 
 #include <OsmAndCore.h>
 #include <OsmAndCore/CommonTypes.h>
@@ -40,6 +44,11 @@ class SkBitmap;
 
 namespace OsmAnd {
 
+    class HeightmapTileProvider;
+
+    // Shades relief using elevation tiles of HeightmapTileProvider. Each tile is a transparent bitmap with
+    // shadows of slopes that face away from the light, so that it can be put over any other map layer.
+    // Shaded tiles are kept in memory per light azimuth, so switching light back and forth is instant.
     class OSMAND_CORE_API HillshadeTileProvider : public IMapBitmapTileProvider
     {
     private:
@@ -47,14 +56,56 @@ namespace OsmAnd {
         class OSMAND_CORE_API Tile : public IMapBitmapTileProvider::Tile
         {
         private:
-            std::unique_ptr<SkBitmap> _skBitmap;
+            const std::shared_ptr<SkBitmap> _skBitmap;
         protected:
         public:
-            Tile(SkBitmap* bitmap);
+            Tile(const std::shared_ptr<SkBitmap>& bitmap);
             virtual ~Tile();
         };
 
+        enum {
+            LightAltitude = 45,
+            // Alpha of shadow on slope that is turned completely away from the light
+            MaxShadowAlpha = 180,
+        };
+
+        struct CachedBitmapKey
+        {
+            TileId tileId;
+            uint32_t zoom;
+            float lightAzimuth;
+
+            inline bool operator==(const CachedBitmapKey& that) const
+            {
+                return tileId.id == that.tileId.id && zoom == that.zoom && lightAzimuth == that.lightAzimuth;
+            }
+
+            friend inline uint qHash(const CachedBitmapKey& key)
+            {
+                return ::qHash(key.tileId.id) ^ (key.zoom * 0x9E3779B9u) ^ ::qHash(static_cast<int>(key.lightAzimuth * 16.0f));
+            }
+        };
+
         QString _indexFilePath;
+
+        mutable QMutex _lightAzimuthMutex;
+        float _lightAzimuth;
+
+        QMutex _heightmapProviderMutex;
+        std::shared_ptr<HeightmapTileProvider> _heightmapProvider;
+
+        QMutex _requestsMutex;
+        QWaitCondition _tasksFinishedCondition;
+        // Callbacks of all requests of a tile that is being shaded
+        std::array< QHash< TileId, QList<TileReadyCallback> >, 32 > _requests;
+        uint32_t _tasksCount;
+        bool _isDestroying;
+
+        QMutex _bitmapsCacheMutex;
+        QCache< CachedBitmapKey, std::shared_ptr<SkBitmap> > _bitmapsCache;
+
+        std::shared_ptr<SkBitmap> shadeTile(const TileId& tileId, uint32_t zoom, float lightAzimuth, const std::shared_ptr<IMapTileProvider::Tile>& heightmapTile);
+        void finishTask();
     public:
         HillshadeTileProvider(const QDir& storagePath);
         virtual ~HillshadeTileProvider();
@@ -66,6 +117,10 @@ namespace OsmAnd {
 
         void rebuildIndex();
 
+        // Azimuth of the light in degrees, clockwise from north
+        void setLightAzimuth(float lightAzimuth);
+        float getLightAzimuth() const;
+
         virtual float getTileDensity() const;
         virtual uint32_t getTileSize() const;
 
@@ -34,6 +34,7 @@
 #include <OsmAndCore/CommonTypes.h>
 #include <OsmAndCore/IQueryController.h>
 #include <OsmAndCore/Data/Model/MapObject.h>
+#include <OsmAndCore/Data/Model/MapObjectsArena.h>
 #include <OsmAndCore/Data/ObfReader.h>
 
 namespace OsmAnd {
@@ -53,8 +54,18 @@ namespace OsmAnd {
 
         struct CachedTile
         {
+            AreaI _area31;
             size_t _approxConsumedMemory;
             QList< std::shared_ptr<OsmAnd::Model::MapObject> > _cachedObjects;
+
+            // Objects that are within this tile only. Each object that spans several tiles has an arena of its own,
+            // that is shared by these tiles through the object and is accounted to each of them in equal parts.
+            std::shared_ptr<Model::MapObjectsArena> _arena;
+        };
+
+        enum {
+            // Arena of object that spans several tiles holds just that object
+            SharedObjectArenaBlockSize = 512,
         };
 
         struct CachedZoomLevel
@@ -29,6 +29,7 @@
 #include <QString>
 #include <QHash>
 #include <QList>
+#include <QVector>
 
 #include <OsmAndCore.h>
 #include <OsmAndCore/Map/RasterizationStyle.h>
@@ -37,6 +38,7 @@ namespace OsmAnd {
 
     class RasterizationStyle;
     class RasterizationStyleEvaluator;
+    class RasterizationRulesetProgram;
 
     class OSMAND_CORE_API RasterizationRule
     {
@@ -54,8 +56,13 @@ namespace OsmAnd {
 
         QList< std::shared_ptr<RasterizationStyle::ValueDefinition> > _valueDefinitionsRefs;
         QHash< QString, Value > _values;
+        // Same as _values, but in order of _valueDefinitionsRefs
+        QVector< Value > _orderedValues;
         QList< std::shared_ptr<RasterizationRule> > _ifElseChildren;
         QList< std::shared_ptr<RasterizationRule> > _ifChildren;
+
+        // TagValueDictionary id of 'additional' input, resolved once at parse time
+        uint32_t _additionalTypeId;
     public:
         virtual ~RasterizationRule();
 
@@ -69,6 +76,7 @@ namespace OsmAnd {
 
     friend class OsmAnd::RasterizationStyle;
     friend class OsmAnd::RasterizationStyleEvaluator;
+    friend class OsmAnd::RasterizationRulesetProgram;
     };
 
 
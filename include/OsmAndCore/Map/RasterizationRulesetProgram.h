@@ -0,0 +1,111 @@
+/**
+* @file
+*
+* @section LICENSE
+*
+* OsmAnd - Android navigation software based on OSM maps.
+* Copyright (C) 2010-2013  OsmAnd Authors listed in AUTHORS file
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __RASTERIZATION_RULESET_PROGRAM_H_
+#define __RASTERIZATION_RULESET_PROGRAM_H_
+
+#include <stdint.h>
+#include <memory>
+
+#include <QHash>
+#include <QMap>
+#include <QSet>
+#include <QVector>
+
+#include <OsmAndCore.h>
+#include <OsmAndCore/Map/RasterizationStyle.h>
+#include <OsmAndCore/Map/RasterizationRule.h>
+
+namespace OsmAnd {
+
+    class RasterizationStyleEvaluator;
+
+    /**
+    Ruleset of a style compiled into flat arrays. Rule tree becomes array of nodes that refer to
+    ranges of conditions, outputs and children by index, so evaluation touches no rule objects,
+    hashes or strings. Result of evaluation is same as of interpreting the rule tree.
+    */
+    class OSMAND_CORE_API RasterizationRulesetProgram
+    {
+    public:
+        enum ConditionType : uint32_t
+        {
+            Equal,
+            FuzzyEqual,
+            LessOrEqual,
+            GreaterOrEqual,
+            // Value is TagValueDictionary id, that is checked in additional types of map object
+            ContainsAdditional,
+            // 'Additional' condition that can not be satisfied at all
+            Never,
+        };
+
+        struct Condition
+        {
+            ConditionType type;
+            uint32_t valueDefinitionId;
+            RasterizationRule::Value value;
+        };
+
+        struct Output
+        {
+            uint32_t valueDefinitionId;
+            RasterizationRule::Value value;
+        };
+
+        struct Node
+        {
+            uint32_t conditionsBegin;
+            uint32_t conditionsEnd;
+            uint32_t outputsBegin;
+            uint32_t outputsEnd;
+            uint32_t ifElseChildrenBegin;
+            uint32_t ifElseChildrenEnd;
+            uint32_t ifChildrenBegin;
+            uint32_t ifChildrenEnd;
+        };
+    private:
+        RasterizationRulesetProgram(const RasterizationRulesetProgram& that);
+
+        uint32_t compileRule(const std::shared_ptr<RasterizationRule>& rule, QHash<RasterizationRule*, uint32_t>& compiledRules);
+    protected:
+        RasterizationRulesetProgram();
+
+        QHash<uint64_t, uint32_t> _roots;
+        QVector<Node> _nodes;
+        QVector<Condition> _conditions;
+        QVector<Output> _outputs;
+        QVector<uint32_t> _children;
+
+        // All TagValueDictionary ids checked by ContainsAdditional conditions
+        QSet<uint32_t> _additionalTypeIds;
+    public:
+        virtual ~RasterizationRulesetProgram();
+
+        static std::shared_ptr<RasterizationRulesetProgram> compile(const QMap< uint64_t, std::shared_ptr<RasterizationRule> >& rules);
+
+    friend class OsmAnd::RasterizationStyleEvaluator;
+    };
+
+} // namespace OsmAnd
+
+#endif // __RASTERIZATION_RULESET_PROGRAM_H_
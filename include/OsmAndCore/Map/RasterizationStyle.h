@@ -32,6 +32,8 @@
 #include <QXmlStreamReader>
 #include <QHash>
 #include <QMap>
+#include <QMutex>
+#include <QVector>
 
 #include <OsmAndCore.h>
 
@@ -40,6 +42,8 @@ namespace OsmAnd {
     class RasterizationStyles;
     class RasterizationStyle;
     class RasterizationRule;
+    class RasterizationStyleEvaluator;
+    class RasterizationRulesetProgram;
 
     class OSMAND_CORE_API RasterizationStyle
     {
@@ -77,7 +81,9 @@ namespace OsmAnd {
             };
         private:
         protected:
-            ValueDefinition(ValueDefinition::Type type, ValueDefinition::DataType dataType, const QString& name);
+            ValueDefinition(ValueDefinition::Type type, ValueDefinition::DataType dataType, const QString& name, uint32_t id);
+
+            uint32_t _id;
         public:
             virtual ~ValueDefinition();
 
@@ -85,9 +91,20 @@ namespace OsmAnd {
             const DataType dataType;
             const QString name;
 
+            // Dense index of definition, unique within style and styles it inherits
+            const uint32_t& id;
+
         friend class OsmAnd::RasterizationStyle;
         };
 
+        // Ids of tag and value strings of a map object type in strings table of the style.
+        // If string is not used by the style at all, id is invalid and matches nothing.
+        struct TypeStringIds
+        {
+            uint32_t tagId;
+            uint32_t valueId;
+        };
+
         class OSMAND_CORE_API ConfigurableInputValue : public ValueDefinition
         {
         private:
@@ -111,6 +128,8 @@ namespace OsmAnd {
         std::shared_ptr<ValueDefinition> registerValue(ValueDefinition* pValueDefinition);
         QHash< QString, std::shared_ptr<ValueDefinition> > _valuesDefinitions;
         uint32_t _firstNonBuiltinValueDefinitionIndex;
+        uint32_t _valueDefinitionsCount;
+        static uint32_t _builtinValueDefinitionsCount;
 
         bool registerRule(RulesetType type, const std::shared_ptr<RasterizationRule>& rule);
 
@@ -149,12 +168,23 @@ namespace OsmAnd {
 
         std::shared_ptr<RasterizationRule> createTagValueRootWrapperRule(uint64_t id, const std::shared_ptr<RasterizationRule>& rule);
 
+        std::shared_ptr<const RasterizationRulesetProgram> _pointProgram;
+        std::shared_ptr<const RasterizationRulesetProgram> _lineProgram;
+        std::shared_ptr<const RasterizationRulesetProgram> _polygonProgram;
+        std::shared_ptr<const RasterizationRulesetProgram> _textProgram;
+        std::shared_ptr<const RasterizationRulesetProgram> _orderProgram;
+        std::shared_ptr<const RasterizationRulesetProgram>& obtainProgram(RulesetType type);
+        bool compileRulesets();
+
         uint32_t _stringsIdBase;
         QList< QString > _stringsLUT;
         QHash< QString, uint32_t > _stringsRevLUT;
         uint32_t lookupStringId(const QString& value);
         uint32_t registerString(const QString& value);
 
+        QMutex _typesStringIdsMutex;
+        std::shared_ptr< const QVector<TypeStringIds> > _typesStringIds;
+
         uint32_t getTagStringId(uint64_t ruleId) const;
         uint32_t getValueStringId(uint64_t ruleId) const;
         const QString& getTagString(uint64_t ruleId) const;
@@ -175,12 +205,17 @@ namespace OsmAnd {
 
         const QString& name;
         const QString& parentName;
+
+        // Ids of all value definitions that may be used in this style are below this count
+        const uint32_t& valueDefinitionsCount;
         
         bool isStandalone() const;
         bool areDependenciesResolved() const;
 
         const QMap< uint64_t, std::shared_ptr<RasterizationRule> >& obtainRules(RulesetType type) const;
         static uint64_t encodeRuleId(uint32_t tag, uint32_t value);
+        // Compiled form of ruleset, that is present once style is completely loaded
+        const std::shared_ptr<const RasterizationRulesetProgram>& obtainProgram(RulesetType type) const;
 
         bool resolveValueDefinition(const QString& name, std::shared_ptr<ValueDefinition>& outDefinition);
         bool resolveAttribute(const QString& name, std::shared_ptr<RasterizationRule>& outAttribute);
@@ -248,14 +283,19 @@ namespace OsmAnd {
             friend class OsmAnd::RasterizationStyle;
         } builtinValueDefinitions;
 
-        bool lookupStringId(const QString& value, uint32_t& id);
+        // Read-only, so it's safe to use from any thread once style is loaded
+        bool lookupStringId(const QString& value, uint32_t& id) const;
         const QString& lookupStringValue(uint32_t id) const;
 
+        // Returns table indexed by TagValueDictionary id that covers at least given id
+        std::shared_ptr< const QVector<TypeStringIds> > obtainTypesStringIds(uint32_t typeId);
+
         void dump(const QString& prefix = QString()) const;
         void dump(RulesetType type, const QString& prefix = QString()) const;
 
     friend class OsmAnd::RasterizationStyles;
     friend class OsmAnd::RasterizationRule;
+    friend class OsmAnd::RasterizationStyleEvaluator;
     };
 
 
@@ -26,7 +26,12 @@
 #include <stdint.h>
 #include <memory>
 
-#include <QMap>
+#include <QVector>
+#include <QBitArray>
+#include <QHash>
+#include <QCache>
+#include <QPair>
+#include <QByteArray>
 
 #include <OsmAndCore.h>
 #include <OsmAndCore/Map/RasterizationStyle.h>
@@ -38,22 +43,52 @@ namespace OsmAnd {
         class MapObject;
     }
     class RasterizationRule;
+    class RasterizationRulesetProgram;
 
     class OSMAND_CORE_API RasterizationStyleEvaluator
     {
     private:
     protected:
-        QMap< OsmAnd::RasterizationStyle::ValueDefinition*, OsmAnd::RasterizationRule::Value > _values;
-        
-        bool evaluate(uint32_t tagKey, uint32_t valueKey, bool fillOutput, bool evaluateChildren);
+        std::shared_ptr<OsmAnd::Model::MapObject> _mapObject;
+
+        // Values are indexed by id of value definition. Value that is not marked as set reads as zero.
+        QVector< OsmAnd::RasterizationRule::Value > _values;
+        QBitArray _valuesSetMask;
+        const OsmAnd::RasterizationRule::Value& readValue(uint32_t id) const;
+        void writeValue(uint32_t id, const OsmAnd::RasterizationRule::Value& value);
+
+        bool evaluate(uint32_t tagKey, uint32_t valueKey, bool fillOutput, bool evaluateChildren, bool interpretRules);
         bool evaluate(const std::shared_ptr<OsmAnd::RasterizationRule>& rule, bool fillOutput, bool evaluateChildren);
+        bool evaluate(const RasterizationRulesetProgram& program, uint32_t nodeIndex, bool fillOutput, bool evaluateChildren);
+
+        QByteArray calculateSignature() const;
     public:
+        // Least-recently-used evaluation results keyed by signature of evaluator state before evaluation.
+        // Each entry holds only values that were written by evaluation, that is outputs of matched rules.
+        struct OSMAND_CORE_API ResultsCache
+        {
+            struct Entry
+            {
+                bool result;
+                QVector< QPair<uint32_t, OsmAnd::RasterizationRule::Value> > writtenValues;
+            };
+
+            // Capacity is measured in stored values
+            enum {
+                DefaultCapacity = 64 * 1024,
+            };
+
+            ResultsCache();
+
+            QCache< QByteArray, Entry > entries;
+        };
+
         RasterizationStyleEvaluator(const std::shared_ptr<RasterizationStyle>& style, RasterizationStyle::RulesetType ruleset, const std::shared_ptr<OsmAnd::Model::MapObject>& mapObject = std::shared_ptr<OsmAnd::Model::MapObject>());
         RasterizationStyleEvaluator(const std::shared_ptr<RasterizationStyle>& style, const std::shared_ptr<RasterizationRule>& singleRule);
         virtual ~RasterizationStyleEvaluator();
 
         const std::shared_ptr<RasterizationStyle> style;
-        const std::shared_ptr<OsmAnd::Model::MapObject> mapObject;
+        const std::shared_ptr<OsmAnd::Model::MapObject>& mapObject;
         const RasterizationStyle::RulesetType ruleset;
         const std::shared_ptr<RasterizationRule> singleRule;
 
@@ -72,7 +107,13 @@ namespace OsmAnd {
 
         void clearValue(const std::shared_ptr<OsmAnd::RasterizationStyle::ValueDefinition>& ref);
 
-        bool evaluate(bool fillOutput = true, bool evaluateChildren = true);
+        // Clears all values, so that evaluator can be reused for another object
+        void reset(const std::shared_ptr<OsmAnd::Model::MapObject>& mapObject = std::shared_ptr<OsmAnd::Model::MapObject>());
+
+        // Compiled form of ruleset is used if style has it, unless rules are explicitly requested to be interpreted
+        bool evaluate(bool fillOutput = true, bool evaluateChildren = true, bool interpretRules = false);
+        // Same as evaluate(), but result is taken from cache if evaluator with same inputs was already evaluated
+        bool evaluate(ResultsCache& cache);
 
         void dump(bool input = true, bool output = true, const QString& prefix = QString()) const;
     };
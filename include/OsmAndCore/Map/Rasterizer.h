@@ -26,6 +26,7 @@
 #include <stdint.h>
 #include <memory>
 
+#include <SkBitmap.h>
 #include <SkCanvas.h>
 #include <SkPaint.h>
 #include <QList>
@@ -34,11 +35,23 @@
 #include <OsmAndCore/Data/Model/MapObject.h>
 #include <OsmAndCore/IQueryController.h>
 #include <OsmAndCore/Map/RasterizationStyleEvaluator.h>
+#include <OsmAndCore/Map/ShapedTextsCache.h>
 
 namespace OsmAnd {
 
     class RasterizerContext;
 
+    // Paths of map object for single scale, relative to origin of the object, so that same paths
+    // are used on all tiles of that zoom level with only a translation applied
+    struct RasterizerCachedGeometry
+    {
+        double pixelDivisor;
+        PointI origin31;
+        AreaI bbox31;
+        SkPath linePath;
+        SkPath polygonPath;
+    };
+
     class OSMAND_CORE_API Rasterizer
     {
     private:
@@ -61,6 +74,7 @@ namespace OsmAnd {
         struct TextPrimitive
         {
             QString content;
+            std::shared_ptr<const ShapedTextsCache::ShapedText> shapedContent;
             bool drawOnPath;
             std::shared_ptr<SkPath> path;
             PointF center;
@@ -72,6 +86,7 @@ namespace OsmAnd {
             bool isBold;
             int minDistance;
             QString shieldResource;
+            std::shared_ptr<const SkBitmap> shield;
             int order;
         };
 
@@ -81,12 +96,29 @@ namespace OsmAnd {
             double zOrder;
             uint32_t typeIndex;
             PrimitiveType objectType;
+
+            // Packed (zOrder, typeIndex, points count), that primitives are ordered by
+            uint64_t sortKey;
+        };
+
+        struct PrimitiveSortEntry
+        {
+            uint64_t key;
+            uint32_t index;
         };
 
         static void obtainPrimitives(RasterizerContext& context, IQueryController* controller);
+        static void sortPrimitives(RasterizerContext& context, QVector< Primitive >& primitives, bool byDescendingArea);
         static void filterOutLinesByDensity(RasterizerContext& context, const QVector< Primitive >& in, QVector< Primitive >& out, IQueryController* controller);
+        // Objects made from coastlines are allocated in the given arena, that lives as long as they do
+        static std::shared_ptr<OsmAnd::Model::MapObject> createCoastlineObject(
+            const std::shared_ptr<OsmAnd::Model::MapObjectsArena>& arena,
+            const QVector< PointI >& points31,
+            uint32_t typeId
+            );
         static bool polygonizeCoastlines(
             RasterizerContext& context,
+            const std::shared_ptr<OsmAnd::Model::MapObjectsArena>& arena,
             const QList< std::shared_ptr<OsmAnd::Model::MapObject> >& coastlines,
             QList< std::shared_ptr<OsmAnd::Model::MapObject> >& outVectorized,
             bool abortIfBrokenCoastlinesExist,
@@ -112,6 +144,7 @@ namespace OsmAnd {
             Points,
         };
         static void rasterizeMapPrimitives(RasterizerContext& context, SkCanvas& canvas, const QVector< Primitive >& primitives, PrimitivesType type, IQueryController* controller);
+        static void rasterizeMapIcons(RasterizerContext& context, SkCanvas& canvas, IQueryController* controller);
         enum PaintValuesSet : int
         {
             Set_0 = 0,
@@ -131,8 +164,29 @@ namespace OsmAnd {
         static void collectPolygonText(RasterizerContext& context, const Primitive& primitive);
         static void collectLineText(RasterizerContext& context, const Primitive& primitive);
         static void collectPointText(RasterizerContext& context, const Primitive& primitive);
+        static bool obtainPointCenter(RasterizerContext& context, const Primitive& primitive, PointF& center);
         static void preparePrimitiveText(RasterizerContext& context, const Primitive& primitive, const PointF& point, SkPath* path);
 
+        enum {
+            TextCollisionGridCellSize = 64,
+        };
+        static bool calculateTextBounds(RasterizerContext& context, const TextPrimitive& text, const SkPaint::FontMetrics& fontMetrics, float& outHOffset, QVector< SkRect >& outBounds);
+        static SkRect obtainShieldRect(RasterizerContext& context, const TextPrimitive& text);
+        static void drawText(RasterizerContext& context, SkCanvas& canvas, const TextPrimitive& text, const SkPaint::FontMetrics& fontMetrics, float hOffset);
+
+        enum {
+            // Geometry is clipped only if it's that many times larger than clipping area in any dimension
+            ClippingSizeRatioThreshold = 2,
+            // Clipping area is aligned to cells of that many tiles and extended by a tile, so that clipped
+            // geometry is cached once for all tiles of a cell
+            ClippingCellSizeInTiles = 4,
+        };
+        static float obtainPaintMargin(RasterizerContext& context, const RasterizationStyleEvaluator& evaluator);
+        static bool isClippingAllowed(const RasterizationStyleEvaluator& evaluator);
+        static std::shared_ptr<const RasterizerCachedGeometry> obtainGeometry(RasterizerContext& context, const std::shared_ptr<OsmAnd::Model::MapObject>& mapObject);
+        static std::shared_ptr<const RasterizerCachedGeometry> obtainGeometry(RasterizerContext& context, const std::shared_ptr<OsmAnd::Model::MapObject>& mapObject, bool asPolygon, float clippingMargin);
+        static bool translateToGeometry(RasterizerContext& context, SkCanvas& canvas, const RasterizerCachedGeometry& geometry, const SkPath& path, float paintMargin);
+
         static void calculateVertex(RasterizerContext& context, const PointI& point, PointF& vertex);
         static bool contains(const QVector< PointF >& vertices, const PointF& other);
     public:
@@ -28,13 +28,16 @@
 
 #include <QMap>
 
+#include <SkMatrix.h>
 #include <SkPaint.h>
 #include <SkPathEffect.h>
 
 #include <OsmAndCore.h>
 #include <OsmAndCore/Map/RasterizationStyle.h>
 #include <OsmAndCore/Map/RasterizationRule.h>
+#include <OsmAndCore/Map/RasterizationStyleEvaluator.h>
 #include <OsmAndCore/Map/Rasterizer.h>
+#include <OsmAndCore/Map/RasterizerGeometriesCache.h>
 #include <OsmAndCore/CommonTypes.h>
 
 namespace OsmAnd {
@@ -63,8 +66,13 @@ namespace OsmAnd {
         QList< std::shared_ptr<OsmAnd::Model::MapObject> > _combinedMapObjects, _triangulatedCoastlineObjects;
         QVector< Rasterizer::Primitive > _polygons, _lines, _points;
         QVector< Rasterizer::TextPrimitive > _texts;
+        QVector< Rasterizer::PrimitiveSortEntry > _primitivesSortEntries, _primitivesSortBuffer;
 
         SkPaint _mapPaint;
+        // Shader pattern placement relative to the canvas, before translation to the rasterized object
+        SkMatrix _mapPaintShaderMatrix;
+        // Translation of the canvas to the rasterized object, that shader of any paint set up for it is compensated by
+        PointF _mapPaintOffset;
         uint32_t _defaultBgColor;
         uint32_t _shadowLevelMin;
         uint32_t _shadowLevelMax;
@@ -75,6 +83,11 @@ namespace OsmAnd {
         uint32_t _shadowRenderingColor;
 
         const QMap< std::shared_ptr<RasterizationStyle::ValueDefinition>, RasterizationRule::Value > _styleInitialSettings;
+        std::shared_ptr< const QVector<RasterizationStyle::TypeStringIds> > _typesStringIds;
+        // Bounded, and reset on zoom change
+        RasterizationStyleEvaluator::ResultsCache _evaluationResultsCache;
+        // May be shared with other contexts
+        const std::shared_ptr<RasterizerGeometriesCache> _geometriesCache;
 
         std::shared_ptr<RasterizationRule> attributeRule_defaultColor;
         std::shared_ptr<RasterizationRule> attributeRule_shadowRendering;
@@ -93,15 +106,17 @@ namespace OsmAnd {
         SkPathEffect* obtainPathEffect(const QString& pathEffect);
 
         SkPaint _textPaint;
+        SkPaint _shieldPaint;
         std::shared_ptr<SkTypeface> _textFont;
     public:
         RasterizerContext(const std::shared_ptr<RasterizationStyle>& style);
-        RasterizerContext(const std::shared_ptr<RasterizationStyle>& style, const QMap< std::shared_ptr<RasterizationStyle::ValueDefinition>, RasterizationRule::Value >& styleInitialSettings);
+        RasterizerContext(const std::shared_ptr<RasterizationStyle>& style, const QMap< std::shared_ptr<RasterizationStyle::ValueDefinition>, RasterizationRule::Value >& styleInitialSettings, const std::shared_ptr<RasterizerGeometriesCache>& geometriesCache = std::shared_ptr<RasterizerGeometriesCache>());
         virtual ~RasterizerContext();
 
         const std::shared_ptr<RasterizationStyle> style;
 
         void applyTo(RasterizationStyleEvaluator& evaluator) const;
+        void applyTypeTo(RasterizationStyleEvaluator& evaluator, uint32_t typeId);
 
     friend class Rasterizer;
     };
@@ -0,0 +1,110 @@
+/**
+* @file
+*
+* @section LICENSE
+*
+* OsmAnd - Android navigation software based on OSM maps.
+* Copyright (C) 2010-2013  OsmAnd Authors listed in AUTHORS file
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef __RASTERIZER_GEOMETRIES_CACHE_H_
+#define __RASTERIZER_GEOMETRIES_CACHE_H_
+
+#include <stdint.h>
+#include <memory>
+
+#include <QMutex>
+#include <QCache>
+
+#include <OsmAndCore.h>
+#include <OsmAndCore/CommonTypes.h>
+#include <OsmAndCore/Data/Model/MapObject.h>
+#include <OsmAndCore/Map/Rasterizer.h>
+
+namespace OsmAnd {
+
+    class ObfMapSection;
+
+    // Least-recently-used cache of paths that Rasterizer has built for map objects, keyed by object and scale,
+    // and for clipped paths also by area they were clipped to. It's shared by all contexts of a TilesRasterizer,
+    // so that geometry of an object is built once per scale for all tiles that it covers.
+    class OSMAND_CORE_API RasterizerGeometriesCache
+    {
+    public:
+        enum class Kind
+        {
+            Unclipped,
+            ClippedLine,
+            ClippedPolygon,
+        };
+    private:
+        RasterizerGeometriesCache(const RasterizerGeometriesCache& that);
+    protected:
+        struct Key
+        {
+            const ObfMapSection* section;
+            uint64_t objectId;
+            double pixelDivisor;
+            Kind kind;
+            AreaI clipArea31;
+
+            inline bool operator==(const Key& that) const
+            {
+                return
+                    objectId == that.objectId &&
+                    section == that.section &&
+                    pixelDivisor == that.pixelDivisor &&
+                    kind == that.kind &&
+                    clipArea31 == that.clipArea31;
+            }
+
+            friend inline uint qHash(const Key& key)
+            {
+                auto hash = ::qHash(key.objectId);
+                hash = hash * 31 + ::qHash(reinterpret_cast<quintptr>(key.section));
+                hash = hash * 31 + ::qHash(static_cast<quint64>(key.pixelDivisor * 16.0));
+                hash = hash * 31 + static_cast<uint>(key.kind);
+                hash = hash * 31 + static_cast<uint>(key.clipArea31.left) + static_cast<uint>(key.clipArea31.top) * 7;
+                return hash;
+            }
+        };
+
+        static bool makeKey(const std::shared_ptr<const Model::MapObject>& mapObject, double pixelDivisor, Kind kind, const AreaI& clipArea31, Key& outKey);
+
+        QMutex _mutex;
+        QCache< Key, std::shared_ptr<const RasterizerCachedGeometry> > _cache;
+    public:
+        enum {
+            // Capacity is measured in points of cached paths
+            DefaultCapacity = 4 * 1024 * 1024,
+        };
+
+        RasterizerGeometriesCache(const uint32_t capacity = DefaultCapacity);
+        virtual ~RasterizerGeometriesCache();
+
+        // Objects that do not come from map sections, like coastline polygons built for single area, are never cached
+        std::shared_ptr<const RasterizerCachedGeometry> obtain(const std::shared_ptr<const Model::MapObject>& mapObject, double pixelDivisor, Kind kind, const AreaI& clipArea31 = AreaI());
+        void insert(const std::shared_ptr<const Model::MapObject>& mapObject, double pixelDivisor, Kind kind, const AreaI& clipArea31, const std::shared_ptr<const RasterizerCachedGeometry>& geometry);
+
+        uint32_t getCapacity();
+        void setCapacity(const uint32_t capacity);
+        void clear();
+    };
+
+} // namespace OsmAnd
+
+#endif // __RASTERIZER_GEOMETRIES_CACHE_H_
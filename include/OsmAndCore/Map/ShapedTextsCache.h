@@ -0,0 +1,70 @@
+/**
+* @file
+*
+* @section LICENSE
+*
+* OsmAnd - Android navigation software based on OSM maps.
+* Copyright (C) 2010-2013  OsmAnd Authors listed in AUTHORS file
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __SHAPED_TEXTS_CACHE_H_
+#define __SHAPED_TEXTS_CACHE_H_
+
+#include <stdint.h>
+#include <memory>
+
+#include <QString>
+#include <QVector>
+
+#include <SkPaint.h>
+#include <SkRect.h>
+
+#include <OsmAndCore.h>
+
+namespace OsmAnd {
+
+    // Process-wide least-recently-used cache of texts converted to glyph runs and measured,
+    // keyed by text, typeface, size and boldness of the paint. Same names repeat across tiles
+    // and zoom levels, so these are shaped once and shared by all rasterizer contexts.
+    class OSMAND_CORE_API ShapedTextsCache
+    {
+    public:
+        struct ShapedText
+        {
+            QVector<uint16_t> glyphs;
+
+            // Advance and ink bounds of each glyph, bounds are relative to origin of that glyph on the baseline
+            QVector<SkScalar> advances;
+            QVector<SkRect> glyphsBounds;
+
+            // Width of entire run and its ink bounds relative to start of the run on the baseline
+            SkScalar width;
+            SkRect bounds;
+        };
+    private:
+        ShapedTextsCache();
+    public:
+        // Returned text is immutable and stays valid after it has been evicted from the cache
+        static std::shared_ptr<const ShapedText> obtain(const SkPaint& paint, const QString& text);
+
+        // Capacity is measured in glyphs
+        static uint32_t getCapacity();
+        static void setCapacity(const uint32_t capacity);
+    };
+
+} // namespace OsmAnd
+
+#endif // __SHAPED_TEXTS_CACHE_H_
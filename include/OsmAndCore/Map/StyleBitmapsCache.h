@@ -0,0 +1,67 @@
+/**
+* @file
+*
+* @section LICENSE
+*
+* OsmAnd - Android navigation software based on OSM maps.
+* Copyright (C) 2010-2013  OsmAnd Authors listed in AUTHORS file
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __STYLE_BITMAPS_CACHE_H_
+#define __STYLE_BITMAPS_CACHE_H_
+
+#include <stdint.h>
+#include <memory>
+
+#include <QString>
+
+#include <OsmAndCore.h>
+
+class SkBitmap;
+
+namespace OsmAnd {
+
+    // Process-wide cache of icons, shader patterns and text shields referenced by rasterization styles.
+    // Each resource is decoded from EmbeddedResources ("map/icons/<name>.png", "map/shaders/<name>.png" or
+    // "map/shields/<name>.png") and scaled to density only once, and is stored in one of few shared atlas
+    // bitmaps. Returned bitmaps are subsets of these atlases that hold a reference to atlas pixels, so they
+    // remain valid after the cache has been cleared.
+    class OSMAND_CORE_API StyleBitmapsCache
+    {
+    public:
+        enum class Kind
+        {
+            Icon,
+            Shader,
+            Shield,
+        };
+    private:
+        StyleBitmapsCache();
+    public:
+        enum {
+            AtlasSize = 1024,
+            // Bitmaps larger than this in any dimension are not packed into atlases
+            AtlasedBitmapMaxSize = AtlasSize / 4,
+        };
+
+        // Returns nullptr if there's no such resource or it can not be decoded, that result is cached as well
+        static std::shared_ptr<const SkBitmap> obtain(const Kind kind, const QString& name, const float densityFactor);
+        static void clear();
+    };
+
+} // namespace OsmAnd
+
+#endif // __STYLE_BITMAPS_CACHE_H_
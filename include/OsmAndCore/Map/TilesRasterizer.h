@@ -0,0 +1,110 @@
+/**
+* @file
+*
+* @section LICENSE
+*
+* OsmAnd - Android navigation software based on OSM maps.
+* Copyright (C) 2010-2013  OsmAnd Authors listed in AUTHORS file
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __TILES_RASTERIZER_H_
+#define __TILES_RASTERIZER_H_
+
+#include <stdint.h>
+#include <memory>
+#include <functional>
+
+#include <QList>
+#include <QMap>
+#include <QMutex>
+
+#include <OsmAndCore.h>
+#include <OsmAndCore/CommonTypes.h>
+#include <OsmAndCore/IQueryController.h>
+#include <OsmAndCore/Map/RasterizationStyle.h>
+#include <OsmAndCore/Map/RasterizationRule.h>
+
+class QThreadPool;
+class SkBitmap;
+
+namespace OsmAnd {
+
+    class MapDataCache;
+    class RasterizerContext;
+    class RasterizerGeometriesCache;
+
+    // Renders batches of tiles in parallel. Style is shared by all workers, while each worker
+    // takes its own RasterizerContext from a pool of contexts, so no rasterization state is shared.
+    class OSMAND_CORE_API TilesRasterizer
+    {
+    public:
+        struct Tile
+        {
+            TileId tileId;
+            uint32_t zoom;
+            uint32_t tileSize;
+            float densityFactor;
+        };
+
+        typedef std::function<void (const Tile& tile, const std::shared_ptr<SkBitmap>& bitmap, bool success)> TileRasterizedCallback;
+    private:
+        TilesRasterizer(const TilesRasterizer& that);
+    protected:
+        const std::unique_ptr<QThreadPool> _ownThreadPool;
+        QThreadPool* const _threadPool;
+
+        // Paths of map objects are shared by all contexts, since same objects are rasterized on many tiles
+        const std::shared_ptr<RasterizerGeometriesCache> _geometriesCache;
+
+        QMutex _contextsMutex;
+        QList< std::shared_ptr<RasterizerContext> > _freeContexts;
+        std::shared_ptr<RasterizerContext> obtainContext();
+        void releaseContext(const std::shared_ptr<RasterizerContext>& context);
+
+        bool rasterizeArea(const AreaI& area31, uint32_t zoom, uint32_t tileSize, float densityFactor, uint32_t width, uint32_t height, std::shared_ptr<SkBitmap>& outBitmap, IQueryController* controller);
+    public:
+        TilesRasterizer(
+            const std::shared_ptr<RasterizationStyle>& style,
+            const std::shared_ptr<MapDataCache>& dataCache,
+            const QMap< std::shared_ptr<RasterizationStyle::ValueDefinition>, RasterizationRule::Value >& styleInitialSettings = (QMap< std::shared_ptr<RasterizationStyle::ValueDefinition>, RasterizationRule::Value >()),
+            QThreadPool* threadPool = nullptr);
+        virtual ~TilesRasterizer();
+
+        const std::shared_ptr<RasterizationStyle> style;
+        const std::shared_ptr<MapDataCache> dataCache;
+        const QMap< std::shared_ptr<RasterizationStyle::ValueDefinition>, RasterizationRule::Value > styleInitialSettings;
+
+        // Rasterizes single tile on calling thread
+        bool rasterize(const Tile& tile, std::shared_ptr<SkBitmap>& outBitmap, IQueryController* controller = nullptr);
+
+        // Rasterizes block of metatileSize x metatileSize tiles that starts at given tile on calling thread.
+        // Map objects are obtained and primitives are prepared once for entire block, and labels are placed
+        // over entire block, so ones that cross borders of tiles look the same on both sides. Block is
+        // clipped by edge of the world.
+        bool rasterizeMetatile(const Tile& originTile, uint32_t metatileSize, QMap< TileId, std::shared_ptr<SkBitmap> >& outBitmaps, IQueryController* controller = nullptr);
+
+        // Rasterizes all tiles on the pool and returns once all of them were processed. Callback is
+        // invoked once per entry of tiles, from worker threads and from calling thread, in order of completion.
+        // If metatileSize is greater than 1, tiles are grouped into aligned metatiles and each metatile is
+        // rasterized by single worker. Calling thread rasterizes its share too, so it may be a worker of the pool.
+        void rasterize(const QList<Tile>& tiles, TileRasterizedCallback callback, IQueryController* controller = nullptr, uint32_t metatileSize = 1);
+
+        static AreaI getTileArea31(const TileId& tileId, uint32_t zoom);
+    };
+
+} // namespace OsmAnd
+
+#endif // __TILES_RASTERIZER_H_
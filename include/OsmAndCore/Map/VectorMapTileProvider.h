@@ -0,0 +1,166 @@
+/**
+* @file
+*
+* @section LICENSE
+*
+* OsmAnd - Android navigation software based on OSM maps.
+* Copyright (C) 2010-2013  OsmAnd Authors listed in AUTHORS file
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __VECTOR_MAP_TILE_PROVIDER_H_
+#define __VECTOR_MAP_TILE_PROVIDER_H_
+
+#include <stdint.h>
+#include <memory>
+#include <functional>
+#include <array>
+
+#include <QCache>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QList>
+#include <QMap>
+#include <QMutex>
+#include <QWaitCondition>
+
+#include <OsmAndCore.h>
+#include <OsmAndCore/CommonTypes.h>
+#include <OsmAndCore/Map/IMapBitmapTileProvider.h>
+#include <OsmAndCore/Map/RasterizationStyle.h>
+#include <OsmAndCore/Map/RasterizationRule.h>
+
+class QThreadPool;
+class SkBitmap;
+
+namespace OsmAnd {
+
+    class MapDataCache;
+    class TilesRasterizer;
+
+    // Provides tiles rasterized from OBF data. Each requested tile goes through two stages: map objects
+    // of the tile are loaded into MapDataCache on local storage pool, and then the tile is rasterized on
+    // a pool of rasterization workers, so loading of next tile overlaps rasterization of previous ones.
+    // Duplicate requests are served by single rasterization, tiles that were of recent interest are
+    // processed first, and requests that are no longer of interest are put aside until requested again.
+    // Rasterized tiles are kept in memory, so that they are available immediately next time.
+    class OSMAND_CORE_API VectorMapTileProvider : public IMapBitmapTileProvider
+    {
+    private:
+        VectorMapTileProvider(const VectorMapTileProvider& that);
+    protected:
+        class OSMAND_CORE_API Tile : public IMapBitmapTileProvider::Tile
+        {
+        private:
+            const std::shared_ptr<SkBitmap> _bitmap;
+        protected:
+        public:
+            Tile(const std::shared_ptr<SkBitmap>& bitmap);
+            virtual ~Tile();
+        };
+
+        enum {
+            // Request is considered stale if there was no interest in it for that long, while there was in others
+            StaleRequestTimeout = 1000,
+        };
+
+        enum class RequestState
+        {
+            PendingDataLoading,
+            PendingRasterization,
+            Processing,
+            // Stale request, that is resumed on next interest in its tile
+            Postponed,
+        };
+
+        struct TileRequest
+        {
+            TileId tileId;
+            uint32_t zoom;
+            RequestState state;
+            bool isDataLoaded;
+            qint64 lastInterestTime;
+            QList<TileReadyCallback> callbacks;
+        };
+
+        struct CachedBitmapKey
+        {
+            TileId tileId;
+            uint32_t zoom;
+
+            inline bool operator==(const CachedBitmapKey& that) const
+            {
+                return tileId.id == that.tileId.id && zoom == that.zoom;
+            }
+
+            friend inline uint qHash(const CachedBitmapKey& key)
+            {
+                return ::qHash(key.tileId.id) ^ (key.zoom * 0x9E3779B9u);
+            }
+        };
+
+        const std::unique_ptr<QThreadPool> _rasterizationPool;
+        const std::unique_ptr<TilesRasterizer> _rasterizer;
+
+        QElapsedTimer _interestTimer;
+        QMutex _requestsMutex;
+        QWaitCondition _tasksFinishedCondition;
+        std::array< QHash< TileId, std::shared_ptr<TileRequest> >, 32 > _requests;
+        QList< std::shared_ptr<TileRequest> > _pendingDataLoading;
+        QList< std::shared_ptr<TileRequest> > _pendingRasterization;
+        qint64 _lastInterestTime;
+        // Read without lock by rasterization controllers
+        volatile uint32_t _lastInterestZoom;
+        uint32_t _tasksCount;
+        volatile bool _isDestroying;
+
+        QMutex _bitmapsCacheMutex;
+        QCache< CachedBitmapKey, std::shared_ptr<SkBitmap> > _bitmapsCache;
+
+        void registerInterest(const std::shared_ptr<TileRequest>& request);
+        void schedule(const std::shared_ptr<TileRequest>& request);
+        std::shared_ptr<TileRequest> takeNextRequest(QList< std::shared_ptr<TileRequest> >& pendingRequests);
+        bool isStale(const TileRequest& request) const;
+
+        void processDataLoading();
+        void processRasterization();
+        void completeRequest(const std::shared_ptr<TileRequest>& request, const std::shared_ptr<SkBitmap>& bitmap, bool success);
+        void finishTask();
+
+        std::shared_ptr<SkBitmap> obtainCachedBitmap(const TileId& tileId, uint32_t zoom);
+    public:
+        VectorMapTileProvider(
+            const std::shared_ptr<RasterizationStyle>& style,
+            const std::shared_ptr<MapDataCache>& dataCache,
+            const QMap< std::shared_ptr<RasterizationStyle::ValueDefinition>, RasterizationRule::Value >& styleInitialSettings = (QMap< std::shared_ptr<RasterizationStyle::ValueDefinition>, RasterizationRule::Value >()),
+            uint32_t tileSize = 256,
+            float densityFactor = 1.0f,
+            size_t bitmapsCacheMemoryLimit = 64 * 1024 * 1024);
+        virtual ~VectorMapTileProvider();
+
+        const std::shared_ptr<MapDataCache> dataCache;
+        const uint32_t tileSize;
+        const float densityFactor;
+
+        virtual float getTileDensity() const;
+        virtual uint32_t getTileSize() const;
+
+        virtual bool obtainTileImmediate(const TileId& tileId, uint32_t zoom, std::shared_ptr<IMapTileProvider::Tile>& tile);
+        virtual void obtainTileDeffered(const TileId& tileId, uint32_t zoom, TileReadyCallback readyCallback);
+    };
+
+} // namespace OsmAnd
+
+#endif // __VECTOR_MAP_TILE_PROVIDER_H_
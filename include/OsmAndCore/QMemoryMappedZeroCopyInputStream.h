@@ -0,0 +1,93 @@
+/**
+ * @file
+ *
+ * @section LICENSE
+ *
+ * OsmAnd - Android navigation software based on OSM maps.
+ * Copyright (C) 2010-2013  OsmAnd Authors listed in AUTHORS file
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __Q_MEMORY_MAPPED_ZERO_COPY_INPUT_STREAM_H_
+#define __Q_MEMORY_MAPPED_ZERO_COPY_INPUT_STREAM_H_
+
+#include <memory>
+
+#include <QFileDevice>
+
+#include <OsmAndCore.h>
+#include <google/protobuf/io/zero_copy_stream.h>
+
+namespace OsmAnd {
+
+    namespace gpb = google::protobuf;
+
+    /**
+    Implementation of zero-copy input stream for Google Protobuf via memory-mapped QFileDevice.
+    Pointers returned by Next() point directly into mapped file, so no data is copied.
+    Mapped data is never modified, so clones of a stream can read same file concurrently.
+    */
+    class OSMAND_CORE_API QMemoryMappedZeroCopyInputStream : public gpb::io::ZeroCopyInputStream
+    {
+    private:
+        GOOGLE_DISALLOW_EVIL_CONSTRUCTORS(QMemoryMappedZeroCopyInputStream);
+
+        //! Mapping of file, shared between all streams cloned from same original stream
+        struct Mapping
+        {
+            Mapping(const std::shared_ptr<QFileDevice>& file);
+            ~Mapping();
+
+            //! Pointer to file device
+            const std::shared_ptr<QFileDevice> file;
+
+            //! Should close on destruction?
+            const bool closeOnDestruction;
+
+            //! Mapped data
+            uchar* data;
+
+            //! Size of mapped data
+            qint64 size;
+        };
+        const std::shared_ptr<const Mapping> _mapping;
+
+        //! Current position in mapped data
+        qint64 _position;
+
+        QMemoryMappedZeroCopyInputStream(const std::shared_ptr<const Mapping>& mapping);
+    protected:
+    public:
+        //! Ctor
+        QMemoryMappedZeroCopyInputStream(const std::shared_ptr<QFileDevice>& file);
+
+        //! Dtor
+        virtual ~QMemoryMappedZeroCopyInputStream();
+
+        //! Returns true if file was mapped successfully and stream is usable
+        bool isMapped() const;
+
+        //! Creates new stream positioned at start of the same mapping. Streams may be used from different threads
+        QMemoryMappedZeroCopyInputStream* clone() const;
+
+        virtual bool Next(const void** data, int* size);
+        virtual void BackUp(int count);
+        virtual bool Skip(int count);
+        virtual gpb::int64 ByteCount() const;
+    };
+
+} // namespace OsmAnd
+
+#endif // __Q_MEMORY_MAPPED_ZERO_COPY_INPUT_STREAM_H_
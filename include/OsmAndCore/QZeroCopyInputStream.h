@@ -52,6 +52,9 @@ namespace OsmAnd {
         enum {
             BufferSize = 4096,
         };
+
+        //! Buffer that is handed out by Next(), valid until next call
+        char _buffer[BufferSize];
     protected:
     public:
         //! Ctor
@@ -79,6 +79,13 @@ namespace OsmAnd {
         OSMAND_CORE_API int OSMAND_CORE_CALL javaDoubleCompare(double l, double r);
         OSMAND_CORE_API void OSMAND_CORE_CALL findFiles(const QDir& origin, const QStringList& masks, QList< std::shared_ptr<QFileInfo> >& files, bool recursively = true);
         OSMAND_CORE_API double OSMAND_CORE_CALL polygonArea(const QVector<OsmAnd::PointI>& points);
+        OSMAND_CORE_API double OSMAND_CORE_CALL polygonArea(const OsmAnd::PointI* pPoints, const int pointsCount);
+        OSMAND_CORE_API void OSMAND_CORE_CALL simplifyPolyline(const QVector<OsmAnd::PointI>& points, const int64_t tolerance, QVector<OsmAnd::PointI>& outPoints);
+        OSMAND_CORE_API void OSMAND_CORE_CALL simplifyPolyline(const OsmAnd::PointI* pPoints, const int pointsCount, const int64_t tolerance, QVector<OsmAnd::PointI>& outPoints);
+        OSMAND_CORE_API void OSMAND_CORE_CALL clipPolyline(const QVector<OsmAnd::PointI>& points, const OsmAnd::AreaI& area, QList< QVector<OsmAnd::PointI> >& outPolylines);
+        OSMAND_CORE_API void OSMAND_CORE_CALL clipPolyline(const OsmAnd::PointI* pPoints, const int pointsCount, const OsmAnd::AreaI& area, QList< QVector<OsmAnd::PointI> >& outPolylines);
+        OSMAND_CORE_API void OSMAND_CORE_CALL clipPolygon(const QVector<OsmAnd::PointI>& points, const OsmAnd::AreaI& area, QVector<OsmAnd::PointI>& outPoints);
+        OSMAND_CORE_API void OSMAND_CORE_CALL clipPolygon(const OsmAnd::PointI* pPoints, const int pointsCount, const OsmAnd::AreaI& area, QVector<OsmAnd::PointI>& outPoints);
         OSMAND_CORE_API bool OSMAND_CORE_CALL rayIntersectX(const OsmAnd::PointF& v0, const OsmAnd::PointF& v1, float mY, float& mX);
         OSMAND_CORE_API bool OSMAND_CORE_CALL rayIntersect(const OsmAnd::PointF& v0, const OsmAnd::PointF& v1, const OsmAnd::PointF& v);
         OSMAND_CORE_API bool OSMAND_CORE_CALL rayIntersectX(const OsmAnd::PointI& v0, const OsmAnd::PointI& v1, int32_t mY, int32_t& mX);
@@ -1,9 +1,11 @@
 #include "MapObject.h"
 
 #include "ObfMapSection.h"
+#include "TagValueDictionary.h"
 
-OsmAnd::Model::MapObject::MapObject(ObfMapSection* section_)
-    : _id(std::numeric_limits<uint64_t>::max())
+OsmAnd::Model::MapObject::MapObject(ObfMapSection* section_, const MapObjectsArena* arena)
+    : _arena(arena)
+    , _id(std::numeric_limits<uint64_t>::max())
     , _foundation(Unknown)
     , section(section_)
     , id(_id)
@@ -17,33 +19,65 @@ OsmAnd::Model::MapObject::~MapObject()
 {
 }
 
+std::shared_ptr<OsmAnd::Model::MapObject> OsmAnd::Model::MapObject::create( ObfMapSection* section, const std::shared_ptr<MapObjectsArena>& arena )
+{
+    const auto pStorage = arena->allocate(sizeof(MapObject), std::alignment_of<MapObject>::value);
+    const auto pMapObject = new(pStorage) MapObject(section, arena.get());
+    return std::shared_ptr<MapObject>(pMapObject,
+        [arena](MapObject* pObject)
+        {
+            pObject->~MapObject();
+        },
+        MapObjectsArena::Allocator<MapObject>(arena));
+}
+
+const QString& OsmAnd::Model::MapObject::getNameTag( const Name& name ) const
+{
+    return TagValueDictionary::resolve(name.tagId).tag;
+}
+
+const QString& OsmAnd::Model::MapObject::getNameValue( const Name& name ) const
+{
+    return _arena->getString(name.stringId);
+}
+
+QHash<QString, QString> OsmAnd::Model::MapObject::getNames() const
+{
+    QHash<QString, QString> names;
+    for(auto itName = _names.cbegin(); itName != _names.cend(); ++itName)
+        names.insert(getNameTag(*itName), getNameValue(*itName));
+    return names;
+}
+
 int OsmAnd::Model::MapObject::getSimpleLayerValue() const
 {
     auto isTunnel = false;
     auto isBridge = false;
     for(auto itType = _extraTypes.begin(); itType != _extraTypes.end(); ++itType)
     {
-        const auto& type = *itType;
+        const auto& typeId = *itType;
+        const auto tagId = TagValueDictionary::resolveTagId(typeId);
 
-        if (type.tag == "layer")
+        if (tagId == TagValueDictionary::LayerTag)
         {
-            if(!type.value.isEmpty())
+            const auto& value = TagValueDictionary::resolve(typeId).value;
+            if(!value.isEmpty())
             {
-                if(type.value[0] == '-')
+                if(value[0] == '-')
                     return -1;
-                else if (type.value[0] == '0')
+                else if (value[0] == '0')
                     return 0;
                 else
                     return 1;
             }
         }
-        else if (type.tag == "tunnel")
+        else if (tagId == TagValueDictionary::TunnelTag)
         {
-            isTunnel = (type.value == "yes");
+            isTunnel = (typeId == TagValueDictionary::TunnelYes);
         }
-        else if (type.tag == "bridge")
+        else if (tagId == TagValueDictionary::BridgeTag)
         {
-            isBridge = (type.value == "yes");
+            isBridge = (typeId == TagValueDictionary::BridgeYes);
         }
     }
 
@@ -71,29 +105,37 @@ bool OsmAnd::Model::MapObject::isClosedFigure(bool checkInner /*= false*/) const
         return true;
     }
     else
-        return _points31.first() == _points31.last();
+        return !_points31.isEmpty() && _points31.first() == _points31.last();
 }
 
-bool OsmAnd::Model::MapObject::containsType( const QString& tag, const QString& value, bool checkAdditional /*= false*/ ) const
+bool OsmAnd::Model::MapObject::containsType( const uint32_t typeId, bool checkAdditional /*= false*/ ) const
 {
     const auto& types = (checkAdditional ? _extraTypes : _types);
     for(auto itType = types.begin(); itType != types.end(); ++itType)
     {
-        const auto& type = *itType;
-        if(type.tag == tag && type.value == value)
+        if(*itType == typeId)
             return true;
     }
     return false;
 }
 
+bool OsmAnd::Model::MapObject::containsType( const QString& tag, const QString& value, bool checkAdditional /*= false*/ ) const
+{
+    // Pair that was never interned can't be present in any object
+    uint32_t typeId;
+    if(!TagValueDictionary::lookupId(tag, value, typeId))
+        return false;
+    return containsType(typeId, checkAdditional);
+}
+
 size_t OsmAnd::Model::MapObject::calculateApproxConsumedMemory() const
 {
+    // Values of names are in string table of the arena, that is shared by objects of one data block
     size_t res = sizeof(MapObject) + _points31.size() * sizeof(PointI);
-    for(auto itPolygon = _innerPolygonsPoints31.begin(); itPolygon != _innerPolygonsPoints31.end(); ++itPolygon)
-    {
-        const auto& polygon = *itPolygon;
-
-        res += polygon.size() * sizeof(PointI);
-    }
+    res += _innerPolygonsPoints31.size() * sizeof(ArenaArray< PointI >);
+    for(auto itPolygon = _innerPolygonsPoints31.cbegin(); itPolygon != _innerPolygonsPoints31.cend(); ++itPolygon)
+        res += itPolygon->size() * sizeof(PointI);
+    res += (_types.size() + _extraTypes.size()) * sizeof(uint32_t);
+    res += _names.size() * sizeof(Name);
     return res;
 }
@@ -0,0 +1,69 @@
+#include "MapObjectsArena.h"
+
+OsmAnd::Model::MapObjectsArena::MapObjectsArena( const size_t blockSize_ /*= DefaultBlockSize*/ )
+    : _blockSize(blockSize_)
+    , _blockUsed(0)
+    , _allocatedMemory(0)
+    , allocatedMemory(_allocatedMemory)
+{
+}
+
+OsmAnd::Model::MapObjectsArena::~MapObjectsArena()
+{
+}
+
+void* OsmAnd::Model::MapObjectsArena::allocate( const size_t size, const size_t alignment )
+{
+    if(!_blocks.isEmpty())
+    {
+        auto& block = _blocks.last();
+
+        const auto blockStart = reinterpret_cast<uintptr_t>(block.data());
+        const auto alignedStart = (blockStart + _blockUsed + alignment - 1) & ~static_cast<uintptr_t>(alignment - 1);
+        if(alignedStart + size <= blockStart + block.size())
+        {
+            _blockUsed = alignedStart + size - blockStart;
+            return reinterpret_cast<void*>(alignedStart);
+        }
+    }
+
+    // Objects larger than block size get a block of their own
+    const auto newBlockSize = qMax(_blockSize, size + alignment);
+    _blocks.push_back(QByteArray(static_cast<int>(newBlockSize), Qt::Uninitialized));
+    _allocatedMemory += newBlockSize;
+
+    auto& block = _blocks.last();
+    const auto blockStart = reinterpret_cast<uintptr_t>(block.data());
+    const auto alignedStart = (blockStart + alignment - 1) & ~static_cast<uintptr_t>(alignment - 1);
+    _blockUsed = alignedStart + size - blockStart;
+    return reinterpret_cast<void*>(alignedStart);
+}
+
+uint32_t OsmAnd::Model::MapObjectsArena::appendStrings( const QStringList& strings )
+{
+    const auto firstId = static_cast<uint32_t>(_strings.size());
+    for(auto itString = strings.cbegin(); itString != strings.cend(); ++itString)
+    {
+        const auto& string = *itString;
+
+        _strings.push_back(string);
+        _allocatedMemory += sizeof(QString) + string.size() * sizeof(QChar);
+    }
+    return firstId;
+}
+
+uint32_t OsmAnd::Model::MapObjectsArena::appendString( const QString& string )
+{
+    const auto id = static_cast<uint32_t>(_strings.size());
+    _strings.push_back(string);
+    _allocatedMemory += sizeof(QString) + string.size() * sizeof(QChar);
+    return id;
+}
+
+const QString& OsmAnd::Model::MapObjectsArena::getString( const uint32_t id ) const
+{
+    static const QString empty;
+    if(id >= static_cast<uint32_t>(_strings.size()))
+        return empty;
+    return _strings[id];
+}
@@ -0,0 +1,167 @@
+#include "TagValueDictionary.h"
+
+#include <cassert>
+
+#include <QMutex>
+#include <QHash>
+#include <QAtomicPointer>
+
+#include "Logging.h"
+
+namespace OsmAnd {
+
+    namespace Model {
+
+        namespace {
+
+            struct Entry
+            {
+                TagValue tagValue;
+                uint32_t tagId;
+            };
+
+            enum {
+                ChunkSize = 4096,
+                MaxChunks = 4096,
+            };
+
+            // Entries are stored in chunks that are never moved or freed, so that references
+            // to them remain valid and may be taken without locking
+            struct Storage
+            {
+                Storage();
+
+                QMutex mutex;
+                QHash< QString, QHash<QString, uint32_t> > ids;
+                uint32_t count;
+                QAtomicPointer<Entry> chunks[MaxChunks];
+
+                uint32_t insert(const QString& tag, const QString& value);
+            };
+
+            // Storage is constructed on first use, since static objects of other translation units may
+            // need dictionary before statics of this one are initialized
+            Storage& storage()
+            {
+                static Storage instance;
+                return instance;
+            }
+
+            Storage::Storage()
+                : count(0)
+            {
+                const auto registerTag = [this](const char* tag) -> uint32_t
+                {
+                    return insert(QString::fromLatin1(tag), QString());
+                };
+                const auto registerTagValue = [this](const char* tag, const char* value) -> uint32_t
+                {
+                    return insert(QString::fromLatin1(tag), QString::fromLatin1(value));
+                };
+
+                registerTag("highway");
+                registerTag("natural");
+                registerTag("oneway");
+                registerTag("layer");
+                registerTag("tunnel");
+                registerTag("bridge");
+                registerTagValue("natural", "coastline");
+                registerTagValue("natural", "coastline_broken");
+                registerTagValue("natural", "coastline_line");
+                registerTagValue("natural", "land");
+                registerTagValue("oneway", "yes");
+                registerTagValue("oneway", "-1");
+                registerTagValue("tunnel", "yes");
+                const auto lastId = registerTagValue("bridge", "yes");
+                assert(lastId + 1 == TagValueDictionary::PredefinedIdsCount);
+            }
+
+            uint32_t Storage::insert( const QString& tag, const QString& value )
+            {
+                auto itTagIds = ids.find(tag);
+                if(itTagIds != ids.end())
+                {
+                    auto itId = itTagIds->find(value);
+                    if(itId != itTagIds->end())
+                        return *itId;
+                }
+
+                // Tag itself is registered first, so it always has smaller id than any of its values
+                const auto tagId = value.isEmpty() ? count : insert(tag, QString());
+
+                const auto id = count;
+                if(id / ChunkSize >= MaxChunks)
+                {
+                    LogPrintf(LogSeverityLevel::Error, "Tag-value dictionary is full, '%s'='%s' is not registered", qPrintable(tag), qPrintable(value));
+                    return TagValueDictionary::InvalidId;
+                }
+
+                auto chunk = chunks[id / ChunkSize].load();
+                if(!chunk)
+                {
+                    chunk = new Entry[ChunkSize];
+                    chunks[id / ChunkSize].storeRelease(chunk);
+                }
+                auto& entry = chunk[id % ChunkSize];
+                entry.tagValue = TagValue(tag, value);
+                entry.tagId = tagId;
+
+                ids[tag].insert(value, id);
+                count++;
+
+                return id;
+            }
+
+        } // namespace
+
+    } // namespace Model
+
+} // namespace OsmAnd
+
+uint32_t OsmAnd::Model::TagValueDictionary::obtainId( const QString& tag, const QString& value )
+{
+    QMutexLocker scopeLock(&storage().mutex);
+
+    return storage().insert(tag, value);
+}
+
+bool OsmAnd::Model::TagValueDictionary::lookupId( const QString& tag, const QString& value, uint32_t& outId )
+{
+    QMutexLocker scopeLock(&storage().mutex);
+
+    auto itTagIds = storage().ids.constFind(tag);
+    if(itTagIds == storage().ids.cend())
+        return false;
+    auto itId = itTagIds->constFind(value);
+    if(itId == itTagIds->cend())
+        return false;
+
+    outId = *itId;
+    return true;
+}
+
+uint32_t OsmAnd::Model::TagValueDictionary::obtainTagId( const QString& tag )
+{
+    return obtainId(tag, QString());
+}
+
+uint32_t OsmAnd::Model::TagValueDictionary::getIdsCount()
+{
+    QMutexLocker scopeLock(&storage().mutex);
+
+    return storage().count;
+}
+
+const OsmAnd::TagValue& OsmAnd::Model::TagValueDictionary::resolve( const uint32_t id )
+{
+    assert(id != InvalidId);
+
+    return storage().chunks[id / ChunkSize].loadAcquire()[id % ChunkSize].tagValue;
+}
+
+uint32_t OsmAnd::Model::TagValueDictionary::resolveTagId( const uint32_t id )
+{
+    assert(id != InvalidId);
+
+    return storage().chunks[id / ChunkSize].loadAcquire()[id % ChunkSize].tagId;
+}
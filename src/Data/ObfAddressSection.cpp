@@ -22,10 +22,8 @@ OsmAnd::ObfAddressSection::~ObfAddressSection()
 {
 }
 
-void OsmAnd::ObfAddressSection::read( ObfReader* reader, ObfAddressSection* section )
+void OsmAnd::ObfAddressSection::read( ObfReader* reader, gpb::io::CodedInputStream* cis, ObfAddressSection* section )
 {
-    auto cis = reader->_codedInputStream.get();
-
     for(;;)
     {
         auto tag = cis->ReadTag();
@@ -46,7 +44,7 @@ void OsmAnd::ObfAddressSection::read( ObfReader* reader, ObfAddressSection* sect
                 std::shared_ptr<AddressBlocksSection> entry(new AddressBlocksSection(section->owner));
                 entry->_length = ObfReader::readBigEndianInt(cis);
                 entry->_offset = cis->CurrentPosition();
-                AddressBlocksSection::read(reader, entry.get());
+                AddressBlocksSection::read(reader, cis, entry.get());
                 cis->Seek(entry->_offset + entry->_length);
                 section->_blocksSections.push_back(entry);
             }
@@ -66,15 +64,48 @@ void OsmAnd::ObfAddressSection::read( ObfReader* reader, ObfAddressSection* sect
 
 }
 
+void OsmAnd::ObfAddressSection::saveStructure( QDataStream& stream, const ObfAddressSection* section )
+{
+    ObfSection::saveStructure(stream, section);
+    stream << section->_latinName << section->_indexNameOffset;
+
+    stream << static_cast<quint32>(section->_blocksSections.size());
+    for(auto itBlocksSection = section->_blocksSections.cbegin(); itBlocksSection != section->_blocksSections.cend(); ++itBlocksSection)
+    {
+        const auto& blocksSection = *itBlocksSection;
+
+        ObfSection::saveStructure(stream, blocksSection.get());
+        stream << static_cast<qint32>(blocksSection->_type);
+    }
+}
+
+void OsmAnd::ObfAddressSection::loadStructure( QDataStream& stream, ObfAddressSection* section )
+{
+    ObfSection::loadStructure(stream, section);
+    stream >> section->_latinName >> section->_indexNameOffset;
+
+    quint32 blocksSectionsCount = 0;
+    stream >> blocksSectionsCount;
+    for(quint32 blocksSectionIdx = 0; blocksSectionIdx < blocksSectionsCount && stream.status() == QDataStream::Ok; blocksSectionIdx++)
+    {
+        std::shared_ptr<AddressBlocksSection> blocksSection(new AddressBlocksSection(section->owner));
+
+        ObfSection::loadStructure(stream, blocksSection.get());
+        qint32 type;
+        stream >> type;
+        blocksSection->_type = static_cast<AddressBlocksSection::Type>(type);
+
+        section->_blocksSections.push_back(blocksSection);
+    }
+}
+
 void OsmAnd::ObfAddressSection::readStreetGroups(
-    ObfReader* reader, ObfAddressSection* section,
+    ObfReader* reader, gpb::io::CodedInputStream* cis, ObfAddressSection* section,
     QList< std::shared_ptr<Model::StreetGroup> >* resultOut,
     std::function<bool (const std::shared_ptr<OsmAnd::Model::StreetGroup>&)> visitor,
     IQueryController* controller,
     uint8_t typeBitmask /*= std::numeric_limits<uint8_t>::max()*/ )
 {
-    auto cis = reader->_codedInputStream.get();
-
     for(auto itAddressBlocksSection = section->_blocksSections.begin(); itAddressBlocksSection != section->_blocksSections.end(); ++itAddressBlocksSection)
     {
         if(controller && controller->isAborted())
@@ -86,7 +117,7 @@ void OsmAnd::ObfAddressSection::readStreetGroups(
 
         auto res = cis->Seek(block->_offset);
         auto oldLimit = cis->PushLimit(block->_length);
-        AddressBlocksSection::readStreetGroups(reader, block.get(), resultOut, visitor, controller);
+        AddressBlocksSection::readStreetGroups(reader, cis, block.get(), resultOut, visitor, controller);
         cis->PopLimit(oldLimit);
     }
 }
@@ -98,7 +129,10 @@ void OsmAnd::ObfAddressSection::loadStreetGroups(
     IQueryController* controller,
     uint8_t typeBitmask /*= std::numeric_limits<uint8_t>::max()*/ )
 {
-    readStreetGroups(reader, section, resultOut, visitor, controller, typeBitmask);
+    reader->ensureSectionsRead(ObfReader::SectionType::Address);
+
+    ObfReader::ScopedCursor cursor(reader);
+    readStreetGroups(reader, cursor.cis, section, resultOut, visitor, controller, typeBitmask);
 }
 
 void OsmAnd::ObfAddressSection::loadStreetsFromGroup(
@@ -108,23 +142,22 @@ void OsmAnd::ObfAddressSection::loadStreetsFromGroup(
     IQueryController* controller /*= nullptr*/)
 {
     //TODO:checkAddressIndex(c.getFileOffset());
-    auto cis = reader->_codedInputStream;
+    ObfReader::ScopedCursor cursor(reader);
+    auto cis = cursor.cis;
     cis->Seek(group->_offset);
     gpb::uint32 length;
     cis->ReadVarint32(&length);
     auto oldLimit = cis->PushLimit(length);
-    readStreetsFromGroup(reader, group, resultOut, visitor, controller);
+    readStreetsFromGroup(reader, cis, group, resultOut, visitor, controller);
     cis->PopLimit(oldLimit);
 }
 
 void OsmAnd::ObfAddressSection::readStreetsFromGroup(
-    ObfReader* reader, Model::StreetGroup* group,
+    ObfReader* reader, gpb::io::CodedInputStream* cis, Model::StreetGroup* group,
     QList< std::shared_ptr<Model::Street> >* resultOut,
     std::function<bool (const std::shared_ptr<OsmAnd::Model::Street>&)> visitor,
     IQueryController* controller)
 {
-    auto cis = reader->_codedInputStream.get();
-
     for(;;)
     {
         if(controller && controller->isAborted())
@@ -142,7 +175,7 @@ void OsmAnd::ObfAddressSection::readStreetsFromGroup(
                 gpb::uint32 length;
                 cis->ReadVarint32(&length);
                 auto oldLimit = cis->PushLimit(length);
-                readStreet(reader, group, street.get());
+                readStreet(reader, cis, group, street.get());
                 if(!visitor || visitor(street))
                 {
                     if(resultOut)
@@ -160,10 +193,8 @@ void OsmAnd::ObfAddressSection::readStreetsFromGroup(
     }
 }
 
-void OsmAnd::ObfAddressSection::readStreet( ObfReader* reader, Model::StreetGroup* group, Model::Street* street)
+void OsmAnd::ObfAddressSection::readStreet( ObfReader* reader, gpb::io::CodedInputStream* cis, Model::StreetGroup* group, Model::Street* street)
 {
-    auto cis = reader->_codedInputStream.get();
-
     for(;;)
     {
         auto tag = cis->ReadTag();
@@ -218,23 +249,22 @@ void OsmAnd::ObfAddressSection::loadBuildingsFromStreet(
     IQueryController* controller /*= nullptr*/)
 {
     //TODO:checkAddressIndex(s.getFileOffset());
-    auto cis = reader->_codedInputStream;
+    ObfReader::ScopedCursor cursor(reader);
+    auto cis = cursor.cis;
     cis->Seek(street->_offset);
     gpb::uint32 length;
     cis->ReadVarint32(&length);
     auto oldLimit = cis->PushLimit(length);
-    readBuildingsFromStreet(reader, street, resultOut, visitor, controller);
+    readBuildingsFromStreet(reader, cis, street, resultOut, visitor, controller);
     cis->PopLimit(oldLimit);
 }
 
 void OsmAnd::ObfAddressSection::readBuildingsFromStreet(
-    ObfReader* reader, Model::Street* street,
+    ObfReader* reader, gpb::io::CodedInputStream* cis, Model::Street* street,
     QList< std::shared_ptr<Model::Building> >* resultOut,
     std::function<bool (const std::shared_ptr<OsmAnd::Model::Building>&)> visitor,
     IQueryController* controller)
 {
-    auto cis = reader->_codedInputStream.get();
-
     for(;;)
     {
         if(controller && controller->isAborted())
@@ -260,7 +290,7 @@ void OsmAnd::ObfAddressSection::readBuildingsFromStreet(
                 auto oldLimit = cis->PushLimit(length);
                 std::shared_ptr<Model::Building> building(new Model::Building());
                 building->_offset = offset;
-                readBuilding(reader, street, building.get());
+                readBuilding(reader, cis, street, building.get());
                 if (!visitor || visitor(building))
                 {
                     if(resultOut)
@@ -276,10 +306,8 @@ void OsmAnd::ObfAddressSection::readBuildingsFromStreet(
     }
 }
 
-void OsmAnd::ObfAddressSection::readBuilding( ObfReader* reader, Model::Street* street, Model::Building* building )
+void OsmAnd::ObfAddressSection::readBuilding( ObfReader* reader, gpb::io::CodedInputStream* cis, Model::Street* street, Model::Building* building )
 {
-    auto cis = reader->_codedInputStream.get();
-
     for(;;)
     {
         auto tag = cis->ReadTag();
@@ -356,23 +384,22 @@ void OsmAnd::ObfAddressSection::loadIntersectionsFromStreet(
     IQueryController* controller /*= nullptr*/)
 {
     //TODO:checkAddressIndex(s.getFileOffset());
-    auto cis = reader->_codedInputStream;
+    ObfReader::ScopedCursor cursor(reader);
+    auto cis = cursor.cis;
     cis->Seek(street->_offset);
     gpb::uint32 length;
     cis->ReadVarint32(&length);
     auto oldLimit = cis->PushLimit(length);
-    readIntersectionsFromStreet(reader, street, resultOut, visitor, controller);
+    readIntersectionsFromStreet(reader, cis, street, resultOut, visitor, controller);
     cis->PopLimit(oldLimit);
 }
 
 void OsmAnd::ObfAddressSection::readIntersectionsFromStreet(
-    ObfReader* reader, Model::Street* street,
+    ObfReader* reader, gpb::io::CodedInputStream* cis, Model::Street* street,
     QList< std::shared_ptr<Model::StreetIntersection> >* resultOut,
     std::function<bool (const std::shared_ptr<OsmAnd::Model::StreetIntersection>&)> visitor,
     IQueryController* controller)
 {
-    auto cis = reader->_codedInputStream.get();
-
     for(;;)
     {
         if(controller && controller->isAborted())
@@ -389,7 +416,7 @@ void OsmAnd::ObfAddressSection::readIntersectionsFromStreet(
                 cis->ReadVarint32(&length);
                 auto oldLimit = cis->PushLimit(length);
                 std::shared_ptr<Model::StreetIntersection> intersectedStreet(new Model::StreetIntersection());
-                readIntersectedStreet(reader, street, intersectedStreet.get());
+                readIntersectedStreet(reader, cis, street, intersectedStreet.get());
                 if(!visitor || visitor(intersectedStreet))
                 {
                     if(resultOut)
@@ -412,10 +439,8 @@ void OsmAnd::ObfAddressSection::readIntersectionsFromStreet(
     }
 }
 
-void OsmAnd::ObfAddressSection::readIntersectedStreet( ObfReader* reader, Model::Street* street, Model::StreetIntersection* intersection )
+void OsmAnd::ObfAddressSection::readIntersectedStreet( ObfReader* reader, gpb::io::CodedInputStream* cis, Model::Street* street, Model::StreetIntersection* intersection )
 {
-    auto cis = reader->_codedInputStream.get();
-
     for(;;)
     {
         auto tag = cis->ReadTag();
@@ -461,10 +486,8 @@ OsmAnd::ObfAddressSection::AddressBlocksSection::~AddressBlocksSection()
 {
 }
 
-void OsmAnd::ObfAddressSection::AddressBlocksSection::read( ObfReader* reader, AddressBlocksSection* section )
+void OsmAnd::ObfAddressSection::AddressBlocksSection::read( ObfReader* reader, gpb::io::CodedInputStream* cis, AddressBlocksSection* section )
 {
-    auto cis = reader->_codedInputStream.get();
-
     for(;;)
     {
         auto tag = cis->ReadTag();
@@ -483,13 +506,11 @@ void OsmAnd::ObfAddressSection::AddressBlocksSection::read( ObfReader* reader, A
 }
 
 void OsmAnd::ObfAddressSection::AddressBlocksSection::readStreetGroups(
-    ObfReader* reader, OsmAnd::ObfAddressSection::AddressBlocksSection* section,
+    ObfReader* reader, gpb::io::CodedInputStream* cis, OsmAnd::ObfAddressSection::AddressBlocksSection* section,
     QList< std::shared_ptr<Model::StreetGroup> >* resultOut,
     std::function<bool (const std::shared_ptr<OsmAnd::Model::StreetGroup>&)> visitor,
     IQueryController* controller)
 {
-    auto cis = reader->_codedInputStream.get();
-
     for(;;)
     {
         if(controller && controller->isAborted())
@@ -506,7 +527,7 @@ void OsmAnd::ObfAddressSection::AddressBlocksSection::readStreetGroups(
                 gpb::uint32 length;
                 cis->ReadVarint32(&length);
                 auto oldLimit = cis->PushLimit(length);
-                auto streetGroup = readStreetGroupHeader(reader, section, offset);
+                auto streetGroup = readStreetGroupHeader(reader, cis, section, offset);
                 if(streetGroup)
                 {
                     if(!visitor || visitor(streetGroup))
@@ -530,18 +551,17 @@ void OsmAnd::ObfAddressSection::AddressBlocksSection::loadStreetGroupsFromBlock(
     std::function<bool (const std::shared_ptr<OsmAnd::Model::StreetGroup>&)> visitor,
     IQueryController* controller)
 {
-    auto cis = owner->_codedInputStream.get();
+    ObfReader::ScopedCursor cursor(owner);
+    auto cis = cursor.cis;
 
     cis->Seek(_offset);
     auto oldLimit = cis->PushLimit(_length);
-    AddressBlocksSection::readStreetGroups(owner, this, resultOut, visitor, controller);
+    AddressBlocksSection::readStreetGroups(owner, cis, this, resultOut, visitor, controller);
     cis->PopLimit(oldLimit);
 }
 
-std::shared_ptr<OsmAnd::Model::StreetGroup> OsmAnd::ObfAddressSection::AddressBlocksSection::readStreetGroupHeader( ObfReader* reader, OsmAnd::ObfAddressSection::AddressBlocksSection* section, unsigned int offset )
+std::shared_ptr<OsmAnd::Model::StreetGroup> OsmAnd::ObfAddressSection::AddressBlocksSection::readStreetGroupHeader( ObfReader* reader, gpb::io::CodedInputStream* cis, OsmAnd::ObfAddressSection::AddressBlocksSection* section, unsigned int offset )
 {
-    auto cis = reader->_codedInputStream.get();
-
     std::shared_ptr<OsmAnd::Model::StreetGroup> streetGroup;
 //    boolean englishNameMatched = false;
     for(;;)
@@ -8,9 +8,15 @@
 #include "OBF.pb.h"
 #include "OsmAndCore/Utilities.h"
 #include "MapObject.h"
+#include "TagValueDictionary.h"
+#include "Logging.h"
 
 namespace gpb = google::protobuf;
 
+QMutex OsmAnd::ObfMapSection::_flatTreeNodesMemoryMutex;
+size_t OsmAnd::ObfMapSection::_flatTreeNodesMemoryUsage = 0;
+size_t OsmAnd::ObfMapSection::_flatTreeNodesMemoryLimit = 32 * 1024 * 1024;
+
 OsmAnd::ObfMapSection::ObfMapSection( ObfReader* owner_ )
     : ObfSection(owner_)
     , _isBaseMap(false)
@@ -23,10 +29,8 @@ OsmAnd::ObfMapSection::~ObfMapSection()
 {
 }
 
-void OsmAnd::ObfMapSection::read( ObfReader* reader, ObfMapSection* section )
+void OsmAnd::ObfMapSection::read( ObfReader* reader, gpb::io::CodedInputStream* cis, ObfMapSection* section )
 {
-    auto cis = reader->_codedInputStream.get();
-
     for(;;)
     {
         gpb::uint32 tag = cis->ReadTag();
@@ -49,7 +53,7 @@ void OsmAnd::ObfMapSection::read( ObfReader* reader, ObfMapSection* section )
                 auto offset = cis->CurrentPosition();
                 auto oldLimit = cis->PushLimit(length);
                 std::shared_ptr<MapLevel> levelRoot(new MapLevel());
-                readMapLevelHeader(reader, section, levelRoot.get());
+                readMapLevelHeader(reader, cis, section, levelRoot.get());
                 levelRoot->_length = length;
                 levelRoot->_offset = offset;
                 section->_mapLevels.push_back(levelRoot);
@@ -63,10 +67,41 @@ void OsmAnd::ObfMapSection::read( ObfReader* reader, ObfMapSection* section )
     }
 }
 
-void OsmAnd::ObfMapSection::readMapLevelHeader( ObfReader* reader, ObfMapSection* section, MapLevel* level )
+void OsmAnd::ObfMapSection::saveStructure( QDataStream& stream, const ObfMapSection* section )
+{
+    ObfSection::saveStructure(stream, section);
+    stream << section->_isBaseMap;
+
+    stream << static_cast<quint32>(section->_mapLevels.size());
+    for(auto itMapLevel = section->_mapLevels.cbegin(); itMapLevel != section->_mapLevels.cend(); ++itMapLevel)
+    {
+        const auto& mapLevel = *itMapLevel;
+
+        stream << mapLevel->_offset << mapLevel->_length << mapLevel->_minZoom << mapLevel->_maxZoom;
+        stream << mapLevel->_area31.top << mapLevel->_area31.left << mapLevel->_area31.bottom << mapLevel->_area31.right;
+    }
+}
+
+void OsmAnd::ObfMapSection::loadStructure( QDataStream& stream, ObfMapSection* section )
 {
-    auto cis = reader->_codedInputStream.get();
+    ObfSection::loadStructure(stream, section);
+    stream >> section->_isBaseMap;
 
+    quint32 mapLevelsCount = 0;
+    stream >> mapLevelsCount;
+    for(quint32 mapLevelIdx = 0; mapLevelIdx < mapLevelsCount && stream.status() == QDataStream::Ok; mapLevelIdx++)
+    {
+        std::shared_ptr<MapLevel> mapLevel(new MapLevel());
+
+        stream >> mapLevel->_offset >> mapLevel->_length >> mapLevel->_minZoom >> mapLevel->_maxZoom;
+        stream >> mapLevel->_area31.top >> mapLevel->_area31.left >> mapLevel->_area31.bottom >> mapLevel->_area31.right;
+
+        section->_mapLevels.push_back(mapLevel);
+    }
+}
+
+void OsmAnd::ObfMapSection::readMapLevelHeader( ObfReader* reader, gpb::io::CodedInputStream* cis, ObfMapSection* section, MapLevel* level )
+{
     for(;;)
     {
         auto tag = cis->ReadTag();
@@ -104,11 +139,9 @@ void OsmAnd::ObfMapSection::readMapLevelHeader( ObfReader* reader, ObfMapSection
 }
 
 void OsmAnd::ObfMapSection::readRules(
-    ObfReader* reader,
+    ObfReader* reader, gpb::io::CodedInputStream* cis,
     Rules* rules)
 {
-    auto cis = reader->_codedInputStream.get();
-
     uint32_t defaultId = 1;
     for(;;)
     {
@@ -132,7 +165,7 @@ void OsmAnd::ObfMapSection::readRules(
                 gpb::uint32 length;
                 cis->ReadVarint32(&length);
                 auto oldLimit = cis->PushLimit(length);
-                readRule(reader, defaultId++, rules);
+                readRule(reader, cis, defaultId++, rules);
                 cis->PopLimit(oldLimit);
             }
             break;
@@ -144,12 +177,10 @@ void OsmAnd::ObfMapSection::readRules(
 }
 
 void OsmAnd::ObfMapSection::readRule(
-    ObfReader* reader,
+    ObfReader* reader, gpb::io::CodedInputStream* cis,
     uint32_t defaultId,
     Rules* rules)
 {
-    auto cis = reader->_codedInputStream.get();
-
     gpb::uint32 ruleId = defaultId;
     gpb::uint32 ruleType = 0;
     QString ruleTag;
@@ -189,8 +220,15 @@ void OsmAnd::ObfMapSection::createRule( Rules* rules, uint32_t ruleType, uint32_
     itEncodingRule->insert(ruleVal, ruleId);
     
     if(!rules->_decodingRules.contains(ruleId))
+    {
         rules->_decodingRules.insert(ruleId, Rules::DecodingRule(ruleTag, ruleVal, ruleType));
 
+        auto& typeIds = rules->_decodingRulesTypeIds;
+        if(ruleId >= static_cast<uint32_t>(typeIds.size()))
+            typeIds.insert(typeIds.end(), ruleId + 1 - typeIds.size(), Model::TagValueDictionary::InvalidId);
+        typeIds[ruleId] = Model::TagValueDictionary::obtainId(ruleTag, ruleVal);
+    }
+
     if("name" == ruleTag)
         rules->_nameEncodingType = ruleId;
     else if("natural" == ruleTag && "coastline" == ruleVal)
@@ -224,18 +262,45 @@ void OsmAnd::ObfMapSection::loadMapObjects(
     uint32_t zoom, const AreaI* bbox31 /*= nullptr*/,
     QList< std::shared_ptr<OsmAnd::Model::MapObject> >* resultOut /*= nullptr*/,
     std::function<bool (const std::shared_ptr<OsmAnd::Model::MapObject>&)> visitor /*= nullptr*/,
-    IQueryController* controller /*= nullptr*/)
+    IQueryController* controller /*= nullptr*/,
+    const std::shared_ptr<Model::MapObjectsArena>& arena_ /*= std::shared_ptr<Model::MapObjectsArena>()*/)
+{
+    const auto arena = arena_ ? arena_ : std::shared_ptr<Model::MapObjectsArena>(new Model::MapObjectsArena());
+    loadMapObjects(reader, section, zoom, bbox31, resultOut, visitor, controller,
+        [arena](const AreaI& objectBBox31) -> std::shared_ptr<Model::MapObjectsArena>
+        {
+            return arena;
+        });
+}
+
+void OsmAnd::ObfMapSection::loadMapObjects(
+    ObfReader* reader, ObfMapSection* section,
+    uint32_t zoom, const AreaI* bbox31,
+    QList< std::shared_ptr<OsmAnd::Model::MapObject> >* resultOut,
+    std::function<bool (const std::shared_ptr<OsmAnd::Model::MapObject>&)> visitor,
+    IQueryController* controller,
+    const ArenaSelector& arenaSelector)
 {
     assert(zoom >= 0 && zoom <= 31);
-    auto cis = reader->_codedInputStream.get();
+    assert(arenaSelector != nullptr);
+    reader->ensureSectionsRead(ObfReader::SectionType::Map);
+    ObfReader::ScopedCursor cursor(reader);
+    auto cis = cursor.cis;
+
+    MapObjectBuffers buffers;
 
-    if(!section->_rules)
     {
-        cis->Seek(section->_offset);
-        auto oldLimit = cis->PushLimit(section->_length);
-        section->_rules.reset(new Rules());
-        readRules(reader, section->_rules.get());
-        cis->PopLimit(oldLimit);
+        QMutexLocker scopeLock(&section->_rulesMutex);
+
+        if(!section->_rules)
+        {
+            cis->Seek(section->_offset);
+            auto oldLimit = cis->PushLimit(section->_length);
+            std::shared_ptr<Rules> rules(new Rules());
+            readRules(reader, cis, rules.get());
+            cis->PopLimit(oldLimit);
+            section->_rules = rules;
+        }
     }
 
     for(auto itMapLevel = section->_mapLevels.begin(); itMapLevel != section->_mapLevels.end(); ++itMapLevel)
@@ -248,29 +313,57 @@ void OsmAnd::ObfMapSection::loadMapObjects(
         if(bbox31 && !bbox31->intersects(mapLevel->_area31))
             continue;
 
-        // If there are no tree nodes in map level, it means they are not loaded
-        QList< std::shared_ptr<LevelTreeNode> > cachedTreeNodes;//TODO: these should be cached somehow
-        cis->Seek(mapLevel->_offset);
-        auto oldLimit = cis->PushLimit(mapLevel->_length);
-        readMapLevelTreeNodes(reader, section, mapLevel.get(), cachedTreeNodes);
-        cis->PopLimit(oldLimit);
-        
         QList< std::shared_ptr<LevelTreeNode> > treeNodesWithData;
-        for(auto itTreeNode = cachedTreeNodes.begin(); itTreeNode != cachedTreeNodes.end(); ++itTreeNode)
+        const auto flatTreeNodes = obtainFlatTreeNodes(reader, cis, section, mapLevel.get());
+        if(flatTreeNodes)
         {
-            const auto& treeNode = *itTreeNode;
-
-            if(bbox31 && !bbox31->intersects(treeNode->_area31))
-                continue;
+            const auto nodesCount = flatTreeNodes->size();
+            const auto pFlatTreeNodes = flatTreeNodes->constData();
+            for(auto nodeIdx = 0; nodeIdx < nodesCount;)
+            {
+                const auto& flatTreeNode = pFlatTreeNodes[nodeIdx];
 
-            if(treeNode->_dataOffset > 0)
-                treeNodesWithData.push_back(treeNode);
+                if(bbox31 && !bbox31->intersects(AreaI(flatTreeNode._top, flatTreeNode._left, flatTreeNode._bottom, flatTreeNode._right)))
+                {
+                    nodeIdx = flatTreeNode._subtreeEnd;
+                    continue;
+                }
 
-            cis->Seek(treeNode->_offset);
-            auto oldLimit = cis->PushLimit(treeNode->_length);
-            readTreeNodeChildren(reader, section, treeNode.get(), &treeNodesWithData, bbox31, controller);
-            assert(cis->BytesUntilLimit() == 0);
+                if(flatTreeNode._dataOffset > 0)
+                {
+                    std::shared_ptr<LevelTreeNode> treeNode(new LevelTreeNode());
+                    treeNode->_dataOffset = flatTreeNode._dataOffset;
+                    treeNode->_foundation = flatTreeNode._foundation;
+                    treeNode->_area31 = AreaI(flatTreeNode._top, flatTreeNode._left, flatTreeNode._bottom, flatTreeNode._right);
+                    treeNodesWithData.push_back(treeNode);
+                }
+                nodeIdx++;
+            }
+        }
+        else
+        {
+            QList< std::shared_ptr<LevelTreeNode> > rootTreeNodes;
+            cis->Seek(mapLevel->_offset);
+            auto oldLimit = cis->PushLimit(mapLevel->_length);
+            readMapLevelTreeNodes(reader, cis, section, mapLevel.get(), rootTreeNodes);
             cis->PopLimit(oldLimit);
+
+            for(auto itTreeNode = rootTreeNodes.begin(); itTreeNode != rootTreeNodes.end(); ++itTreeNode)
+            {
+                const auto& treeNode = *itTreeNode;
+
+                if(bbox31 && !bbox31->intersects(treeNode->_area31))
+                    continue;
+
+                if(treeNode->_dataOffset > 0)
+                    treeNodesWithData.push_back(treeNode);
+
+                cis->Seek(treeNode->_offset);
+                auto oldLimit = cis->PushLimit(treeNode->_length);
+                readTreeNodeChildren(reader, cis, section, treeNode.get(), &treeNodesWithData, bbox31, controller);
+                assert(cis->BytesUntilLimit() == 0);
+                cis->PopLimit(oldLimit);
+            }
         }
         qSort(treeNodesWithData.begin(), treeNodesWithData.end(), [](const std::shared_ptr<LevelTreeNode>& l, const std::shared_ptr<LevelTreeNode>& r) -> bool
         {
@@ -286,15 +379,14 @@ void OsmAnd::ObfMapSection::loadMapObjects(
             gpb::uint32 length;
             cis->ReadVarint32(&length);
             auto oldLimit = cis->PushLimit(length);
-            readMapObjectsBlock(reader, section, treeNode.get(), resultOut, bbox31, visitor, controller);
+            readMapObjectsBlock(reader, cis, section, treeNode.get(), resultOut, bbox31, visitor, controller, arenaSelector, buffers);
             cis->PopLimit(oldLimit);
         }
     }
 }
 
-void OsmAnd::ObfMapSection::readMapLevelTreeNodes( ObfReader* reader, ObfMapSection* section, MapLevel* level, QList< std::shared_ptr<LevelTreeNode> >& trees )
+void OsmAnd::ObfMapSection::readMapLevelTreeNodes( ObfReader* reader, gpb::io::CodedInputStream* cis, ObfMapSection* section, MapLevel* level, QList< std::shared_ptr<LevelTreeNode> >& trees )
 {
-    auto cis = reader->_codedInputStream.get();
     for(;;)
     {
         gpb::uint32 tag = cis->ReadTag();
@@ -311,7 +403,7 @@ void OsmAnd::ObfMapSection::readMapLevelTreeNodes( ObfReader* reader, ObfMapSect
                 levelTree->_offset = offset;
                 levelTree->_length = length;
 
-                readTreeNode(reader, section, level->area31, levelTree.get());
+                readTreeNode(reader, cis, section, level->area31, levelTree.get());
                 cis->Skip(cis->BytesUntilLimit());
 
                 cis->PopLimit(oldLimit);
@@ -328,10 +420,8 @@ void OsmAnd::ObfMapSection::readMapLevelTreeNodes( ObfReader* reader, ObfMapSect
     }
 }
 
-void OsmAnd::ObfMapSection::readTreeNode( ObfReader* reader, ObfMapSection* section, const AreaI& parentArea, LevelTreeNode* treeNode )
+void OsmAnd::ObfMapSection::readTreeNode( ObfReader* reader, gpb::io::CodedInputStream* cis, ObfMapSection* section, const AreaI& parentArea, LevelTreeNode* treeNode )
 {
-    auto cis = reader->_codedInputStream.get();
-
     for(;;)
     {
         auto tagPos = cis->CurrentPosition();
@@ -383,14 +473,12 @@ void OsmAnd::ObfMapSection::readTreeNode( ObfReader* reader, ObfMapSection* sect
 }
 
 void OsmAnd::ObfMapSection::readTreeNodeChildren(
-    ObfReader* reader, ObfMapSection* section,
+    ObfReader* reader, gpb::io::CodedInputStream* cis, ObfMapSection* section,
     LevelTreeNode* treeNode,
     QList< std::shared_ptr<LevelTreeNode> >* nodesWithData,
     const AreaI* bbox31,
     IQueryController* controller)
 {
-    auto cis = reader->_codedInputStream.get();
-
     for(;;)
     {
         auto tag = cis->ReadTag();
@@ -407,7 +495,7 @@ void OsmAnd::ObfMapSection::readTreeNodeChildren(
                 childNode->_foundation = treeNode->_foundation;
                 childNode->_offset = offset;
                 childNode->_length = length;
-                readTreeNode(reader, section, treeNode->_area31, childNode.get());
+                readTreeNode(reader, cis, section, treeNode->_area31, childNode.get());
                 if(bbox31 && !bbox31->intersects(childNode->_area31))
                 {
                     cis->Skip(cis->BytesUntilLimit());
@@ -419,9 +507,50 @@ void OsmAnd::ObfMapSection::readTreeNodeChildren(
                     nodesWithData->push_back(childNode);
 
                 cis->Seek(offset);
-                readTreeNodeChildren(reader, section, childNode.get(), nodesWithData, bbox31, controller);
+                readTreeNodeChildren(reader, cis, section, childNode.get(), nodesWithData, bbox31, controller);
+                assert(cis->BytesUntilLimit() == 0);
+                cis->PopLimit(oldLimit);
+            }
+            break;
+        default:
+            ObfReader::skipUnknownField(cis, tag);
+            break;
+        }
+    }
+}
+
+void OsmAnd::ObfMapSection::readFlatTreeNodeChildren(
+    ObfReader* reader, gpb::io::CodedInputStream* cis, ObfMapSection* section,
+    LevelTreeNode* treeNode,
+    QVector<FlatTreeNode>& flatNodes)
+{
+    for(;;)
+    {
+        auto tag = cis->ReadTag();
+        switch(gpb::internal::WireFormatLite::GetTagFieldNumber(tag))
+        {
+        case 0:
+            return;
+        case OBF::OsmAndMapIndex_MapDataBox::kBoxesFieldNumber:
+            {
+                auto length = ObfReader::readBigEndianInt(cis);
+                auto offset = cis->CurrentPosition();
+                auto oldLimit = cis->PushLimit(length);
+                LevelTreeNode childNode;
+                childNode._foundation = treeNode->_foundation;
+                childNode._offset = offset;
+                childNode._length = length;
+                readTreeNode(reader, cis, section, treeNode->_area31, &childNode);
+
+                const auto childIdx = flatNodes.size();
+                flatNodes.push_back(FlatTreeNode(childNode));
+
+                cis->Seek(offset);
+                readFlatTreeNodeChildren(reader, cis, section, &childNode, flatNodes);
                 assert(cis->BytesUntilLimit() == 0);
                 cis->PopLimit(oldLimit);
+
+                flatNodes[childIdx]._subtreeEnd = flatNodes.size();
             }
             break;
         default:
@@ -431,18 +560,82 @@ void OsmAnd::ObfMapSection::readTreeNodeChildren(
     }
 }
 
+std::shared_ptr< const QVector<OsmAnd::ObfMapSection::FlatTreeNode> > OsmAnd::ObfMapSection::obtainFlatTreeNodes( ObfReader* reader, gpb::io::CodedInputStream* cis, ObfMapSection* section, MapLevel* level )
+{
+    QMutexLocker scopeLock(&level->_flatTreeNodesMutex);
+
+    if(level->_flatTreeNodes || level->_isFlatTreeNodesOverBudget)
+        return level->_flatTreeNodes;
+
+    QList< std::shared_ptr<LevelTreeNode> > rootTreeNodes;
+    cis->Seek(level->_offset);
+    auto oldLimit = cis->PushLimit(level->_length);
+    readMapLevelTreeNodes(reader, cis, section, level, rootTreeNodes);
+    cis->PopLimit(oldLimit);
+
+    std::shared_ptr< QVector<FlatTreeNode> > flatNodes(new QVector<FlatTreeNode>());
+    for(auto itTreeNode = rootTreeNodes.cbegin(); itTreeNode != rootTreeNodes.cend(); ++itTreeNode)
+    {
+        const auto& treeNode = *itTreeNode;
+
+        const auto rootIdx = flatNodes->size();
+        flatNodes->push_back(FlatTreeNode(*treeNode));
+
+        cis->Seek(treeNode->_offset);
+        auto oldLimit = cis->PushLimit(treeNode->_length);
+        readFlatTreeNodeChildren(reader, cis, section, treeNode.get(), *flatNodes);
+        assert(cis->BytesUntilLimit() == 0);
+        cis->PopLimit(oldLimit);
+
+        (*flatNodes)[rootIdx]._subtreeEnd = flatNodes->size();
+    }
+    flatNodes->squeeze();
+
+    // Nodes decoded above are still used by current query, even if they are not going to be kept
+    const auto consumedMemory = sizeof(QVector<FlatTreeNode>) + flatNodes->capacity() * sizeof(FlatTreeNode);
+    {
+        QMutexLocker budgetLock(&_flatTreeNodesMemoryMutex);
+
+        if(_flatTreeNodesMemoryUsage + consumedMemory > _flatTreeNodesMemoryLimit)
+        {
+            LogPrintf(LogSeverityLevel::Debug, "Level tree of '%s' (%d nodes) does not fit memory limit, it will be read from disk",
+                qPrintable(section->_name), flatNodes->size());
+            level->_isFlatTreeNodesOverBudget = true;
+            return flatNodes;
+        }
+        _flatTreeNodesMemoryUsage += consumedMemory;
+    }
+    level->_flatTreeNodesConsumedMemory = consumedMemory;
+    level->_flatTreeNodes = flatNodes;
+
+    return level->_flatTreeNodes;
+}
+
+size_t OsmAnd::ObfMapSection::getFlatTreeNodesMemoryLimit()
+{
+    QMutexLocker scopeLock(&_flatTreeNodesMemoryMutex);
+    return _flatTreeNodesMemoryLimit;
+}
+
+void OsmAnd::ObfMapSection::setFlatTreeNodesMemoryLimit( const size_t limit )
+{
+    QMutexLocker scopeLock(&_flatTreeNodesMemoryMutex);
+    _flatTreeNodesMemoryLimit = limit;
+}
+
 void OsmAnd::ObfMapSection::readMapObjectsBlock(
-    ObfReader* reader,
+    ObfReader* reader, gpb::io::CodedInputStream* cis,
     ObfMapSection* section, 
     LevelTreeNode* tree,
     QList< std::shared_ptr<OsmAnd::Model::MapObject> >* resultOut,
     const AreaI* bbox31,
     std::function<bool (const std::shared_ptr<OsmAnd::Model::MapObject>&)> visitor,
-    IQueryController* controller)
+    IQueryController* controller,
+    const ArenaSelector& arenaSelector,
+    MapObjectBuffers& buffers)
 {
-    auto cis = reader->_codedInputStream.get();
-
     QList< std::shared_ptr<OsmAnd::Model::MapObject> > intermediateResult;
+    QList< std::shared_ptr<Model::MapObjectsArena> > intermediateResultArenas;
     QStringList mapObjectsNamesTable;
     gpb::uint64 baseId = 0;
     for(;;)
@@ -454,27 +647,39 @@ void OsmAnd::ObfMapSection::readMapObjectsBlock(
         switch(gpb::internal::WireFormatLite::GetTagFieldNumber(tag))
         {
         case 0:
-            for(auto itEntry = intermediateResult.begin(); itEntry != intermediateResult.end(); ++itEntry)
             {
-                const auto& entry = *itEntry;
-
-                // Fill names of roads from stringtable
-                for(auto itNameEntry = entry->_names.begin(); itNameEntry != entry->_names.end(); ++itNameEntry)
+                // Names refer to string table of the block. Only strings that are referenced by created objects
+                // are put to string table of arena of each object, once per arena.
+                const auto namesTableSize = static_cast<uint32_t>(mapObjectsNamesTable.size());
+                QHash< QPair<const Model::MapObjectsArena*, uint32_t>, uint32_t > arenaStringIds;
+                auto itEntryArena = intermediateResultArenas.cbegin();
+                for(auto itEntry = intermediateResult.begin(); itEntry != intermediateResult.end(); ++itEntry, ++itEntryArena)
                 {
-                    const auto& encodedId = itNameEntry.value();
-                    uint32_t stringId = 0;
-                    stringId |= (encodedId.at(1 + 0).unicode() & 0xff) << 8*0;
-                    stringId |= (encodedId.at(1 + 1).unicode() & 0xff) << 8*1;
-                    stringId |= (encodedId.at(1 + 2).unicode() & 0xff) << 8*2;
-                    stringId |= (encodedId.at(1 + 3).unicode() & 0xff) << 8*3;
-
-                    itNameEntry.value() = mapObjectsNamesTable[stringId];
-                }
+                    const auto& entry = *itEntry;
+                    const auto& arena = *itEntryArena;
 
-                if(!visitor || visitor(entry))
-                {
-                    if(resultOut)
-                        resultOut->push_back(entry);
+                    const auto pNames = entry->_names.data();
+                    for(auto nameIdx = 0; nameIdx < entry->_names.size(); nameIdx++)
+                    {
+                        auto& name = pNames[nameIdx];
+                        if(name.stringId >= namesTableSize)
+                        {
+                            name.stringId = std::numeric_limits<uint32_t>::max();
+                            continue;
+                        }
+
+                        const auto key = qMakePair(static_cast<const Model::MapObjectsArena*>(arena.get()), name.stringId);
+                        auto itStringId = arenaStringIds.find(key);
+                        if(itStringId == arenaStringIds.end())
+                            itStringId = arenaStringIds.insert(key, arena->appendString(mapObjectsNamesTable[name.stringId]));
+                        name.stringId = *itStringId;
+                    }
+
+                    if(!visitor || visitor(entry))
+                    {
+                        if(resultOut)
+                            resultOut->push_back(entry);
+                    }
                 }
             }
             return;
@@ -486,13 +691,14 @@ void OsmAnd::ObfMapSection::readMapObjectsBlock(
                 gpb::uint32 length;
                 cis->ReadVarint32(&length);
                 auto oldLimit = cis->PushLimit(length);
-                auto pos = cis->CurrentPosition();
                 std::shared_ptr<OsmAnd::Model::MapObject> mapObject;
-                readMapObject(reader, section, tree, baseId, mapObject, bbox31);
+                std::shared_ptr<Model::MapObjectsArena> arena;
+                readMapObject(reader, cis, section, tree, baseId, mapObject, arena, bbox31, arenaSelector, buffers);
                 if(mapObject)
                 {
                     mapObject->_foundation = tree->_foundation;
                     intermediateResult.push_back(mapObject);
+                    intermediateResultArenas.push_back(arena);
                 }
                 cis->PopLimit(oldLimit);
             }
@@ -520,15 +726,21 @@ void OsmAnd::ObfMapSection::readMapObjectsBlock(
 }
 
 void OsmAnd::ObfMapSection::readMapObject(
-    ObfReader* reader,
+    ObfReader* reader, gpb::io::CodedInputStream* cis,
     ObfMapSection* section,
     LevelTreeNode* treeNode,
     uint64_t baseId,
     std::shared_ptr<OsmAnd::Model::MapObject>& mapObject,
-    const AreaI* bbox31)
+    std::shared_ptr<Model::MapObjectsArena>& arena,
+    const AreaI* bbox31,
+    const ArenaSelector& arenaSelector,
+    MapObjectBuffers& buffers)
 {
-    auto cis = reader->_codedInputStream.get();
-
+    buffers.clear();
+    auto hasObject = false;
+    auto isArea = false;
+    AreaI objectBBox31;
+    auto id = std::numeric_limits<uint64_t>::max();
     for(;;)
     {
         auto tag = cis->ReadTag();
@@ -536,42 +748,64 @@ void OsmAnd::ObfMapSection::readMapObject(
         switch(tgn)
         {
         case 0:
+            {
+                if(!hasObject)
+                    return;
+
+                // Finally, create the object, unless there's no arena for it
+                arena = arenaSelector(objectBBox31);
+                if(!arena)
+                    return;
+                mapObject = Model::MapObject::create(section, arena);
+                mapObject->_id = id;
+                mapObject->_isArea = isArea;
+                mapObject->_bbox31 = objectBBox31;
+                mapObject->_points31 = arena->copyArray(buffers.points31);
+                if(!buffers.innerPolygonsSizes.isEmpty())
+                {
+                    const auto innerPolygonsPoints31 = arena->copyArray(buffers.innerPolygonsPoints31);
+                    mapObject->_innerPolygonsPoints31 = arena->allocateArray< Model::ArenaArray<PointI> >(buffers.innerPolygonsSizes.size());
+                    const auto pPolygons = mapObject->_innerPolygonsPoints31.data();
+                    auto pPolygonPoints = const_cast<PointI*>(innerPolygonsPoints31.constData());
+                    for(auto polygonIdx = 0; polygonIdx < buffers.innerPolygonsSizes.size(); polygonIdx++)
+                    {
+                        const auto polygonSize = buffers.innerPolygonsSizes[polygonIdx];
+
+                        new(&pPolygons[polygonIdx]) Model::ArenaArray<PointI>(pPolygonPoints, polygonSize);
+                        pPolygonPoints += polygonSize;
+                    }
+                }
+                mapObject->_types = arena->copyArray(buffers.types);
+                mapObject->_extraTypes = arena->copyArray(buffers.extraTypes);
+                mapObject->_names = arena->copyArray(buffers.names);
+            }
             return;
         case OBF::MapData::kAreaCoordinatesFieldNumber:
         case OBF::MapData::kCoordinatesFieldNumber:
             {
-                QVector< PointI > points31;
+                auto& points31 = buffers.points31;
                 gpb::uint32 length;
                 cis->ReadVarint32(&length);
                 auto oldLimit = cis->PushLimit(length);
-                auto px = treeNode->_area31.left & MaskToRead;
-                auto py = treeNode->_area31.top & MaskToRead;
+                const PointI base31(treeNode->_area31.left & MaskToRead, treeNode->_area31.top & MaskToRead);
+                ObfReader::readDeltaPoints(cis, base31, ShiftCoordinates, points31);
                 auto minX = std::numeric_limits<int32_t>::max();
                 auto maxX = 0;
                 auto minY = std::numeric_limits<int32_t>::max();
                 auto maxY = 0;
                 bool contains = (bbox31 == nullptr);
-                while(cis->BytesUntilLimit() > 0)
+                const auto pointsCount = points31.size();
+                const auto pPoints = points31.constData();
+                for(auto pointIdx = 0; pointIdx < pointsCount; pointIdx++)
                 {
-                    //NOTE: Here was 'auto', but Apple LLVM didn't like it
-                    int32_t dx = (ObfReader::readSInt32(cis) << ShiftCoordinates);
-                    int32_t x = dx + px;
-                    int32_t dy = (ObfReader::readSInt32(cis) << ShiftCoordinates);
-                    int32_t y = dy + py;
-
-                    points31.push_back(PointI(x, y));
-                    
-                    px = x;
-                    py = y;
+                    const auto& point = pPoints[pointIdx];
+
                     if(!contains && bbox31)
-                        contains = bbox31->contains(x, y);
-                    if(!contains)
-                    {
-                        minX = qMin(minX, x);
-                        maxX = qMax(maxX, x);
-                        minY = qMin(minY, y);
-                        maxY = qMax(maxY, y);
-                    }
+                        contains = bbox31->contains(point);
+                    minX = qMin(minX, point.x);
+                    maxX = qMax(maxX, point.x);
+                    minY = qMin(minY, point.y);
+                    maxY = qMax(maxY, point.y);
                 }
                 if(!contains && bbox31)
                     contains = bbox31->contains(minX, minY) && bbox31->contains(maxX, maxY);
@@ -582,48 +816,31 @@ void OsmAnd::ObfMapSection::readMapObject(
                     return;
                 }
 
-                // Finally, create the object
-                if(!mapObject)
-                    mapObject.reset(new OsmAnd::Model::MapObject(section));
-                mapObject->_isArea = (tgn == OBF::MapData::kAreaCoordinatesFieldNumber);
-                mapObject->_points31 = points31;
-                mapObject->_bbox31.left = minX;
-                mapObject->_bbox31.right = maxX;
-                mapObject->_bbox31.top = maxY;
-                mapObject->_bbox31.bottom = minY;
+                hasObject = true;
+                isArea = (tgn == OBF::MapData::kAreaCoordinatesFieldNumber);
+                objectBBox31.left = minX;
+                objectBBox31.right = maxX;
+                objectBBox31.top = minY;
+                objectBBox31.bottom = maxY;
             }
             break;
         case OBF::MapData::kPolygonInnerCoordinatesFieldNumber:
             {
-                if(!mapObject)
-                    mapObject.reset(new OsmAnd::Model::MapObject(section));
+                hasObject = true;
 
                 gpb::uint32 length;
                 cis->ReadVarint32(&length);
                 auto oldLimit = cis->PushLimit(length);
-                auto px = treeNode->_area31.left & MaskToRead;
-                auto py = treeNode->_area31.top & MaskToRead;
-                mapObject->_innerPolygonsPoints31.push_back(QVector< PointI >());
-                auto& polygon = mapObject->_innerPolygonsPoints31.last();
-                while(cis->BytesUntilLimit() > 0)
-                {
-                    auto dx = (ObfReader::readSInt32(cis) << ShiftCoordinates);
-                    auto x = dx + px;
-                    auto dy = (ObfReader::readSInt32(cis) << ShiftCoordinates);
-                    auto y = dy + py;
-
-                    polygon.push_back(PointI(x, y));
-                    
-                    px = x;
-                    py = y;
-                }
+                const PointI base31(treeNode->_area31.left & MaskToRead, treeNode->_area31.top & MaskToRead);
+                const auto oldSize = buffers.innerPolygonsPoints31.size();
+                ObfReader::readDeltaPoints(cis, base31, ShiftCoordinates, buffers.innerPolygonsPoints31);
+                buffers.innerPolygonsSizes.push_back(buffers.innerPolygonsPoints31.size() - oldSize);
                 cis->PopLimit(oldLimit);
             }
             break;
         case OBF::MapData::kAdditionalTypesFieldNumber:
             {
-                if(!mapObject)
-                    mapObject.reset(new OsmAnd::Model::MapObject(section));
+                hasObject = true;
 
                 gpb::uint32 length;
                 cis->ReadVarint32(&length);
@@ -633,16 +850,17 @@ void OsmAnd::ObfMapSection::readMapObject(
                     gpb::uint32 type;
                     cis->ReadVarint32(&type);
 
-                    const auto& tagValue = section->_rules->_decodingRules[type];
-                    mapObject->_extraTypes.push_back(TagValue(std::get<0>(tagValue), std::get<1>(tagValue)));
+                    const auto& typeIds = section->_rules->_decodingRulesTypeIds;
+                    if(type >= static_cast<uint32_t>(typeIds.size()) || typeIds[type] == Model::TagValueDictionary::InvalidId)
+                        continue;
+                    buffers.extraTypes.push_back(typeIds[type]);
                 }
                 cis->PopLimit(oldLimit);
             }
             break;
         case OBF::MapData::kTypesFieldNumber:
             {
-                if(!mapObject)
-                    mapObject.reset(new OsmAnd::Model::MapObject(section));
+                hasObject = true;
 
                 gpb::uint32 length;
                 cis->ReadVarint32(&length);
@@ -652,8 +870,10 @@ void OsmAnd::ObfMapSection::readMapObject(
                     gpb::uint32 type;
                     cis->ReadVarint32(&type);
 
-                    const auto& tagValue = section->_rules->_decodingRules[type];
-                    mapObject->_types.push_back(TagValue(std::get<0>(tagValue), std::get<1>(tagValue)));
+                    const auto& typeIds = section->_rules->_decodingRulesTypeIds;
+                    if(type >= static_cast<uint32_t>(typeIds.size()) || typeIds[type] == Model::TagValueDictionary::InvalidId)
+                        continue;
+                    buffers.types.push_back(typeIds[type]);
                 }
                 cis->PopLimit(oldLimit);
             }
@@ -670,19 +890,14 @@ void OsmAnd::ObfMapSection::readMapObject(
                     gpb::uint32 stringId;
                     cis->ReadVarint32(&stringId);
 
-                    char fakeString[] = {
-                        '[',
-                        static_cast<char>((stringId >> 8*0) & 0xff),
-                        static_cast<char>((stringId >> 8*1) & 0xff),
-                        static_cast<char>((stringId >> 8*2) & 0xff),
-                        static_cast<char>((stringId >> 8*3) & 0xff),
-                        ']'
-                    };
-                    const auto& fakeQString = QString::fromLocal8Bit(fakeString, sizeof(fakeString));
-                    assert(fakeQString.length() == 6);
-
-                    const auto& tagName = std::get<0>(section->_rules->_decodingRules[stringTag]);
-                    mapObject->_names.insert(tagName, fakeQString);
+                    // Id of string is local to the block until block's string table is read
+                    const auto& typeIds = section->_rules->_decodingRulesTypeIds;
+                    if(stringTag >= static_cast<uint32_t>(typeIds.size()) || typeIds[stringTag] == Model::TagValueDictionary::InvalidId)
+                        continue;
+                    Model::MapObject::Name name;
+                    name.tagId = Model::TagValueDictionary::resolveTagId(typeIds[stringTag]);
+                    name.stringId = stringId;
+                    buffers.names.push_back(name);
                 }
                 cis->PopLimit(oldLimit);
             }
@@ -690,7 +905,7 @@ void OsmAnd::ObfMapSection::readMapObject(
         case OBF::MapData::kIdFieldNumber:
             {
                 auto d = ObfReader::readSInt64(cis);
-                mapObject->_id = d + baseId;
+                id = d + baseId;
             }
             break;
         default:
@@ -700,8 +915,31 @@ void OsmAnd::ObfMapSection::readMapObject(
     }
 }
 
+OsmAnd::ObfMapSection::MapObjectBuffers::MapObjectBuffers()
+{
+    // Reserved capacity is never released on clear(), so buffers only grow during a query
+    points31.reserve(1024);
+    innerPolygonsPoints31.reserve(256);
+    innerPolygonsSizes.reserve(16);
+    types.reserve(16);
+    extraTypes.reserve(16);
+    names.reserve(16);
+}
+
+void OsmAnd::ObfMapSection::MapObjectBuffers::clear()
+{
+    points31.resize(0);
+    innerPolygonsPoints31.resize(0);
+    innerPolygonsSizes.resize(0);
+    types.resize(0);
+    extraTypes.resize(0);
+    names.resize(0);
+}
+
 OsmAnd::ObfMapSection::MapLevel::MapLevel()
-    : minZoom(_minZoom)
+    : _flatTreeNodesConsumedMemory(0)
+    , _isFlatTreeNodesOverBudget(false)
+    , minZoom(_minZoom)
     , maxZoom(_maxZoom)
     , length(_length)
     , area31(_area31)
@@ -710,6 +948,11 @@ OsmAnd::ObfMapSection::MapLevel::MapLevel()
 
 OsmAnd::ObfMapSection::MapLevel::~MapLevel()
 {
+    if(_flatTreeNodes)
+    {
+        QMutexLocker scopeLock(&ObfMapSection::_flatTreeNodesMemoryMutex);
+        ObfMapSection::_flatTreeNodesMemoryUsage -= _flatTreeNodesConsumedMemory;
+    }
 }
 
 OsmAnd::ObfMapSection::LevelTreeNode::LevelTreeNode()
@@ -718,6 +961,17 @@ OsmAnd::ObfMapSection::LevelTreeNode::LevelTreeNode()
 {
 }
 
+OsmAnd::ObfMapSection::FlatTreeNode::FlatTreeNode( const LevelTreeNode& node )
+    : _top(node._area31.top)
+    , _left(node._area31.left)
+    , _bottom(node._area31.bottom)
+    , _right(node._area31.right)
+    , _dataOffset(node._dataOffset)
+    , _subtreeEnd(0)
+    , _foundation(node._foundation)
+{
+}
+
 OsmAnd::ObfMapSection::Rules::Rules()
     : _nameEncodingType(0)
     , _refEncodingType(-1)
@@ -16,10 +16,8 @@ OsmAnd::ObfPoiSection::~ObfPoiSection()
 {
 }
 
-void OsmAnd::ObfPoiSection::read( ObfReader* reader, ObfPoiSection* section)
+void OsmAnd::ObfPoiSection::read( ObfReader* reader, gpb::io::CodedInputStream* cis, ObfPoiSection* section)
 {
-    auto cis = reader->_codedInputStream.get();
-
     for(;;)
     {
         auto tag = cis->ReadTag();
@@ -35,7 +33,7 @@ void OsmAnd::ObfPoiSection::read( ObfReader* reader, ObfPoiSection* section)
                 gpb::uint32 length;
                 cis->ReadVarint32(&length);
                 auto oldLimit = cis->PushLimit(length);
-                readBoundaries(reader, section);
+                readBoundaries(reader, cis, section);
                 cis->PopLimit(oldLimit);
             }
             break; 
@@ -49,10 +47,20 @@ void OsmAnd::ObfPoiSection::read( ObfReader* reader, ObfPoiSection* section)
     }
 }
 
-void OsmAnd::ObfPoiSection::readCategories( ObfReader* reader, ObfPoiSection* section, QList< std::shared_ptr<OsmAnd::Model::Amenity::Category> >& categories )
+void OsmAnd::ObfPoiSection::saveStructure( QDataStream& stream, const ObfPoiSection* section )
+{
+    ObfSection::saveStructure(stream, section);
+    stream << section->_area31.top << section->_area31.left << section->_area31.bottom << section->_area31.right;
+}
+
+void OsmAnd::ObfPoiSection::loadStructure( QDataStream& stream, ObfPoiSection* section )
 {
-    auto cis = reader->_codedInputStream.get();
+    ObfSection::loadStructure(stream, section);
+    stream >> section->_area31.top >> section->_area31.left >> section->_area31.bottom >> section->_area31.right;
+}
 
+void OsmAnd::ObfPoiSection::readCategories( ObfReader* reader, gpb::io::CodedInputStream* cis, ObfPoiSection* section, QList< std::shared_ptr<OsmAnd::Model::Amenity::Category> >& categories )
+{
     for(;;)
     {
         auto tag = cis->ReadTag();
@@ -68,7 +76,7 @@ void OsmAnd::ObfPoiSection::readCategories( ObfReader* reader, ObfPoiSection* se
                 gpb::uint32 length;
                 cis->ReadVarint32(&length);
                 auto oldLimit = cis->PushLimit(length);
-                readBoundaries(reader, section);
+                readBoundaries(reader, cis, section);
                 cis->PopLimit(oldLimit);
             }
             break; 
@@ -78,7 +86,7 @@ void OsmAnd::ObfPoiSection::readCategories( ObfReader* reader, ObfPoiSection* se
                 cis->ReadVarint32(&length);
                 auto oldLimit = cis->PushLimit(length);
                 std::shared_ptr<Model::Amenity::Category> category(new Model::Amenity::Category());
-                readCategory(reader, category.get());
+                readCategory(reader, cis, category.get());
                 cis->PopLimit(oldLimit);
                 categories.push_back(category);
             }
@@ -93,10 +101,8 @@ void OsmAnd::ObfPoiSection::readCategories( ObfReader* reader, ObfPoiSection* se
     }
 }
 
-void OsmAnd::ObfPoiSection::readBoundaries( ObfReader* reader, ObfPoiSection* section )
+void OsmAnd::ObfPoiSection::readBoundaries( ObfReader* reader, gpb::io::CodedInputStream* cis, ObfPoiSection* section )
 {
-    auto cis = reader->_codedInputStream.get();
-
     for(;;)
     {
         auto tag = cis->ReadTag();
@@ -123,10 +129,8 @@ void OsmAnd::ObfPoiSection::readBoundaries( ObfReader* reader, ObfPoiSection* se
     }
 }
 
-void OsmAnd::ObfPoiSection::readCategory( ObfReader* reader, OsmAnd::Model::Amenity::Category* category )
+void OsmAnd::ObfPoiSection::readCategory( ObfReader* reader, gpb::io::CodedInputStream* cis, OsmAnd::Model::Amenity::Category* category )
 {
-    auto cis = reader->_codedInputStream.get();
-
     for(;;)
     {
         auto tag = cis->ReadTag();
@@ -153,10 +157,13 @@ void OsmAnd::ObfPoiSection::readCategory( ObfReader* reader, OsmAnd::Model::Amen
 
 void OsmAnd::ObfPoiSection::loadCategories( OsmAnd::ObfReader* reader, OsmAnd::ObfPoiSection* section, QList< std::shared_ptr<OsmAnd::Model::Amenity::Category> >& categories )
 {
-    auto cis = reader->_codedInputStream.get();
+    reader->ensureSectionsRead(ObfReader::SectionType::Poi);
+
+    ObfReader::ScopedCursor cursor(reader);
+    auto cis = cursor.cis;
     cis->Seek(section->_offset);
     auto oldLimit = cis->PushLimit(section->_length);
-    readCategories(reader, section, categories);
+    readCategories(reader, cis, section, categories);
     cis->PopLimit(oldLimit);
 }
 
@@ -168,22 +175,24 @@ void OsmAnd::ObfPoiSection::loadAmenities(
     std::function<bool (const std::shared_ptr<OsmAnd::Model::Amenity>&)> visitor /*= nullptr*/,
     IQueryController* controller /*= nullptr*/ )
 {
-    auto cis = reader->_codedInputStream.get();
+    reader->ensureSectionsRead(ObfReader::SectionType::Poi);
+
+    ObfReader::ScopedCursor cursor(reader);
+    auto cis = cursor.cis;
     cis->Seek(section->_offset);
     auto oldLimit = cis->PushLimit(section->_length);
-    readAmenities(reader, section, desiredCategories, amenitiesOut, zoom, zoomDepth, bbox31, visitor, controller);
+    readAmenities(reader, cis, section, desiredCategories, amenitiesOut, zoom, zoomDepth, bbox31, visitor, controller);
     cis->PopLimit(oldLimit);
 }
 
 void OsmAnd::ObfPoiSection::readAmenities(
-    ObfReader* reader, ObfPoiSection* section,
+    ObfReader* reader, gpb::io::CodedInputStream* cis, ObfPoiSection* section,
     QSet<uint32_t>* desiredCategories,
     QList< std::shared_ptr<OsmAnd::Model::Amenity> >* amenitiesOut,
     uint32_t zoom, uint32_t zoomDepth, const AreaI* bbox31,
     std::function<bool (const std::shared_ptr<OsmAnd::Model::Amenity>&)> visitor,
     IQueryController* controller)
 {
-    auto cis = reader->_codedInputStream.get();
     QList< std::shared_ptr<Tile> > tiles;
     for(;;)
     {
@@ -196,7 +205,7 @@ void OsmAnd::ObfPoiSection::readAmenities(
             {
                 auto length = ObfReader::readBigEndianInt(cis);
                 auto oldLimit = cis->PushLimit(length);
-                readTile(reader, section, tiles, nullptr, desiredCategories, zoom, zoomDepth, bbox31, controller, nullptr);
+                readTile(reader, cis, section, tiles, nullptr, desiredCategories, zoom, zoomDepth, bbox31, controller, nullptr);
                 cis->PopLimit(oldLimit);
                 if(controller && controller->isAborted())
                     return;
@@ -217,7 +226,7 @@ void OsmAnd::ObfPoiSection::readAmenities(
                     cis->Seek(section->_offset + tile->_offset);
                     auto length = ObfReader::readBigEndianInt(cis);
                     auto oldLimit = cis->PushLimit(length);
-                    readAmenitiesFromTile(reader, section, tile.get(), desiredCategories, amenitiesOut, zoom, zoomDepth, bbox31, visitor, controller, nullptr);
+                    readAmenitiesFromTile(reader, cis, section, tile.get(), desiredCategories, amenitiesOut, zoom, zoomDepth, bbox31, visitor, controller, nullptr);
                     cis->PopLimit(oldLimit);
                     if(controller && controller->isAborted())
                         return;
@@ -233,7 +242,7 @@ void OsmAnd::ObfPoiSection::readAmenities(
 }
 
 bool OsmAnd::ObfPoiSection::readTile(
-    ObfReader* reader, ObfPoiSection* section,
+    ObfReader* reader, gpb::io::CodedInputStream* cis, ObfPoiSection* section,
     QList< std::shared_ptr<Tile> >& tiles,
     Tile* parent,
     QSet<uint32_t>* desiredCategories,
@@ -241,8 +250,6 @@ bool OsmAnd::ObfPoiSection::readTile(
     IQueryController* controller,
     QSet< uint64_t >* tilesToSkip)
 {
-    auto cis = reader->_codedInputStream.get();
-
     const auto zoomToSkip = zoom + zoomDepth;
     QSet< uint64_t > tilesToSkip_;
     if(parent == nullptr && !tilesToSkip)
@@ -314,7 +321,7 @@ bool OsmAnd::ObfPoiSection::readTile(
                 gpb::uint32 length;
                 cis->ReadLittleEndian32(&length);
                 auto oldLimit = cis->PushLimit(length);
-                const auto containsDesired = checkTileCategories(reader, section, desiredCategories);
+                const auto containsDesired = checkTileCategories(reader, cis, section, desiredCategories);
                 cis->PopLimit(oldLimit);
                 if(!containsDesired)
                 {
@@ -327,7 +334,7 @@ bool OsmAnd::ObfPoiSection::readTile(
             {
                 auto length = ObfReader::readBigEndianInt(cis);
                 auto oldLimit = cis->PushLimit(length);
-                auto tileOmitted = readTile(reader, section, tiles, tile.get(), desiredCategories, zoom, zoomDepth, bbox31, controller, tilesToSkip);
+                auto tileOmitted = readTile(reader, cis, section, tiles, tile.get(), desiredCategories, zoom, zoomDepth, bbox31, controller, tilesToSkip);
                 cis->PopLimit(oldLimit);
 
                 if(tilesToSkip && tile->_zoom >= zoomToSkip && tileOmitted)
@@ -365,9 +372,8 @@ bool OsmAnd::ObfPoiSection::readTile(
     }
 }
 
-bool OsmAnd::ObfPoiSection::checkTileCategories( ObfReader* reader, ObfPoiSection* section, QSet<uint32_t>* desiredCategories )
+bool OsmAnd::ObfPoiSection::checkTileCategories( ObfReader* reader, gpb::io::CodedInputStream* cis, ObfPoiSection* section, QSet<uint32_t>* desiredCategories )
 {
-    auto cis = reader->_codedInputStream.get();
     for(;;)
     {
         auto tag = cis->ReadTag();
@@ -399,7 +405,7 @@ bool OsmAnd::ObfPoiSection::checkTileCategories( ObfReader* reader, ObfPoiSectio
 }
 
 void OsmAnd::ObfPoiSection::readAmenitiesFromTile(
-    ObfReader* reader, ObfPoiSection* section, Tile* tile,
+    ObfReader* reader, gpb::io::CodedInputStream* cis, ObfPoiSection* section, Tile* tile,
     QSet<uint32_t>* desiredCategories,
     QList< std::shared_ptr<OsmAnd::Model::Amenity> >* amenitiesOut,
     uint32_t zoom, uint32_t zoomDepth, const AreaI* bbox31,
@@ -407,8 +413,6 @@ void OsmAnd::ObfPoiSection::readAmenitiesFromTile(
     IQueryController* controller,
     QSet< uint64_t >* amenitiesToSkip)
 {
-    auto cis = reader->_codedInputStream.get();
-
     const auto zoomToSkip = zoom + zoomDepth;
     QSet< uint64_t > amenitiesToSkip_;
     if(!amenitiesToSkip)
@@ -454,7 +458,7 @@ void OsmAnd::ObfPoiSection::readAmenitiesFromTile(
                 cis->ReadVarint32(&length);
                 auto oldLimit = cis->PushLimit(length);
                 std::shared_ptr<Model::Amenity> amenity;
-                readAmenity(reader, section, pTile, zoomTile, amenity, desiredCategories, bbox31, controller);
+                readAmenity(reader, cis, section, pTile, zoomTile, amenity, desiredCategories, bbox31, controller);
                 cis->PopLimit(oldLimit);
                 if(!amenity)
                     break;
@@ -494,14 +498,13 @@ void OsmAnd::ObfPoiSection::readAmenitiesFromTile(
 }
 
 void OsmAnd::ObfPoiSection::readAmenity(
-    ObfReader* reader, ObfPoiSection* section,
+    ObfReader* reader, gpb::io::CodedInputStream* cis, ObfPoiSection* section,
     const PointI& pTile, uint32_t pzoom,
     std::shared_ptr<Model::Amenity>& amenity,
     QSet<uint32_t>* desiredCategories,
     const AreaI* bbox31,
     IQueryController* controller)
 {
-    auto cis = reader->_codedInputStream.get();
     PointI point;
     uint32_t catId;
     uint32_t subId;
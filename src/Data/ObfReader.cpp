@@ -5,17 +5,26 @@
 #include "OsmAndCore/Logging.h"
 
 #include "QZeroCopyInputStream.h"
+#include "QMemoryMappedZeroCopyInputStream.h"
 #include <google/protobuf/wire_format_lite.h>
 #include <QtEndian>
+#include <QFileDevice>
 
 #include "OBF.pb.h"
 
 namespace gpb = google::protobuf;
 
-OsmAnd::ObfReader::ObfReader( const std::shared_ptr<QIODevice>& input )
-    : _codedInputStream(new gpb::io::CodedInputStream(new QZeroCopyInputStream(input)))
+OsmAnd::ObfReader::ObfReader( const std::shared_ptr<QIODevice>& input, const QString& structureCacheFilename /*= QString()*/, const bool lazySectionsReading /*= false*/ )
+    : _primaryCursor(new Cursor(createZeroCopyInputStream(input)))
+    , _isThreadSafe(dynamic_cast<QMemoryMappedZeroCopyInputStream*>(_primaryCursor->zeroCopyInputStream.get()) != nullptr)
+    , _version(0)
+    , _creationTimestamp(0)
     , _isBasemap(false)
+    , _isLazy(lazySectionsReading)
+    , _unreadSectionTypesMask(0)
     , source(input)
+    , isLazy(_isLazy)
+    , isThreadSafe(_isThreadSafe)
     , version(_version)
     , creationTimestamp(_creationTimestamp)
     , isBaseMap(_isBasemap)
@@ -26,34 +35,48 @@ OsmAnd::ObfReader::ObfReader( const std::shared_ptr<QIODevice>& input )
     , transportSections(_transportSections)
     , sections(_sections)
 {
-    _codedInputStream->SetTotalBytesLimit(std::numeric_limits<int>::max(), std::numeric_limits<int>::max());
+    // Reader is not shared with other threads until constructed, so primary cursor is idle for them
+    if(_isThreadSafe)
+        _idleCursors.push_back(_primaryCursor);
+    const auto cis = _primaryCursor->codedInputStream.get();
 
     bool loadedCorrectly = false;
     for(;;)
     {
-        auto tag = _codedInputStream->ReadTag();
+        auto tag = cis->ReadTag();
         switch(gpb::internal::WireFormatLite::GetTagFieldNumber(tag))
         {
         case 0:
             if(!loadedCorrectly)
                 throw std::invalid_argument("Corrupted file. It should be ended as it starts with version");
+            if(!structureCacheFilename.isEmpty() && !_isLazy)
+                saveStructureCache(structureCacheFilename);
             return;
         case OBF::OsmAndStructure::kVersionFieldNumber:
-            _codedInputStream->ReadVarint32(reinterpret_cast<gpb::uint32*>(&_version));
+            cis->ReadVarint32(reinterpret_cast<gpb::uint32*>(&_version));
             break;
         case OBF::OsmAndStructure::kDateCreatedFieldNumber:
-            _codedInputStream->ReadVarint64(reinterpret_cast<gpb::uint64*>(&_creationTimestamp));
+            cis->ReadVarint64(reinterpret_cast<gpb::uint64*>(&_creationTimestamp));
+
+            // Version and creation timestamp precede all sections, so cached structure can replace the rest of the file
+            if(!structureCacheFilename.isEmpty() && loadStructureCache(structureCacheFilename))
+                return;
             break;
         case OBF::OsmAndStructure::kMapIndexFieldNumber:
             {
                 std::shared_ptr<ObfMapSection> section(new ObfMapSection(this));
-                section->_length = ObfReader::readBigEndianInt(_codedInputStream.get());
-                section->_offset = _codedInputStream->CurrentPosition();
-                auto oldLimit = _codedInputStream->PushLimit(section->_length);
-                ObfMapSection::read(this, section.get());
-                _isBasemap = _isBasemap || section->isBaseMap;
-                _codedInputStream->PopLimit(oldLimit);
-                _codedInputStream->Seek(section->_offset + section->_length);
+                section->_length = ObfReader::readBigEndianInt(cis);
+                section->_offset = cis->CurrentPosition();
+                if(!_isLazy)
+                {
+                    auto oldLimit = cis->PushLimit(section->_length);
+                    ObfMapSection::read(this, cis, section.get());
+                    _isBasemap = _isBasemap || section->isBaseMap;
+                    cis->PopLimit(oldLimit);
+                }
+                else
+                    _unreadSectionTypesMask.fetchAndOrRelaxed(1 << static_cast<int>(SectionType::Map));
+                cis->Seek(section->_offset + section->_length);
                 _mapSections.push_back(section);
                 _sections.push_back(dynamic_cast<ObfSection*>(section.get()));
             }
@@ -61,12 +84,17 @@ OsmAnd::ObfReader::ObfReader( const std::shared_ptr<QIODevice>& input )
         case OBF::OsmAndStructure::kAddressIndexFieldNumber:
             {
                 std::shared_ptr<ObfAddressSection> section(new ObfAddressSection(this));
-                section->_length = ObfReader::readBigEndianInt(_codedInputStream.get());
-                section->_offset = _codedInputStream->CurrentPosition();
-                auto oldLimit = _codedInputStream->PushLimit(section->_length);
-                ObfAddressSection::read(this, section.get());
-                _codedInputStream->PopLimit(oldLimit);
-                _codedInputStream->Seek(section->_offset + section->_length);
+                section->_length = ObfReader::readBigEndianInt(cis);
+                section->_offset = cis->CurrentPosition();
+                if(!_isLazy)
+                {
+                    auto oldLimit = cis->PushLimit(section->_length);
+                    ObfAddressSection::read(this, cis, section.get());
+                    cis->PopLimit(oldLimit);
+                }
+                else
+                    _unreadSectionTypesMask.fetchAndOrRelaxed(1 << static_cast<int>(SectionType::Address));
+                cis->Seek(section->_offset + section->_length);
                 _addressSections.push_back(section);
                 _sections.push_back(dynamic_cast<ObfSection*>(section.get()));
             }
@@ -74,12 +102,17 @@ OsmAnd::ObfReader::ObfReader( const std::shared_ptr<QIODevice>& input )
         case OBF::OsmAndStructure::kTransportIndexFieldNumber:
             {
                 std::shared_ptr<ObfTransportSection> section(new ObfTransportSection(this));
-                section->_length = ObfReader::readBigEndianInt(_codedInputStream.get());
-                section->_offset = _codedInputStream->CurrentPosition();
-                auto oldLimit = _codedInputStream->PushLimit(section->_length);
-                ObfTransportSection::read(this, section.get());
-                _codedInputStream->PopLimit(oldLimit);
-                _codedInputStream->Seek(section->_offset + section->_length);
+                section->_length = ObfReader::readBigEndianInt(cis);
+                section->_offset = cis->CurrentPosition();
+                if(!_isLazy)
+                {
+                    auto oldLimit = cis->PushLimit(section->_length);
+                    ObfTransportSection::read(this, cis, section.get());
+                    cis->PopLimit(oldLimit);
+                }
+                else
+                    _unreadSectionTypesMask.fetchAndOrRelaxed(1 << static_cast<int>(SectionType::Transport));
+                cis->Seek(section->_offset + section->_length);
                 _transportSections.push_back(section);
                 _sections.push_back(dynamic_cast<ObfSection*>(section.get()));
             }
@@ -87,12 +120,17 @@ OsmAnd::ObfReader::ObfReader( const std::shared_ptr<QIODevice>& input )
         case OBF::OsmAndStructure::kRoutingIndexFieldNumber:
             {
                 std::shared_ptr<ObfRoutingSection> section(new ObfRoutingSection(this));
-                section->_length = ObfReader::readBigEndianInt(_codedInputStream.get());
-                section->_offset = _codedInputStream->CurrentPosition();
-                auto oldLimit = _codedInputStream->PushLimit(section->_length);
-                ObfRoutingSection::read(this, section);
-                _codedInputStream->PopLimit(oldLimit);
-                _codedInputStream->Seek(section->_offset + section->_length);
+                section->_length = ObfReader::readBigEndianInt(cis);
+                section->_offset = cis->CurrentPosition();
+                if(!_isLazy)
+                {
+                    auto oldLimit = cis->PushLimit(section->_length);
+                    ObfRoutingSection::read(this, cis, section);
+                    cis->PopLimit(oldLimit);
+                }
+                else
+                    _unreadSectionTypesMask.fetchAndOrRelaxed(1 << static_cast<int>(SectionType::Routing));
+                cis->Seek(section->_offset + section->_length);
                 _routingSections.push_back(section);
                 _sections.push_back(dynamic_cast<ObfSection*>(section.get()));
             }
@@ -100,12 +138,17 @@ OsmAnd::ObfReader::ObfReader( const std::shared_ptr<QIODevice>& input )
         case OBF::OsmAndStructure::kPoiIndexFieldNumber:
             {
                 std::shared_ptr<ObfPoiSection> section(new ObfPoiSection(this));
-                section->_length = ObfReader::readBigEndianInt(_codedInputStream.get());
-                section->_offset = _codedInputStream->CurrentPosition();
-                auto oldLimit = _codedInputStream->PushLimit(section->_length);
-                ObfPoiSection::read(this, section.get());
-                _codedInputStream->PopLimit(oldLimit);
-                _codedInputStream->Seek(section->_offset + section->_length);
+                section->_length = ObfReader::readBigEndianInt(cis);
+                section->_offset = cis->CurrentPosition();
+                if(!_isLazy)
+                {
+                    auto oldLimit = cis->PushLimit(section->_length);
+                    ObfPoiSection::read(this, cis, section.get());
+                    cis->PopLimit(oldLimit);
+                }
+                else
+                    _unreadSectionTypesMask.fetchAndOrRelaxed(1 << static_cast<int>(SectionType::Poi));
+                cis->Seek(section->_offset + section->_length);
                 _poiSections.push_back(section);
                 _sections.push_back(dynamic_cast<ObfSection*>(section.get()));
             }
@@ -113,7 +156,7 @@ OsmAnd::ObfReader::ObfReader( const std::shared_ptr<QIODevice>& input )
         case OBF::OsmAndStructure::kVersionConfirmFieldNumber:
             {
                 gpb::uint32 controlVersion;
-                _codedInputStream->ReadVarint32(&controlVersion);
+                cis->ReadVarint32(&controlVersion);
                 loadedCorrectly = (controlVersion == _version);
                 if(!loadedCorrectly)
                     break;
@@ -121,7 +164,7 @@ OsmAnd::ObfReader::ObfReader( const std::shared_ptr<QIODevice>& input )
             }
             break;
         default:
-            skipUnknownField(_codedInputStream.get(), tag);
+            skipUnknownField(cis, tag);
             break;
         }
     }
@@ -131,6 +174,113 @@ OsmAnd::ObfReader::~ObfReader()
 {
 }
 
+gpb::io::ZeroCopyInputStream* OsmAnd::ObfReader::createZeroCopyInputStream( const std::shared_ptr<QIODevice>& input )
+{
+    // Files are memory-mapped when possible, so that reading does not copy data
+    const auto file = std::dynamic_pointer_cast<QFileDevice>(input);
+    if(file)
+    {
+        std::unique_ptr<QMemoryMappedZeroCopyInputStream> mappedStream(new QMemoryMappedZeroCopyInputStream(file));
+        if(mappedStream->isMapped())
+            return mappedStream.release();
+
+        LogPrintf(LogSeverityLevel::Warning, "Failed to map '%s', falling back to buffered reading", qPrintable(file->fileName()));
+    }
+
+    return new QZeroCopyInputStream(input);
+}
+
+void OsmAnd::ObfReader::ensureSectionsRead( const SectionType type )
+{
+    const auto typeBit = 1 << static_cast<int>(type);
+    if((_unreadSectionTypesMask.loadAcquire() & typeBit) == 0)
+        return;
+
+    QMutexLocker scopeLock(&_lazySectionsMutex);
+
+    // Other thread may have read them while this one was waiting
+    if((_unreadSectionTypesMask.loadAcquire() & typeBit) == 0)
+        return;
+
+    ScopedCursor cursor(this);
+    const auto cis = cursor.cis;
+    const auto readSection = [cis](ObfSection* section, const std::function<void ()>& read)
+    {
+        cis->Seek(section->_offset);
+        auto oldLimit = cis->PushLimit(section->_length);
+        read();
+        cis->PopLimit(oldLimit);
+    };
+    switch(type)
+    {
+    case SectionType::Map:
+        for(auto itSection = _mapSections.cbegin(); itSection != _mapSections.cend(); ++itSection)
+        {
+            const auto& section = *itSection;
+            readSection(section.get(), [this, cis, section](){ ObfMapSection::read(this, cis, section.get()); });
+            _isBasemap = _isBasemap || section->isBaseMap;
+        }
+        break;
+    case SectionType::Address:
+        for(auto itSection = _addressSections.cbegin(); itSection != _addressSections.cend(); ++itSection)
+        {
+            const auto& section = *itSection;
+            readSection(section.get(), [this, cis, section](){ ObfAddressSection::read(this, cis, section.get()); });
+        }
+        break;
+    case SectionType::Routing:
+        for(auto itSection = _routingSections.cbegin(); itSection != _routingSections.cend(); ++itSection)
+        {
+            const auto& section = *itSection;
+            readSection(section.get(), [this, cis, section](){ ObfRoutingSection::read(this, cis, section); });
+        }
+        break;
+    case SectionType::Poi:
+        for(auto itSection = _poiSections.cbegin(); itSection != _poiSections.cend(); ++itSection)
+        {
+            const auto& section = *itSection;
+            readSection(section.get(), [this, cis, section](){ ObfPoiSection::read(this, cis, section.get()); });
+        }
+        break;
+    case SectionType::Transport:
+        for(auto itSection = _transportSections.cbegin(); itSection != _transportSections.cend(); ++itSection)
+        {
+            const auto& section = *itSection;
+            readSection(section.get(), [this, cis, section](){ ObfTransportSection::read(this, cis, section.get()); });
+        }
+        break;
+    }
+
+    _unreadSectionTypesMask.fetchAndAndRelease(~typeBit);
+}
+
+std::shared_ptr<OsmAnd::ObfReader::Cursor> OsmAnd::ObfReader::acquireCursor()
+{
+    if(!_isThreadSafe)
+        return _primaryCursor;
+
+    {
+        QMutexLocker scopeLock(&_idleCursorsMutex);
+
+        if(!_idleCursors.isEmpty())
+            return _idleCursors.takeLast();
+    }
+
+    // Each query gets own cursor over shared mapping, so Seek/PushLimit of one query do not affect others
+    const auto mappedStream = static_cast<QMemoryMappedZeroCopyInputStream*>(_primaryCursor->zeroCopyInputStream.get());
+    return std::shared_ptr<Cursor>(new Cursor(mappedStream->clone()));
+}
+
+void OsmAnd::ObfReader::releaseCursor( const std::shared_ptr<Cursor>& cursor )
+{
+    if(!_isThreadSafe)
+        return;
+
+    // Number of idle cursors never exceeds number of queries that were running at once
+    QMutexLocker scopeLock(&_idleCursorsMutex);
+    _idleCursors.push_back(cursor);
+}
+
 void OsmAnd::ObfReader::skipUnknownField( gpb::io::CodedInputStream* cis, int tag )
 {
     auto wireType = gpb::internal::WireFormatLite::GetTagWireType(tag);
@@ -179,6 +329,25 @@ int64_t OsmAnd::ObfReader::readSInt64( gpb::io::CodedInputStream* cis )
     return decodedValue;
 }
 
+OsmAnd::ObfReader::Cursor::Cursor( gpb::io::ZeroCopyInputStream* zeroCopyInputStream_ )
+    : zeroCopyInputStream(zeroCopyInputStream_)
+    , codedInputStream(new gpb::io::CodedInputStream(zeroCopyInputStream_))
+{
+    codedInputStream->SetTotalBytesLimit(std::numeric_limits<int>::max(), std::numeric_limits<int>::max());
+}
+
+OsmAnd::ObfReader::ScopedCursor::ScopedCursor( ObfReader* reader )
+    : _reader(reader)
+    , _cursor(reader->acquireCursor())
+    , cis(_cursor->codedInputStream.get())
+{
+}
+
+OsmAnd::ObfReader::ScopedCursor::~ScopedCursor()
+{
+    _reader->releaseCursor(_cursor);
+}
+
 QString OsmAnd::ObfReader::transliterate( QString input )
 {
     return QString("!translit!");
@@ -0,0 +1,136 @@
+#include "ObfReader.h"
+
+#include <QByteArray>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#   define OSMAND_DELTA_POINTS_SSE2 1
+#   include <emmintrin.h>
+#endif
+
+namespace OsmAnd {
+
+    static inline bool decodeVarint32(const uint8_t*& p, const uint8_t* const pEnd, uint32_t& value)
+    {
+        value = 0;
+        for(auto shift = 0; p != pEnd; shift += 7)
+        {
+            const auto byte = *(p++);
+            // Bits above 32nd are dropped, same as CodedInputStream::ReadVarint32() does
+            if(shift < 32)
+                value |= static_cast<uint32_t>(byte & 0x7f) << shift;
+            if((byte & 0x80) == 0)
+                return true;
+            if(shift >= 63)
+                return false;
+        }
+        return false;
+    }
+
+    static inline uint32_t zigZagDecode32(const uint32_t value)
+    {
+        return (value >> 1) ^ (0u - (value & 1));
+    }
+
+    static void decodeDeltaPoints(const uint8_t* p, const uint8_t* const pEnd, const PointI& base31, const uint32_t shift, QVector<PointI>& pointsOut)
+    {
+        static_assert(sizeof(PointI) == 2 * sizeof(int32_t), "PointI is expected to be a pair of packed int32_t");
+
+        // Each varint ends with a byte that has high bit clear, so points count is known before decoding
+        // and storage is allocated exactly once
+        auto varintsCount = 0;
+        for(auto pByte = p; pByte != pEnd; ++pByte)
+            varintsCount += ((*pByte & 0x80) == 0) ? 1 : 0;
+        const auto oldSize = pointsOut.size();
+        pointsOut.reserve(oldSize + varintsCount / 2);
+        pointsOut.resize(oldSize + varintsCount / 2);
+        const auto pPointsBegin = pointsOut.data();
+        auto pPoint = pPointsBegin + oldSize;
+
+        auto x = static_cast<uint32_t>(base31.x);
+        auto y = static_cast<uint32_t>(base31.y);
+#if OSMAND_DELTA_POINTS_SSE2
+        const auto zero = _mm_setzero_si128();
+        const auto one = _mm_set1_epi32(1);
+        const auto shiftCount = _mm_cvtsi32_si128(static_cast<int>(shift));
+        while(pEnd - p >= 16)
+        {
+            const auto bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+            if(_mm_movemask_epi8(bytes) != 0)
+            {
+                // Some of next 16 varints are multi-byte ones, so step over one point using scalar code
+                uint32_t dx, dy;
+                if(!decodeVarint32(p, pEnd, dx) || !decodeVarint32(p, pEnd, dy))
+                    break;
+                x += zigZagDecode32(dx) << shift;
+                y += zigZagDecode32(dy) << shift;
+                *(pPoint++) = PointI(static_cast<int32_t>(x), static_cast<int32_t>(y));
+                continue;
+            }
+
+            // All 16 bytes are single-byte varints, that is 8 points. Each pair of points is
+            // zigzag-decoded and shifted, then prefix-summed on top of previous point.
+            auto carry = _mm_set_epi32(static_cast<int>(y), static_cast<int>(x), static_cast<int>(y), static_cast<int>(x));
+            const auto words0 = _mm_unpacklo_epi8(bytes, zero);
+            const auto words1 = _mm_unpackhi_epi8(bytes, zero);
+            const __m128i values[4] = {
+                _mm_unpacklo_epi16(words0, zero),
+                _mm_unpackhi_epi16(words0, zero),
+                _mm_unpacklo_epi16(words1, zero),
+                _mm_unpackhi_epi16(words1, zero)
+            };
+            for(auto idx = 0; idx < 4; idx++)
+            {
+                const auto& value = values[idx];
+
+                auto delta = _mm_xor_si128(_mm_srli_epi32(value, 1), _mm_sub_epi32(zero, _mm_and_si128(value, one)));
+                delta = _mm_sll_epi32(delta, shiftCount);
+                auto sum = _mm_add_epi32(delta, _mm_slli_si128(delta, 8));
+                sum = _mm_add_epi32(sum, carry);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(pPoint), sum);
+                pPoint += 2;
+                carry = _mm_shuffle_epi32(sum, _MM_SHUFFLE(3, 2, 3, 2));
+            }
+            x = static_cast<uint32_t>(_mm_cvtsi128_si32(carry));
+            y = static_cast<uint32_t>(_mm_cvtsi128_si32(_mm_shuffle_epi32(carry, _MM_SHUFFLE(1, 1, 1, 1))));
+            p += 16;
+        }
+#endif
+        while(p < pEnd)
+        {
+            uint32_t dx, dy;
+            if(!decodeVarint32(p, pEnd, dx) || !decodeVarint32(p, pEnd, dy))
+                break;
+            x += zigZagDecode32(dx) << shift;
+            y += zigZagDecode32(dy) << shift;
+            *(pPoint++) = PointI(static_cast<int32_t>(x), static_cast<int32_t>(y));
+        }
+
+        pointsOut.resize(static_cast<int>(pPoint - pPointsBegin));
+    }
+
+} // namespace OsmAnd
+
+void OsmAnd::ObfReader::readDeltaPoints( gpb::io::CodedInputStream* cis, const PointI& base31, const uint32_t shift, QVector<PointI>& pointsOut )
+{
+    const auto length = cis->BytesUntilLimit();
+    if(length <= 0)
+        return;
+
+    // Blob is decoded in-place if it's entirely in current buffer of the stream (that's always so
+    // for memory-mapped files), otherwise it's copied out first
+    const void* pBuffer = nullptr;
+    int bufferSize = 0;
+    if(cis->GetDirectBufferPointer(&pBuffer, &bufferSize) && bufferSize >= length)
+    {
+        const auto pBlob = static_cast<const uint8_t*>(pBuffer);
+        decodeDeltaPoints(pBlob, pBlob + length, base31, shift, pointsOut);
+        cis->Skip(length);
+        return;
+    }
+
+    QByteArray blob(length, Qt::Uninitialized);
+    if(!cis->ReadRaw(blob.data(), length))
+        return;
+    const auto pBlob = reinterpret_cast<const uint8_t*>(blob.constData());
+    decodeDeltaPoints(pBlob, pBlob + length, base31, shift, pointsOut);
+}
@@ -0,0 +1,194 @@
+#include "ObfReader.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QFileDevice>
+#include <QDateTime>
+#include <QDataStream>
+
+#include "OsmAndCore/Logging.h"
+
+#include "OBF.pb.h"
+
+bool OsmAnd::ObfReader::obtainSourceFileInfo( qint64& sizeOut, qint64& modificationTimeOut ) const
+{
+    const auto file = std::dynamic_pointer_cast<QFileDevice>(source);
+    if(!file || file->fileName().isEmpty())
+        return false;
+
+    const QFileInfo fileInfo(file->fileName());
+    if(!fileInfo.exists())
+        return false;
+
+    sizeOut = fileInfo.size();
+    modificationTimeOut = fileInfo.lastModified().toMSecsSinceEpoch();
+    return true;
+}
+
+bool OsmAnd::ObfReader::loadStructureCache( const QString& filename )
+{
+    qint64 fileSize;
+    qint64 fileModificationTime;
+    if(!obtainSourceFileInfo(fileSize, fileModificationTime))
+        return false;
+
+    QFile cacheFile(filename);
+    if(!cacheFile.open(QIODevice::ReadOnly))
+        return false;
+    QDataStream stream(&cacheFile);
+    stream.setVersion(QDataStream::Qt_5_0);
+
+    // Check that cache belongs to this exact file
+    quint32 magic = 0;
+    quint32 cacheVersion = 0;
+    stream >> magic >> cacheVersion;
+    if(magic != StructureCacheMagic || cacheVersion != StructureCacheVersion)
+        return false;
+    qint64 cachedFileSize = 0;
+    qint64 cachedFileModificationTime = 0;
+    qint64 cachedCreationTimestamp = 0;
+    qint32 cachedVersion = 0;
+    stream >> cachedFileSize >> cachedFileModificationTime >> cachedCreationTimestamp >> cachedVersion;
+    if(cachedFileSize != fileSize || cachedFileModificationTime != fileModificationTime ||
+        cachedCreationTimestamp != _creationTimestamp || cachedVersion != _version)
+    {
+        return false;
+    }
+
+    // Sections are loaded aside and accepted only if whole cache was read correctly
+    QList< std::shared_ptr<ObfMapSection> > mapSections;
+    QList< std::shared_ptr<ObfAddressSection> > addressSections;
+    QList< std::shared_ptr<ObfRoutingSection> > routingSections;
+    QList< std::shared_ptr<ObfPoiSection> > poiSections;
+    QList< std::shared_ptr<ObfTransportSection> > transportSections;
+    QList< ObfSection* > sections;
+    bool isBasemap = false;
+    quint32 sectionsCount = 0;
+    stream >> sectionsCount;
+    for(quint32 sectionIdx = 0; sectionIdx < sectionsCount && stream.status() == QDataStream::Ok; sectionIdx++)
+    {
+        quint32 sectionKind = 0;
+        stream >> sectionKind;
+        switch(sectionKind)
+        {
+        case OBF::OsmAndStructure::kMapIndexFieldNumber:
+            {
+                std::shared_ptr<ObfMapSection> section(new ObfMapSection(this));
+                ObfMapSection::loadStructure(stream, section.get());
+                isBasemap = isBasemap || section->isBaseMap;
+                mapSections.push_back(section);
+                sections.push_back(dynamic_cast<ObfSection*>(section.get()));
+            }
+            break;
+        case OBF::OsmAndStructure::kAddressIndexFieldNumber:
+            {
+                std::shared_ptr<ObfAddressSection> section(new ObfAddressSection(this));
+                ObfAddressSection::loadStructure(stream, section.get());
+                addressSections.push_back(section);
+                sections.push_back(dynamic_cast<ObfSection*>(section.get()));
+            }
+            break;
+        case OBF::OsmAndStructure::kTransportIndexFieldNumber:
+            {
+                std::shared_ptr<ObfTransportSection> section(new ObfTransportSection(this));
+                ObfTransportSection::loadStructure(stream, section.get());
+                transportSections.push_back(section);
+                sections.push_back(dynamic_cast<ObfSection*>(section.get()));
+            }
+            break;
+        case OBF::OsmAndStructure::kRoutingIndexFieldNumber:
+            {
+                std::shared_ptr<ObfRoutingSection> section(new ObfRoutingSection(this));
+                ObfRoutingSection::loadStructure(stream, section);
+                routingSections.push_back(section);
+                sections.push_back(dynamic_cast<ObfSection*>(section.get()));
+            }
+            break;
+        case OBF::OsmAndStructure::kPoiIndexFieldNumber:
+            {
+                std::shared_ptr<ObfPoiSection> section(new ObfPoiSection(this));
+                ObfPoiSection::loadStructure(stream, section.get());
+                poiSections.push_back(section);
+                sections.push_back(dynamic_cast<ObfSection*>(section.get()));
+            }
+            break;
+        default:
+            LogPrintf(LogSeverityLevel::Warning, "Structure cache '%s' contains unknown section kind %u", qPrintable(filename), sectionKind);
+            return false;
+        }
+    }
+    if(stream.status() != QDataStream::Ok)
+    {
+        LogPrintf(LogSeverityLevel::Warning, "Structure cache '%s' is corrupted", qPrintable(filename));
+        return false;
+    }
+
+    _mapSections = mapSections;
+    _addressSections = addressSections;
+    _routingSections = routingSections;
+    _poiSections = poiSections;
+    _transportSections = transportSections;
+    _sections = sections;
+    _isBasemap = isBasemap;
+
+    return true;
+}
+
+void OsmAnd::ObfReader::saveStructureCache( const QString& filename ) const
+{
+    qint64 fileSize;
+    qint64 fileModificationTime;
+    if(!obtainSourceFileInfo(fileSize, fileModificationTime))
+        return;
+
+    QFile cacheFile(filename);
+    if(!cacheFile.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        LogPrintf(LogSeverityLevel::Warning, "Failed to write structure cache to '%s'", qPrintable(filename));
+        return;
+    }
+    QDataStream stream(&cacheFile);
+    stream.setVersion(QDataStream::Qt_5_0);
+
+    stream << static_cast<quint32>(StructureCacheMagic) << static_cast<quint32>(StructureCacheVersion);
+    stream << fileSize << fileModificationTime << static_cast<qint64>(_creationTimestamp) << static_cast<qint32>(_version);
+
+    // Sections are stored in file order, each prefixed with OBF field number of its kind
+    stream << static_cast<quint32>(_sections.size());
+    for(auto itSection = _sections.cbegin(); itSection != _sections.cend(); ++itSection)
+    {
+        const auto section = *itSection;
+
+        if(const auto mapSection = dynamic_cast<const ObfMapSection*>(section))
+        {
+            stream << static_cast<quint32>(OBF::OsmAndStructure::kMapIndexFieldNumber);
+            ObfMapSection::saveStructure(stream, mapSection);
+        }
+        else if(const auto addressSection = dynamic_cast<const ObfAddressSection*>(section))
+        {
+            stream << static_cast<quint32>(OBF::OsmAndStructure::kAddressIndexFieldNumber);
+            ObfAddressSection::saveStructure(stream, addressSection);
+        }
+        else if(const auto transportSection = dynamic_cast<const ObfTransportSection*>(section))
+        {
+            stream << static_cast<quint32>(OBF::OsmAndStructure::kTransportIndexFieldNumber);
+            ObfTransportSection::saveStructure(stream, transportSection);
+        }
+        else if(const auto routingSection = dynamic_cast<const ObfRoutingSection*>(section))
+        {
+            stream << static_cast<quint32>(OBF::OsmAndStructure::kRoutingIndexFieldNumber);
+            ObfRoutingSection::saveStructure(stream, routingSection);
+        }
+        else if(const auto poiSection = dynamic_cast<const ObfPoiSection*>(section))
+        {
+            stream << static_cast<quint32>(OBF::OsmAndStructure::kPoiIndexFieldNumber);
+            ObfPoiSection::saveStructure(stream, poiSection);
+        }
+    }
+
+    if(stream.status() != QDataStream::Ok)
+    {
+        LogPrintf(LogSeverityLevel::Warning, "Failed to write structure cache to '%s'", qPrintable(filename));
+        cacheFile.remove();
+    }
+}
@@ -21,10 +21,8 @@ OsmAnd::ObfRoutingSection::~ObfRoutingSection()
 {
 }
 
-void OsmAnd::ObfRoutingSection::read( ObfReader* reader, const std::shared_ptr<ObfRoutingSection>& section )
+void OsmAnd::ObfRoutingSection::read( ObfReader* reader, gpb::io::CodedInputStream* cis, const std::shared_ptr<ObfRoutingSection>& section )
 {
-    auto cis = reader->_codedInputStream.get();
-
     uint32_t routeEncodingRuleId = 1;
     for(;;)
     {
@@ -44,7 +42,7 @@ void OsmAnd::ObfRoutingSection::read( ObfReader* reader, const std::shared_ptr<O
                 auto oldLimit = cis->PushLimit(length);
                 std::shared_ptr<EncodingRule> encodingRule(new EncodingRule());
                 encodingRule->_id = routeEncodingRuleId++;
-                readEncodingRule(reader, section.get(), encodingRule.get());
+                readEncodingRule(reader, cis, section.get(), encodingRule.get());
                 while((unsigned)section->_encodingRules.size() < encodingRule->_id)
                     section->_encodingRules.push_back(std::shared_ptr<EncodingRule>());
                 section->_encodingRules.push_back(encodingRule);
@@ -58,7 +56,7 @@ void OsmAnd::ObfRoutingSection::read( ObfReader* reader, const std::shared_ptr<O
                 subsection->_length = ObfReader::readBigEndianInt(cis);
                 subsection->_offset = cis->CurrentPosition();
                 auto oldLimit = cis->PushLimit(subsection->_length);
-                readSubsectionHeader(reader, subsection, nullptr, 0);
+                readSubsectionHeader(reader, cis, subsection, nullptr, 0);
                 if(tfn == OBF::OsmAndRoutingIndex::kRootBoxesFieldNumber)
                     section->_subsections.push_back(subsection);
                 else
@@ -94,10 +92,108 @@ void OsmAnd::ObfRoutingSection::read( ObfReader* reader, const std::shared_ptr<O
     }
 }
 
-void OsmAnd::ObfRoutingSection::readEncodingRule( ObfReader* reader, ObfRoutingSection* section, EncodingRule* rule )
+void OsmAnd::ObfRoutingSection::saveStructure( QDataStream& stream, const ObfRoutingSection* section )
+{
+    ObfSection::saveStructure(stream, section);
+
+    // Encoding rules are stored with gaps, since rule index is rule id
+    stream << static_cast<quint32>(section->_encodingRules.size());
+    for(auto itEncodingRule = section->_encodingRules.cbegin(); itEncodingRule != section->_encodingRules.cend(); ++itEncodingRule)
+    {
+        const auto& encodingRule = *itEncodingRule;
+
+        stream << static_cast<bool>(encodingRule);
+        if(!encodingRule)
+            continue;
+        stream << encodingRule->_id << encodingRule->_tag << encodingRule->_value;
+        stream << static_cast<quint32>(encodingRule->_type) << encodingRule->_parsedValue.asUnsignedInt;
+    }
+
+    stream << section->_borderBoxOffset << section->_borderBoxLength;
+    stream << section->_baseBorderBoxOffset << section->_baseBorderBoxLength;
+
+    stream << static_cast<quint32>(section->_subsections.size());
+    for(auto itSubsection = section->_subsections.cbegin(); itSubsection != section->_subsections.cend(); ++itSubsection)
+        saveSubsectionStructure(stream, itSubsection->get());
+    stream << static_cast<quint32>(section->_baseSubsections.size());
+    for(auto itSubsection = section->_baseSubsections.cbegin(); itSubsection != section->_baseSubsections.cend(); ++itSubsection)
+        saveSubsectionStructure(stream, itSubsection->get());
+}
+
+void OsmAnd::ObfRoutingSection::saveSubsectionStructure( QDataStream& stream, const Subsection* subsection )
+{
+    stream << subsection->_offset << subsection->_length;
+    stream << subsection->_area31.top << subsection->_area31.left << subsection->_area31.bottom << subsection->_area31.right;
+    stream << subsection->_dataOffset << subsection->_subsectionsOffset;
+
+    stream << static_cast<quint32>(subsection->_subsections.size());
+    for(auto itSubsection = subsection->_subsections.cbegin(); itSubsection != subsection->_subsections.cend(); ++itSubsection)
+        saveSubsectionStructure(stream, itSubsection->get());
+}
+
+void OsmAnd::ObfRoutingSection::loadStructure( QDataStream& stream, const std::shared_ptr<ObfRoutingSection>& section )
+{
+    ObfSection::loadStructure(stream, section.get());
+
+    quint32 encodingRulesCount = 0;
+    stream >> encodingRulesCount;
+    for(quint32 encodingRuleIdx = 0; encodingRuleIdx < encodingRulesCount && stream.status() == QDataStream::Ok; encodingRuleIdx++)
+    {
+        bool isPresent = false;
+        stream >> isPresent;
+        if(!isPresent)
+        {
+            section->_encodingRules.push_back(std::shared_ptr<EncodingRule>());
+            continue;
+        }
+
+        std::shared_ptr<EncodingRule> encodingRule(new EncodingRule());
+        quint32 type;
+        stream >> encodingRule->_id >> encodingRule->_tag >> encodingRule->_value;
+        stream >> type >> encodingRule->_parsedValue.asUnsignedInt;
+        encodingRule->_type = static_cast<EncodingRule::Type>(type);
+        section->_encodingRules.push_back(encodingRule);
+    }
+
+    stream >> section->_borderBoxOffset >> section->_borderBoxLength;
+    stream >> section->_baseBorderBoxOffset >> section->_baseBorderBoxLength;
+
+    quint32 subsectionsCount = 0;
+    stream >> subsectionsCount;
+    for(quint32 subsectionIdx = 0; subsectionIdx < subsectionsCount && stream.status() == QDataStream::Ok; subsectionIdx++)
+    {
+        std::shared_ptr<Subsection> subsection(new Subsection(section));
+        loadSubsectionStructure(stream, subsection);
+        section->_subsections.push_back(subsection);
+    }
+    quint32 baseSubsectionsCount = 0;
+    stream >> baseSubsectionsCount;
+    for(quint32 subsectionIdx = 0; subsectionIdx < baseSubsectionsCount && stream.status() == QDataStream::Ok; subsectionIdx++)
+    {
+        std::shared_ptr<Subsection> subsection(new Subsection(section));
+        loadSubsectionStructure(stream, subsection);
+        section->_baseSubsections.push_back(subsection);
+    }
+}
+
+void OsmAnd::ObfRoutingSection::loadSubsectionStructure( QDataStream& stream, const std::shared_ptr<Subsection>& subsection )
 {
-    auto cis = reader->_codedInputStream.get();
+    stream >> subsection->_offset >> subsection->_length;
+    stream >> subsection->_area31.top >> subsection->_area31.left >> subsection->_area31.bottom >> subsection->_area31.right;
+    stream >> subsection->_dataOffset >> subsection->_subsectionsOffset;
+
+    quint32 subsectionsCount = 0;
+    stream >> subsectionsCount;
+    for(quint32 subsectionIdx = 0; subsectionIdx < subsectionsCount && stream.status() == QDataStream::Ok; subsectionIdx++)
+    {
+        std::shared_ptr<Subsection> childSubsection(new Subsection(subsection));
+        loadSubsectionStructure(stream, childSubsection);
+        subsection->_subsections.push_back(childSubsection);
+    }
+}
 
+void OsmAnd::ObfRoutingSection::readEncodingRule( ObfReader* reader, gpb::io::CodedInputStream* cis, ObfRoutingSection* section, EncodingRule* rule )
+{
     for(;;)
     {
         auto tag = cis->ReadTag();
@@ -177,11 +273,10 @@ void OsmAnd::ObfRoutingSection::readEncodingRule( ObfReader* reader, ObfRoutingS
     }
 }
 
-void OsmAnd::ObfRoutingSection::readSubsectionHeader( ObfReader* reader, const std::shared_ptr<Subsection>& subsection, Subsection* parent, uint32_t depth/* = std::numeric_limits<uint32_t>::max()*/ )
+void OsmAnd::ObfRoutingSection::readSubsectionHeader( ObfReader* reader, gpb::io::CodedInputStream* cis, const std::shared_ptr<Subsection>& subsection, Subsection* parent, uint32_t depth/* = std::numeric_limits<uint32_t>::max()*/ )
 {
     auto shouldReadSubsections = (depth > 0);
 
-    auto cis = reader->_codedInputStream.get();
     for(;;)
     {
         auto lastPos = cis->CurrentPosition();
@@ -235,7 +330,7 @@ void OsmAnd::ObfRoutingSection::readSubsectionHeader( ObfReader* reader, const s
                 childSubsection->_length = ObfReader::readBigEndianInt(cis);
                 childSubsection->_offset = cis->CurrentPosition();
                 auto oldLimit = cis->PushLimit(childSubsection->_length);
-                readSubsectionHeader(reader, childSubsection, subsection.get(), depth - 1);
+                readSubsectionHeader(reader, cis, childSubsection, subsection.get(), depth - 1);
                 subsection->_subsections.push_back(childSubsection);
                 cis->PopLimit(oldLimit);
             }
@@ -247,7 +342,7 @@ void OsmAnd::ObfRoutingSection::readSubsectionHeader( ObfReader* reader, const s
     }
 }
 
-void OsmAnd::ObfRoutingSection::readSubsectionChildrenHeaders( ObfReader* reader, const std::shared_ptr<Subsection>& subsection, uint32_t depth /*= std::numeric_limits<uint32_t>::max()*/ )
+void OsmAnd::ObfRoutingSection::readSubsectionChildrenHeaders( ObfReader* reader, gpb::io::CodedInputStream* cis, const std::shared_ptr<Subsection>& subsection, uint32_t depth /*= std::numeric_limits<uint32_t>::max()*/ )
 {
     if(!subsection->_subsectionsOffset)
         return;
@@ -256,7 +351,6 @@ void OsmAnd::ObfRoutingSection::readSubsectionChildrenHeaders( ObfReader* reader
     if(!shouldReadSubsections)
         return;
 
-    auto cis = reader->_codedInputStream.get();
     for(;;)
     {
         auto lastPos = cis->CurrentPosition();
@@ -276,7 +370,7 @@ void OsmAnd::ObfRoutingSection::readSubsectionChildrenHeaders( ObfReader* reader
                 childSubsection->_length = ObfReader::readBigEndianInt(cis);
                 childSubsection->_offset = cis->CurrentPosition();
                 auto oldLimit = cis->PushLimit(childSubsection->_length);
-                readSubsectionHeader(reader, childSubsection, subsection.get(), depth - 1);
+                readSubsectionHeader(reader, cis, childSubsection, subsection.get(), depth - 1);
                 subsection->_subsections.push_back(childSubsection);
                 cis->PopLimit(oldLimit);
             }
@@ -295,8 +389,17 @@ void OsmAnd::ObfRoutingSection::querySubsections(
     IQueryFilter* filter /*= nullptr*/,
     std::function<bool (const std::shared_ptr<Subsection>&)> visitor /*= nullptr*/ )
 {
-    auto cis = reader->_codedInputStream.get();
+    ObfReader::ScopedCursor cursor(reader);
+    querySubsections(reader, cursor.cis, in, resultOut, filter, visitor);
+}
 
+void OsmAnd::ObfRoutingSection::querySubsections(
+    ObfReader* reader, gpb::io::CodedInputStream* cis,
+    const QList< std::shared_ptr<Subsection> >& in,
+    QList< std::shared_ptr<Subsection> >* resultOut,
+    IQueryFilter* filter,
+    std::function<bool (const std::shared_ptr<Subsection>&)> visitor )
+{
     for(auto itSubsection = in.begin(); itSubsection != in.end(); ++itSubsection)
     {
         auto subsection = *itSubsection;
@@ -306,17 +409,22 @@ void OsmAnd::ObfRoutingSection::querySubsections(
             continue;
         
         // Load children if they are not yet loaded
-        if(subsection->_subsectionsOffset != 0 && subsection->_subsections.isEmpty())
+        if(subsection->_subsectionsOffset != 0)
         {
-            cis->Seek(subsection->_offset);
-            auto oldLimit = cis->PushLimit(subsection->_length);
-            cis->Skip(subsection->_subsectionsOffset - subsection->_offset);
-            const auto contains = !filter || filter->acceptsArea(subsection->_area31);
-            readSubsectionChildrenHeaders(reader, subsection, contains ? std::numeric_limits<uint32_t>::max() : 1);
-            cis->PopLimit(oldLimit);
+            QMutexLocker scopeLock(&subsection->section->_subsectionsLoadMutex);
+
+            if(subsection->_subsections.isEmpty())
+            {
+                cis->Seek(subsection->_offset);
+                auto oldLimit = cis->PushLimit(subsection->_length);
+                cis->Skip(subsection->_subsectionsOffset - subsection->_offset);
+                const auto contains = !filter || filter->acceptsArea(subsection->_area31);
+                readSubsectionChildrenHeaders(reader, cis, subsection, contains ? std::numeric_limits<uint32_t>::max() : 1);
+                cis->PopLimit(oldLimit);
+            }
         }
 
-        querySubsections(reader, subsection->_subsections, resultOut, filter, visitor);
+        querySubsections(reader, cis, subsection->_subsections, resultOut, filter, visitor);
 
         if(!visitor || visitor(subsection))
         {
@@ -333,18 +441,19 @@ void OsmAnd::ObfRoutingSection::loadSubsectionData(
     IQueryFilter* filter /*= nullptr*/,
     std::function<bool (const std::shared_ptr<OsmAnd::Model::Road>&)> visitor /*= nullptr*/ )
 {
-    auto cis = reader->_codedInputStream.get();
+    ObfReader::ScopedCursor cursor(reader);
+    auto cis = cursor.cis;
 
     cis->Seek(subsection->_offset + subsection->_dataOffset);
     gpb::uint32 length;
     cis->ReadVarint32(&length);
     auto oldLimit = cis->PushLimit(length);
-    readSubsectionData(reader, subsection, resultOut, resultMapOut, filter, visitor);
+    readSubsectionData(reader, cis, subsection, resultOut, resultMapOut, filter, visitor);
     cis->PopLimit(oldLimit);
 }
 
 void OsmAnd::ObfRoutingSection::readSubsectionData(
-    ObfReader* reader, const std::shared_ptr<Subsection>& subsection,
+    ObfReader* reader, gpb::io::CodedInputStream* cis, const std::shared_ptr<Subsection>& subsection,
     QList< std::shared_ptr<Model::Road> >* resultOut /*= nullptr*/,
     QMap< uint64_t, std::shared_ptr<Model::Road> >* resultMapOut /*= nullptr*/,
     IQueryFilter* filter /*= nullptr*/,
@@ -354,7 +463,6 @@ void OsmAnd::ObfRoutingSection::readSubsectionData(
     QList<uint64_t> roadsIdsTable;
     QMap< uint32_t, std::shared_ptr<Model::Road> > resultsByInternalId;
 
-    auto cis = reader->_codedInputStream.get();
     for(;;)
     {
         auto tag = cis->ReadTag();
@@ -394,7 +502,7 @@ void OsmAnd::ObfRoutingSection::readSubsectionData(
                 gpb::uint32 length;
                 cis->ReadVarint32(&length);
                 auto oldLimit = cis->PushLimit(length);
-                readSubsectionRoadsIds(reader, subsection.get(), roadsIdsTable);
+                readSubsectionRoadsIds(reader, cis, subsection.get(), roadsIdsTable);
                 cis->PopLimit(oldLimit);
             }
             break;
@@ -405,7 +513,7 @@ void OsmAnd::ObfRoutingSection::readSubsectionData(
                 auto oldLimit = cis->PushLimit(length);
                 std::shared_ptr<Model::Road> road(new Model::Road(subsection));
                 uint32_t internalId;
-                readRoad(reader, subsection.get(), roadsIdsTable, internalId, road.get());
+                readRoad(reader, cis, subsection.get(), roadsIdsTable, internalId, road.get());
                 resultsByInternalId.insert(internalId, road);
                 cis->PopLimit(oldLimit);
             }
@@ -415,7 +523,7 @@ void OsmAnd::ObfRoutingSection::readSubsectionData(
                 gpb::uint32 length;
                 cis->ReadVarint32(&length);
                 auto oldLimit = cis->PushLimit(length);
-                readSubsectionRestriction(reader, subsection.get(), resultsByInternalId, roadsIdsTable);
+                readSubsectionRestriction(reader, cis, subsection.get(), resultsByInternalId, roadsIdsTable);
                 cis->PopLimit(oldLimit);
             }
             break;
@@ -435,10 +543,8 @@ void OsmAnd::ObfRoutingSection::readSubsectionData(
     }
 }
 
-void OsmAnd::ObfRoutingSection::readSubsectionRoadsIds( ObfReader* reader, Subsection* subsection, QList<uint64_t>& ids )
+void OsmAnd::ObfRoutingSection::readSubsectionRoadsIds( ObfReader* reader, gpb::io::CodedInputStream* cis, Subsection* subsection, QList<uint64_t>& ids )
 {
-    auto cis = reader->_codedInputStream.get();
-
     uint64_t id = 0;
 
     for(;;)
@@ -461,13 +567,12 @@ void OsmAnd::ObfRoutingSection::readSubsectionRoadsIds( ObfReader* reader, Subse
     }
 }
 
-void OsmAnd::ObfRoutingSection::readSubsectionRestriction( ObfReader* reader, Subsection* subsection, const QMap< uint32_t, std::shared_ptr<Model::Road> >& roads, const QList<uint64_t>& roadsInternalIdToGlobalIdMap )
+void OsmAnd::ObfRoutingSection::readSubsectionRestriction( ObfReader* reader, gpb::io::CodedInputStream* cis, Subsection* subsection, const QMap< uint32_t, std::shared_ptr<Model::Road> >& roads, const QList<uint64_t>& roadsInternalIdToGlobalIdMap )
 {
     uint32_t originInternalId;
     uint32_t destinationInternalId;
     uint32_t restrictionType;
 
-    auto cis = reader->_codedInputStream.get();
     for(;;)
     {
         auto tag = cis->ReadTag();
@@ -502,9 +607,8 @@ void OsmAnd::ObfRoutingSection::readSubsectionRestriction( ObfReader* reader, Su
     }       
 }
 
-void OsmAnd::ObfRoutingSection::readRoad( ObfReader* reader, Subsection* subsection, const QList<uint64_t>& idsTable, uint32_t& internalId, Model::Road* road )
+void OsmAnd::ObfRoutingSection::readRoad( ObfReader* reader, gpb::io::CodedInputStream* cis, Subsection* subsection, const QList<uint64_t>& idsTable, uint32_t& internalId, Model::Road* road )
 {
-    auto cis = reader->_codedInputStream.get();
     for(;;)
     {
         auto tag = cis->ReadTag();
@@ -517,19 +621,10 @@ void OsmAnd::ObfRoutingSection::readRoad( ObfReader* reader, Subsection* subsect
                 gpb::uint32 length;
                 cis->ReadVarint32(&length);
                 auto oldLimit = cis->PushLimit(length);
-                auto dx = subsection->_area31.left >> ShiftCoordinates;
-                auto dy = subsection->_area31.top >> ShiftCoordinates;
-                while(cis->BytesUntilLimit() > 0)
-                {
-                    uint32_t x = ObfReader::readSInt32(cis) + dx;
-                    uint32_t y = ObfReader::readSInt32(cis) + dy;
-                    road->_points.push_back(PointI(
-                        x << ShiftCoordinates,
-                        y << ShiftCoordinates
-                        ));
-                    dx = x;
-                    dy = y;
-                }
+                const PointI base31(
+                    (subsection->_area31.left >> ShiftCoordinates) << ShiftCoordinates,
+                    (subsection->_area31.top >> ShiftCoordinates) << ShiftCoordinates);
+                ObfReader::readDeltaPoints(cis, base31, ShiftCoordinates, road->_points);
                 cis->PopLimit(oldLimit);
             }
             break;
@@ -626,15 +721,18 @@ void OsmAnd::ObfRoutingSection::loadSubsectionBorderBoxLinesPoints(
     std::function<bool (const std::shared_ptr<BorderLineHeader>&)> visitorLine /*= nullptr*/,
     std::function<bool (const std::shared_ptr<BorderLinePoint>&)> visitorPoint /*= nullptr*/)
 {
+    reader->ensureSectionsRead(ObfReader::SectionType::Routing);
+
     if(section->_borderBoxOffset == 0 || section->_borderBoxLength == 0)
         return;
 
-    auto cis = reader->_codedInputStream.get();
+    ObfReader::ScopedCursor cursor(reader);
+    auto cis = cursor.cis;
     cis->Seek(section->_borderBoxOffset);
     auto oldLimit = cis->PushLimit(section->_borderBoxLength);
 
     QList<uint32_t> pointsOffsets;
-    readBorderBoxLinesHeaders(reader, nullptr, filter,
+    readBorderBoxLinesHeaders(reader, cis, nullptr, filter,
         [&] (const std::shared_ptr<OsmAnd::ObfRoutingSection::BorderLineHeader>& borderLine)
         {
             auto valid = !visitorLine || visitorLine(borderLine);
@@ -657,18 +755,17 @@ void OsmAnd::ObfRoutingSection::loadSubsectionBorderBoxLinesPoints(
         cis->ReadVarint32(&length);
         auto oldLimit = cis->PushLimit(length);
 
-        readBorderLinePoints(reader, resultOut, filter, visitorPoint);
+        readBorderLinePoints(reader, cis, resultOut, filter, visitorPoint);
 
         cis->PopLimit(oldLimit);
     }
 }
 
-void OsmAnd::ObfRoutingSection::readBorderBoxLinesHeaders(ObfReader* reader, 
+void OsmAnd::ObfRoutingSection::readBorderBoxLinesHeaders(ObfReader* reader, gpb::io::CodedInputStream* cis, 
     QList< std::shared_ptr<BorderLineHeader> >* resultOut /*= nullptr*/,
     IQueryFilter* filter /*= nullptr*/,
     std::function<bool (const std::shared_ptr<BorderLineHeader>&)> visitor /*= nullptr*/)
 {
-    auto cis = reader->_codedInputStream.get();
     for(;;)
     {
         auto tag = cis->ReadTag();
@@ -684,7 +781,7 @@ void OsmAnd::ObfRoutingSection::readBorderBoxLinesHeaders(ObfReader* reader,
                 auto oldLimit = cis->PushLimit(length);
 
                 std::shared_ptr<BorderLineHeader> line(new BorderLineHeader());
-                readBorderLineHeader(reader, line.get(), offset);
+                readBorderLineHeader(reader, cis, line.get(), offset);
                 bool isValid = true;
                 if(filter)
                 {
@@ -716,9 +813,8 @@ void OsmAnd::ObfRoutingSection::readBorderBoxLinesHeaders(ObfReader* reader,
     }
 }
 
-void OsmAnd::ObfRoutingSection::readBorderLineHeader( ObfReader* reader, BorderLineHeader* borderLine, uint32_t outerOffset )
+void OsmAnd::ObfRoutingSection::readBorderLineHeader( ObfReader* reader, gpb::io::CodedInputStream* cis, BorderLineHeader* borderLine, uint32_t outerOffset )
 {
-    auto cis = reader->_codedInputStream.get();
     for(;;)
     {
         auto tag = cis->ReadTag();
@@ -751,14 +847,12 @@ void OsmAnd::ObfRoutingSection::readBorderLineHeader( ObfReader* reader, BorderL
 }
 
 void OsmAnd::ObfRoutingSection::readBorderLinePoints(
-    ObfReader* reader,
+    ObfReader* reader, gpb::io::CodedInputStream* cis,
     QList< std::shared_ptr<BorderLinePoint> >* resultOut /*= nullptr*/,
     IQueryFilter* filter /*= nullptr*/,
     std::function<bool (const std::shared_ptr<BorderLinePoint>&)> visitor /*= nullptr*/
     )
 {
-    auto cis = reader->_codedInputStream.get();
-
     PointI location;
     gpb::uint64 id;
 
@@ -784,7 +878,7 @@ void OsmAnd::ObfRoutingSection::readBorderLinePoints(
                 cis->ReadVarint32(&length);
                 auto oldLimit = cis->PushLimit(length);
                 std::shared_ptr<BorderLinePoint> point(new BorderLinePoint());
-                readBorderLinePoint(reader, point.get());
+                readBorderLinePoint(reader, cis, point.get());
                 point->_id += id;
                 point->_location += location;
                 bool valid = true;
@@ -806,10 +900,8 @@ void OsmAnd::ObfRoutingSection::readBorderLinePoints(
     }
 }
 
-void OsmAnd::ObfRoutingSection::readBorderLinePoint( ObfReader* reader, BorderLinePoint* point )
+void OsmAnd::ObfRoutingSection::readBorderLinePoint( ObfReader* reader, gpb::io::CodedInputStream* cis, BorderLinePoint* point )
 {
-    auto cis = reader->_codedInputStream.get();
-
     for(;;)
     {
         auto tag = cis->ReadTag();
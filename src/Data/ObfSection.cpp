@@ -11,3 +11,13 @@ OsmAnd::ObfSection::ObfSection( ObfReader* owner_ )
 OsmAnd::ObfSection::~ObfSection()
 {
 }
+
+void OsmAnd::ObfSection::saveStructure( QDataStream& stream, const ObfSection* section )
+{
+    stream << section->_name << section->_length << section->_offset;
+}
+
+void OsmAnd::ObfSection::loadStructure( QDataStream& stream, ObfSection* section )
+{
+    stream >> section->_name >> section->_length >> section->_offset;
+}
@@ -17,10 +17,8 @@ OsmAnd::ObfTransportSection::~ObfTransportSection()
 {
 }
 
-void OsmAnd::ObfTransportSection::read( ObfReader* reader, ObfTransportSection* section )
+void OsmAnd::ObfTransportSection::read( ObfReader* reader, gpb::io::CodedInputStream* cis, ObfTransportSection* section )
 {
-    auto cis = reader->_codedInputStream.get();
-
     for(;;)
     {
         auto tag = cis->ReadTag();
@@ -39,7 +37,7 @@ void OsmAnd::ObfTransportSection::read( ObfReader* reader, ObfTransportSection*
                 section->_stopsFileLength = ObfReader::readBigEndianInt(cis);
                 section->_stopsFileOffset = cis->CurrentPosition();
                 auto oldLimit = cis->PushLimit(section->_stopsFileLength);
-                readTransportBounds(reader, section);
+                readTransportBounds(reader, cis, section);
                 cis->PopLimit(oldLimit);
             }
             break;
@@ -66,10 +64,22 @@ void OsmAnd::ObfTransportSection::read( ObfReader* reader, ObfTransportSection*
     }
 }
 
-void OsmAnd::ObfTransportSection::readTransportBounds( ObfReader* reader, ObfTransportSection* section )
+void OsmAnd::ObfTransportSection::saveStructure( QDataStream& stream, const ObfTransportSection* section )
+{
+    ObfSection::saveStructure(stream, section);
+    stream << section->_stopsFileOffset << section->_stopsFileLength;
+    stream << section->_area24.top << section->_area24.left << section->_area24.bottom << section->_area24.right;
+}
+
+void OsmAnd::ObfTransportSection::loadStructure( QDataStream& stream, ObfTransportSection* section )
 {
-    auto cis = reader->_codedInputStream.get();
+    ObfSection::loadStructure(stream, section);
+    stream >> section->_stopsFileOffset >> section->_stopsFileLength;
+    stream >> section->_area24.top >> section->_area24.left >> section->_area24.bottom >> section->_area24.right;
+}
 
+void OsmAnd::ObfTransportSection::readTransportBounds( ObfReader* reader, gpb::io::CodedInputStream* cis, ObfTransportSection* section )
+{
     for(;;)
     {
         auto tag = cis->ReadTag();
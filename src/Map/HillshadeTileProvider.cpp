@@ -0,0 +1,327 @@
+#include "HillshadeTileProvider.h"
+
+#include <assert.h>
+#include <cmath>
+
+#include <SkBitmap.h>
+#include <SkColorPriv.h>
+
+#include "HeightmapTileProvider.h"
+#include "OsmAndCore/Utilities.h"
+#include "Logging.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#   define OSMAND_HILLSHADE_SSE2 1
+#   include <emmintrin.h>
+#endif
+
+namespace OsmAnd {
+
+    // Length of the equator in meters
+    static const double EquatorLength = 40075016.686;
+
+    // Shades size x size pixels using 3x3 neighbourhood of each heixel, so heightmap has to be 2 heixels larger.
+    // Gradient is estimated with Horn's method, and shade is the cosine of angle between the surface normal and
+    // the light, that is compared to the shade of flat surface: slopes that are lit less than flat ground get a
+    // shadow, slopes that are lit more are left transparent.
+    static void shadeHeightmap(
+        const float* pHeights, const size_t heightsStride,
+        const uint32_t size, const float cellSize,
+        const float lightAzimuth, const float lightAltitude, const float maxShadowAlpha,
+        uint32_t* pPixels, const size_t pixelsStride)
+    {
+        const auto azimuth = static_cast<float>(Utilities::toRadians(lightAzimuth));
+        const auto altitude = static_cast<float>(Utilities::toRadians(lightAltitude));
+        const auto sinAltitude = std::sin(altitude);
+        const auto lightX = std::cos(altitude) * std::sin(azimuth);
+        const auto lightY = std::cos(altitude) * std::cos(azimuth);
+        const auto gradientScale = 1.0f / (8.0f * cellSize);
+        const auto alphaScale = maxShadowAlpha / sinAltitude;
+#if OSMAND_HILLSHADE_SSE2
+        const auto two = _mm_set1_ps(2.0f);
+        const auto one = _mm_set1_ps(1.0f);
+        const auto zero = _mm_setzero_ps();
+        const auto vGradientScale = _mm_set1_ps(gradientScale);
+        const auto vSinAltitude = _mm_set1_ps(sinAltitude);
+        const auto vLightX = _mm_set1_ps(lightX);
+        const auto vLightY = _mm_set1_ps(lightY);
+        const auto vAlphaScale = _mm_set1_ps(alphaScale);
+        const auto vMaxShadowAlpha = _mm_set1_ps(maxShadowAlpha);
+#endif
+
+        for(auto y = 0u; y < size; y++)
+        {
+            const auto pTop = pHeights + y * heightsStride;
+            const auto pMiddle = pTop + heightsStride;
+            const auto pBottom = pMiddle + heightsStride;
+            const auto pRow = pPixels + y * pixelsStride;
+
+            auto x = 0u;
+#if OSMAND_HILLSHADE_SSE2
+            for(; x + 4 <= size; x += 4)
+            {
+                // a b c
+                // d . f
+                // g h i
+                const auto a = _mm_loadu_ps(pTop + x);
+                const auto b = _mm_loadu_ps(pTop + x + 1);
+                const auto c = _mm_loadu_ps(pTop + x + 2);
+                const auto d = _mm_loadu_ps(pMiddle + x);
+                const auto f = _mm_loadu_ps(pMiddle + x + 2);
+                const auto g = _mm_loadu_ps(pBottom + x);
+                const auto h = _mm_loadu_ps(pBottom + x + 1);
+                const auto i = _mm_loadu_ps(pBottom + x + 2);
+
+                const auto dzdx = _mm_mul_ps(vGradientScale, _mm_sub_ps(
+                    _mm_add_ps(_mm_add_ps(c, _mm_mul_ps(two, f)), i),
+                    _mm_add_ps(_mm_add_ps(a, _mm_mul_ps(two, d)), g)));
+                const auto dzdy = _mm_mul_ps(vGradientScale, _mm_sub_ps(
+                    _mm_add_ps(_mm_add_ps(g, _mm_mul_ps(two, h)), i),
+                    _mm_add_ps(_mm_add_ps(a, _mm_mul_ps(two, b)), c)));
+
+                // Rows go southwards, so northward gradient is -dzdy
+                const auto lighting = _mm_add_ps(_mm_sub_ps(vSinAltitude, _mm_mul_ps(dzdx, vLightX)), _mm_mul_ps(dzdy, vLightY));
+                const auto normalLengthSquared = _mm_add_ps(one, _mm_add_ps(_mm_mul_ps(dzdx, dzdx), _mm_mul_ps(dzdy, dzdy)));
+                const auto shade = _mm_mul_ps(lighting, _mm_rsqrt_ps(normalLengthSquared));
+
+                auto alpha = _mm_sub_ps(vMaxShadowAlpha, _mm_mul_ps(shade, vAlphaScale));
+                alpha = _mm_min_ps(_mm_max_ps(alpha, zero), vMaxShadowAlpha);
+
+                // Shadow is black, so premultiplied color has only alpha component
+                const auto pixels = _mm_slli_epi32(_mm_cvtps_epi32(alpha), SK_A32_SHIFT);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(pRow + x), pixels);
+            }
+#endif
+            for(; x < size; x++)
+            {
+                const auto a = pTop[x];
+                const auto b = pTop[x + 1];
+                const auto c = pTop[x + 2];
+                const auto d = pMiddle[x];
+                const auto f = pMiddle[x + 2];
+                const auto g = pBottom[x];
+                const auto h = pBottom[x + 1];
+                const auto i = pBottom[x + 2];
+
+                const auto dzdx = ((c + 2.0f * f + i) - (a + 2.0f * d + g)) * gradientScale;
+                const auto dzdy = ((g + 2.0f * h + i) - (a + 2.0f * b + c)) * gradientScale;
+
+                const auto lighting = sinAltitude - dzdx * lightX + dzdy * lightY;
+                const auto shade = lighting / std::sqrt(1.0f + dzdx * dzdx + dzdy * dzdy);
+
+                const auto alpha = qBound(0.0f, maxShadowAlpha - shade * alphaScale, maxShadowAlpha);
+                pRow[x] = SkPackARGB32(static_cast<U8CPU>(qRound(alpha)), 0, 0, 0);
+            }
+        }
+    }
+
+} // namespace OsmAnd
+
+OsmAnd::HillshadeTileProvider::HillshadeTileProvider( const QDir& storagePath_ )
+    : _lightAzimuth(315.0f)
+    , _heightmapProvider(new HeightmapTileProvider(storagePath_))
+    , _tasksCount(0)
+    , _isDestroying(false)
+    , _bitmapsCache(32 * 1024)
+    , storagePath(storagePath_)
+    , indexFilePath(_indexFilePath)
+{
+}
+
+OsmAnd::HillshadeTileProvider::~HillshadeTileProvider()
+{
+    // Requests that are in progress refer to this provider, so wait until all of them are done
+    QMutexLocker scopeLock(&_requestsMutex);
+    _isDestroying = true;
+    while(_tasksCount > 0)
+        _tasksFinishedCondition.wait(&_requestsMutex);
+}
+
+void OsmAnd::HillshadeTileProvider::setIndexFilePath( const QString& indexFilePath )
+{
+    QMutexLocker scopeLock(&_heightmapProviderMutex);
+
+    // Index of TileDB is bound on creation, so heightmap provider is replaced. Requests that are in progress
+    // keep previous one alive until they are done.
+    _indexFilePath = indexFilePath;
+    _heightmapProvider.reset(new HeightmapTileProvider(storagePath, _indexFilePath));
+}
+
+void OsmAnd::HillshadeTileProvider::rebuildIndex()
+{
+    QMutexLocker scopeLock(&_heightmapProviderMutex);
+
+    _heightmapProvider->rebuildTileDbIndex();
+}
+
+void OsmAnd::HillshadeTileProvider::setLightAzimuth( float lightAzimuth )
+{
+    QMutexLocker scopeLock(&_lightAzimuthMutex);
+
+    _lightAzimuth = lightAzimuth;
+}
+
+float OsmAnd::HillshadeTileProvider::getLightAzimuth() const
+{
+    QMutexLocker scopeLock(&_lightAzimuthMutex);
+
+    return _lightAzimuth;
+}
+
+float OsmAnd::HillshadeTileProvider::getTileDensity() const
+{
+    return 1.0f;
+}
+
+uint32_t OsmAnd::HillshadeTileProvider::getTileSize() const
+{
+    // Border heixels of heightmap tile are only used as neighbours
+    return 256;
+}
+
+bool OsmAnd::HillshadeTileProvider::obtainTileImmediate( const TileId& tileId, uint32_t zoom, std::shared_ptr<IMapTileProvider::Tile>& tile )
+{
+    CachedBitmapKey key;
+    key.tileId = tileId;
+    key.zoom = zoom;
+    key.lightAzimuth = getLightAzimuth();
+
+    QMutexLocker scopeLock(&_bitmapsCacheMutex);
+
+    const auto pBitmap = _bitmapsCache.object(key);
+    if(!pBitmap)
+        return false;
+
+    tile.reset(new Tile(*pBitmap));
+    return true;
+}
+
+void OsmAnd::HillshadeTileProvider::obtainTileDeffered( const TileId& tileId, uint32_t zoom, TileReadyCallback readyCallback )
+{
+    assert(readyCallback != nullptr);
+    assert(zoom < _requests.size());
+
+    {
+        QMutexLocker scopeLock(&_requestsMutex);
+        if(_isDestroying || zoom >= _requests.size())
+        {
+            scopeLock.unlock();
+            readyCallback(tileId, zoom, std::shared_ptr<IMapTileProvider::Tile>(), false);
+            return;
+        }
+
+        // Duplicate request is served together with the one that is already in progress
+        const auto itRequest = _requests[zoom].find(tileId);
+        if(itRequest != _requests[zoom].end())
+        {
+            itRequest->push_back(readyCallback);
+            return;
+        }
+
+        _requests[zoom].insert(tileId, QList<TileReadyCallback>() << readyCallback);
+        _tasksCount++;
+    }
+
+    std::shared_ptr<HeightmapTileProvider> heightmapProvider;
+    {
+        QMutexLocker scopeLock(&_heightmapProviderMutex);
+        heightmapProvider = _heightmapProvider;
+    }
+
+    // Tile is shaded right on the worker that has decoded heightmap tile. Callback holds heightmap
+    // provider, so that it's not destroyed while the request is in progress. Provider itself waits
+    // for all requests in its destructor.
+    const auto lightAzimuth = getLightAzimuth();
+    heightmapProvider->obtainTileDeffered(tileId, zoom,
+        [this, heightmapProvider, lightAzimuth](const TileId& tileId, uint32_t zoom, const std::shared_ptr<IMapTileProvider::Tile>& heightmapTile, bool success)
+        {
+            bool isDestroying;
+            QList<TileReadyCallback> callbacks;
+            {
+                QMutexLocker scopeLock(&_requestsMutex);
+                isDestroying = _isDestroying;
+                callbacks = _requests[zoom].take(tileId);
+            }
+
+            // Requests are not shaded during destruction, but each of them is still answered
+            std::shared_ptr<IMapTileProvider::Tile> tile;
+            if(isDestroying)
+                success = false;
+            else if(success && heightmapTile)
+            {
+                const auto bitmap = shadeTile(tileId, zoom, lightAzimuth, heightmapTile);
+                if(bitmap)
+                    tile.reset(new Tile(bitmap));
+                else
+                    success = false;
+            }
+
+            for(auto itCallback = callbacks.begin(); itCallback != callbacks.end(); ++itCallback)
+            {
+                const auto& callback = *itCallback;
+
+                callback(tileId, zoom, tile, success);
+            }
+            finishTask();
+        });
+}
+
+void OsmAnd::HillshadeTileProvider::finishTask()
+{
+    QMutexLocker scopeLock(&_requestsMutex);
+
+    if(--_tasksCount == 0)
+        _tasksFinishedCondition.wakeAll();
+}
+
+std::shared_ptr<SkBitmap> OsmAnd::HillshadeTileProvider::shadeTile( const TileId& tileId, uint32_t zoom, float lightAzimuth, const std::shared_ptr<IMapTileProvider::Tile>& heightmapTile )
+{
+    const auto tileSize = getTileSize();
+    if(heightmapTile->width != tileSize + 2 || heightmapTile->height != tileSize + 2)
+    {
+        LogPrintf(LogSeverityLevel::Error, "Height tile %dx%d@%d has %dx%d size instead of %d", tileId.x, tileId.y, zoom,
+            heightmapTile->width, heightmapTile->height, tileSize + 2);
+        return std::shared_ptr<SkBitmap>();
+    }
+
+    std::shared_ptr<SkBitmap> bitmap(new SkBitmap());
+    bitmap->setConfig(SkBitmap::kARGB_8888_Config, tileSize, tileSize);
+    if(!bitmap->allocPixels())
+    {
+        LogPrintf(LogSeverityLevel::Error, "Failed to allocate %dx%d bitmap\n", tileSize, tileSize);
+        return std::shared_ptr<SkBitmap>();
+    }
+
+    // Distance between heixels is taken at the middle of the tile, that's precise enough within single tile
+    const auto latitude = Utilities::getLatitudeFromTile(zoom, tileId.y + 0.5);
+    const auto tileLength = EquatorLength * std::cos(Utilities::toRadians(latitude)) / Utilities::getPowZoom(zoom);
+    const auto cellSize = static_cast<float>(tileLength / (heightmapTile->width - 1));
+
+    shadeHeightmap(
+        static_cast<const float*>(heightmapTile->data), heightmapTile->rowLength / sizeof(float),
+        tileSize, cellSize,
+        lightAzimuth, LightAltitude, MaxShadowAlpha,
+        bitmap->getAddr32(0, 0), bitmap->rowBytes() / sizeof(uint32_t));
+
+    {
+        QMutexLocker scopeLock(&_bitmapsCacheMutex);
+
+        CachedBitmapKey key;
+        key.tileId = tileId;
+        key.zoom = zoom;
+        key.lightAzimuth = lightAzimuth;
+        _bitmapsCache.insert(key, new std::shared_ptr<SkBitmap>(bitmap), static_cast<int>(bitmap->getSize() / 1024));
+    }
+
+    return bitmap;
+}
+
+OsmAnd::HillshadeTileProvider::Tile::Tile( const std::shared_ptr<SkBitmap>& bitmap )
+    : IMapBitmapTileProvider::Tile(bitmap->getPixels(), bitmap->rowBytes(), bitmap->width(), bitmap->height(), IMapBitmapTileProvider::RGBA_8888)
+    , _skBitmap(bitmap)
+{
+}
+
+OsmAnd::HillshadeTileProvider::Tile::~Tile()
+{
+}
@@ -1,5 +1,7 @@
 #include "MapDataCache.h"
 
+#include <QSet>
+
 #include "OsmAndCore/Utilities.h"
 #include "OsmAndCore/Logging.h"
 
@@ -107,17 +109,10 @@ void OsmAnd::MapDataCache::cacheObjects( const AreaI& area31, uint32_t zoom, IQu
     assert(areaZ.bottom >= 0 && areaZ.bottom <= (1 << zoom) - 1);
     assert(areaZ.right >= 0 && areaZ.right <= (1 << zoom) - 1);
 
-    const auto& area31_ = Utilities::areaLeftShift(areaZ, zoom);
-
-    assert(area31_.top >= 0 && area31_.top <= (1u << 31) - 1);
-    assert(area31_.left >= 0 && area31_.left <= (1u << 31) - 1);
-    assert(area31_.bottom >= 0 && area31_.bottom <= (1u << 31) - 1);
-    assert(area31_.right >= 0 && area31_.right <= (1u << 31) - 1);
-    
-    _sourcesMutex.lock();
-    const auto sources_ = _sources;
-    _sourcesMutex.unlock();
-
+    // Collect tiles that are not yet cached, and area that covers all of them
+    const auto tileShift = 31 - zoom;
+    QMap< TileId, std::shared_ptr<CachedTile> > uncachedTiles;
+    AreaI uncachedArea31;
     for(int32_t x = areaZ.left; x <= areaZ.right; x++)
     {
         if(controller && controller->isAborted())
@@ -125,9 +120,6 @@ void OsmAnd::MapDataCache::cacheObjects( const AreaI& area31, uint32_t zoom, IQu
 
         for(int32_t y = areaZ.top; y <= areaZ.bottom; y++)
         {
-            if(controller && controller->isAborted())
-                return;
-
             TileId tileId;
             tileId.x = x;
             tileId.y = y;
@@ -135,46 +127,142 @@ void OsmAnd::MapDataCache::cacheObjects( const AreaI& area31, uint32_t zoom, IQu
             if(cachedLevel._cachedTiles.contains(tileId))
                 continue;
 
-            for(auto itObf = sources_.begin(); itObf != sources_.end(); ++itObf)
+            std::shared_ptr<CachedTile> cachedTile(new CachedTile());
+            cachedTile->_approxConsumedMemory = 0;
+            cachedTile->_arena.reset(new Model::MapObjectsArena());
+            cachedTile->_area31.left = static_cast<int32_t>(static_cast<uint32_t>(x) << tileShift);
+            cachedTile->_area31.top = static_cast<int32_t>(static_cast<uint32_t>(y) << tileShift);
+            cachedTile->_area31.right = static_cast<int32_t>((static_cast<uint32_t>(x + 1) << tileShift) - 1);
+            cachedTile->_area31.bottom = static_cast<int32_t>((static_cast<uint32_t>(y + 1) << tileShift) - 1);
+
+            if(uncachedTiles.isEmpty())
+                uncachedArea31 = cachedTile->_area31;
+            else
             {
-                if(controller && controller->isAborted())
-                    return;
+                uncachedArea31.left = qMin(uncachedArea31.left, cachedTile->_area31.left);
+                uncachedArea31.top = qMin(uncachedArea31.top, cachedTile->_area31.top);
+                uncachedArea31.right = qMax(uncachedArea31.right, cachedTile->_area31.right);
+                uncachedArea31.bottom = qMax(uncachedArea31.bottom, cachedTile->_area31.bottom);
+            }
+            uncachedTiles.insert(tileId, cachedTile);
+        }
+    }
+    if(uncachedTiles.isEmpty())
+        return;
+    
+    _sourcesMutex.lock();
+    const auto sources_ = _sources;
+    _sourcesMutex.unlock();
 
-                const auto& obf = *itObf;
+    // All uncached tiles are loaded by single query per map section, so each data block is read once
+    // and in file order. Objects are allocated only if they overlap any uncached tile: from arena of that
+    // tile if it's the only one, otherwise from arena of their own. Every object is then put into each
+    // uncached tile it overlaps.
+    QList< QPair< std::shared_ptr<Model::MapObjectsArena>, QList< std::shared_ptr<CachedTile> > > > sharedObjectsArenas;
+    const auto getOverlappedTiles = [&](const AreaI& bbox31, QList< std::shared_ptr<CachedTile> >& outTiles)
+    {
+        const auto left = qMax(bbox31.left >> tileShift, areaZ.left);
+        const auto right = qMin(bbox31.right >> tileShift, areaZ.right);
+        const auto top = qMax(bbox31.top >> tileShift, areaZ.top);
+        const auto bottom = qMin(bbox31.bottom >> tileShift, areaZ.bottom);
+        for(int32_t x = left; x <= right; x++)
+        {
+            for(int32_t y = top; y <= bottom; y++)
+            {
+                TileId tileId;
+                tileId.x = x;
+                tileId.y = y;
 
-                for(auto itMapSection = obf->mapSections.begin(); itMapSection != obf->mapSections.end(); ++itMapSection)
-                {
-                    if(controller && controller->isAborted())
-                        return;
+                const auto& itTile = uncachedTiles.constFind(tileId);
+                if(itTile != uncachedTiles.cend())
+                    outTiles.push_back(*itTile);
+            }
+        }
+    };
+    QList< std::shared_ptr<CachedTile> > overlappedTiles;
+    const auto selectArena = [&](const AreaI& bbox31) -> std::shared_ptr<Model::MapObjectsArena>
+    {
+        overlappedTiles.clear();
+        getOverlappedTiles(bbox31, overlappedTiles);
+        if(overlappedTiles.isEmpty())
+            return std::shared_ptr<Model::MapObjectsArena>();
+        if(overlappedTiles.size() == 1)
+            return overlappedTiles.first()->_arena;
+
+        std::shared_ptr<Model::MapObjectsArena> arena(new Model::MapObjectsArena(SharedObjectArenaBlockSize));
+        sharedObjectsArenas.push_back(qMakePair(arena, overlappedTiles));
+        return arena;
+    };
+    uint64_t loadedObjects = 0;
+    const auto distributeObject = [&](const std::shared_ptr<OsmAnd::Model::MapObject>& object) -> bool
+    {
+        overlappedTiles.clear();
+        getOverlappedTiles(object->bbox31, overlappedTiles);
+        for(auto itTile = overlappedTiles.cbegin(); itTile != overlappedTiles.cend(); ++itTile)
+        {
+            const auto& cachedTile = *itTile;
 
-                    const auto& mapSection = *itMapSection;
+            cachedTile->_cachedObjects.push_back(object);
+        }
 
-                    std::shared_ptr<CachedTile> cachedArea(new CachedTile());
-                    cachedArea->_approxConsumedMemory = 0;
+        if(!overlappedTiles.isEmpty())
+            loadedObjects++;
 
-                    OsmAnd::ObfMapSection::loadMapObjects(obf.get(), mapSection.get(), zoom, &area31_, &cachedArea->_cachedObjects, nullptr, controller);
+        return false;
+    };
 
-                    _cachedObjects += cachedArea->_cachedObjects.size();
-                    for(auto itObject = cachedArea->_cachedObjects.begin(); itObject != cachedArea->_cachedObjects.end(); itObject++)
-                    {
-                        const auto& object = *itObject;
+    for(auto itObf = sources_.begin(); itObf != sources_.end(); ++itObf)
+    {
+        if(controller && controller->isAborted())
+            return;
 
-                        cachedArea->_approxConsumedMemory += object->calculateApproxConsumedMemory();
-                        _approxConsumedMemory += object->calculateApproxConsumedMemory();
-                    }
+        const auto& obf = *itObf;
 
-                    if(_approxConsumedMemory > _memoryLimit)
-                    {
-                        LogPrintf(LogSeverityLevel::Warning, "Map data cache approx. consumed memory (%llu) is over limit (%llu)",
-                            static_cast<uint64_t>(_approxConsumedMemory),
-                            static_cast<uint64_t>(_memoryLimit));
-                    }
+        for(auto itMapSection = obf->mapSections.begin(); itMapSection != obf->mapSections.end(); ++itMapSection)
+        {
+            if(controller && controller->isAborted())
+                return;
 
-                    cachedLevel._cachedTiles.insert(tileId, cachedArea);
-                }
-            }
+            const auto& mapSection = *itMapSection;
+
+            OsmAnd::ObfMapSection::loadMapObjects(obf.get(), mapSection.get(), zoom, &uncachedArea31, nullptr, distributeObject, controller, selectArena);
         }
     }
+
+    // Partially loaded tiles are not kept, since they would never be completed
+    if(controller && controller->isAborted())
+        return;
+
+    // Objects, their points, types, names and reference counters are all in arenas
+    for(auto itArena = sharedObjectsArenas.cbegin(); itArena != sharedObjectsArenas.cend(); ++itArena)
+    {
+        const auto& arena = itArena->first;
+        const auto& tiles = itArena->second;
+
+        const auto memoryShare = arena->allocatedMemory / tiles.size();
+        for(auto itTile = tiles.cbegin(); itTile != tiles.cend(); ++itTile)
+        {
+            const auto& cachedTile = *itTile;
+
+            cachedTile->_approxConsumedMemory += memoryShare;
+        }
+    }
+    for(auto itTile = uncachedTiles.cbegin(); itTile != uncachedTiles.cend(); ++itTile)
+    {
+        const auto& cachedTile = *itTile;
+
+        cachedTile->_approxConsumedMemory += cachedTile->_arena->allocatedMemory;
+        cachedLevel._cachedTiles.insert(itTile.key(), cachedTile);
+        _approxConsumedMemory += cachedTile->_approxConsumedMemory;
+    }
+    _cachedObjects += loadedObjects;
+
+    if(_approxConsumedMemory > _memoryLimit)
+    {
+        LogPrintf(LogSeverityLevel::Warning, "Map data cache approx. consumed memory (%llu) is over limit (%llu)",
+            static_cast<uint64_t>(_approxConsumedMemory),
+            static_cast<uint64_t>(_memoryLimit));
+    }
 }
 
 void OsmAnd::MapDataCache::obtainObjects( QList< std::shared_ptr<OsmAnd::Model::MapObject> >& resultOut, const AreaI& area31, uint32_t zoom, IQueryController* controller /*= nullptr*/ )
@@ -201,6 +289,8 @@ void OsmAnd::MapDataCache::CachedZoomLevel::obtainObjects( QList< std::shared_pt
     assert(areaZ.bottom >= 0 && areaZ.bottom <= (1 << zoom) - 1);
     assert(areaZ.right >= 0 && areaZ.right <= (1 << zoom) - 1);
 
+    QSet<const Model::MapObject*> processedObjects;
+
     for(int32_t x = areaZ.left; x <= areaZ.right; x++)
     {
         if(controller && controller->isAborted())
@@ -215,15 +305,21 @@ void OsmAnd::MapDataCache::CachedZoomLevel::obtainObjects( QList< std::shared_pt
             tileId.x = x;
             tileId.y = y;
 
-            const auto& itTile = _cachedTiles.find(tileId);
+            const auto& itTile = _cachedTiles.constFind(tileId);
+            if(itTile == _cachedTiles.cend())
+                continue;
             const auto& tile = *itTile;
 
             for(auto itObject = tile->_cachedObjects.begin(); itObject != tile->_cachedObjects.end(); itObject++)
             {
                 const auto& object = *itObject;
 
-                if(area31.intersects(object->bbox31))
+                // Objects that span several tiles are stored in each of them
+                if(area31.intersects(object->bbox31) && !processedObjects.contains(object.get()))
+                {
+                    processedObjects.insert(object.get());
                     resultOut.push_back(object);
+                }
             }
         }
     }
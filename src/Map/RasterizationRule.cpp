@@ -4,12 +4,15 @@
 
 #include "OsmAndCore/Logging.h"
 #include "OsmAndCore/Utilities.h"
+#include "TagValueDictionary.h"
 
 OsmAnd::RasterizationRule::RasterizationRule(RasterizationStyle* owner_, const QHash< QString, QString >& attributes)
-    : owner(owner_)
+    : _additionalTypeId(Model::TagValueDictionary::InvalidId)
+    , owner(owner_)
 {
     _valueDefinitionsRefs.reserve(attributes.size());
     _values.reserve(attributes.size());
+    _orderedValues.reserve(attributes.size());
     
     for(auto itAttribute = attributes.begin(); itAttribute != attributes.end(); ++itAttribute)
     {
@@ -47,6 +50,14 @@ OsmAnd::RasterizationRule::RasterizationRule(RasterizationStyle* owner_, const Q
         }
         
         _values.insert(key, parsedValue);
+        _orderedValues.push_back(parsedValue);
+
+        if(valueDef == RasterizationStyle::builtinValueDefinitions.INPUT_ADDITIONAL)
+        {
+            auto equalSignIdx = value.indexOf('=');
+            if(equalSignIdx >= 0)
+                _additionalTypeId = Model::TagValueDictionary::obtainId(value.mid(0, equalSignIdx), value.mid(equalSignIdx + 1));
+        }
     }
 }
 
@@ -0,0 +1,102 @@
+#include "RasterizationRulesetProgram.h"
+
+#include "TagValueDictionary.h"
+
+OsmAnd::RasterizationRulesetProgram::RasterizationRulesetProgram()
+{
+}
+
+OsmAnd::RasterizationRulesetProgram::~RasterizationRulesetProgram()
+{
+}
+
+std::shared_ptr<OsmAnd::RasterizationRulesetProgram> OsmAnd::RasterizationRulesetProgram::compile( const QMap< uint64_t, std::shared_ptr<RasterizationRule> >& rules )
+{
+    std::shared_ptr<RasterizationRulesetProgram> program(new RasterizationRulesetProgram());
+
+    // Merged styles share subtrees between rules, each of them is compiled once
+    QHash<RasterizationRule*, uint32_t> compiledRules;
+    program->_roots.reserve(rules.size());
+    for(auto itRule = rules.begin(); itRule != rules.end(); ++itRule)
+        program->_roots.insert(itRule.key(), program->compileRule(itRule.value(), compiledRules));
+
+    program->_nodes.squeeze();
+    program->_conditions.squeeze();
+    program->_outputs.squeeze();
+    program->_children.squeeze();
+
+    return program;
+}
+
+uint32_t OsmAnd::RasterizationRulesetProgram::compileRule( const std::shared_ptr<RasterizationRule>& rule, QHash<RasterizationRule*, uint32_t>& compiledRules )
+{
+    auto itCompiledRule = compiledRules.find(rule.get());
+    if(itCompiledRule != compiledRules.end())
+        return *itCompiledRule;
+
+    const auto nodeIndex = static_cast<uint32_t>(_nodes.size());
+    _nodes.push_back(Node());
+    compiledRules.insert(rule.get(), nodeIndex);
+
+    Node node;
+    node.conditionsBegin = _conditions.size();
+    node.outputsBegin = _outputs.size();
+    auto itValueDef = rule->_valueDefinitionsRefs.begin();
+    auto itValueData = rule->_orderedValues.begin();
+    for(; itValueDef != rule->_valueDefinitionsRefs.end(); ++itValueDef, ++itValueData)
+    {
+        const auto& valueDef = *itValueDef;
+        const auto& valueData = *itValueData;
+
+        if(valueDef->type == RasterizationStyle::ValueDefinition::Output)
+        {
+            Output output;
+            output.valueDefinitionId = valueDef->id;
+            output.value = valueData;
+            _outputs.push_back(output);
+            continue;
+        }
+
+        Condition condition;
+        condition.valueDefinitionId = valueDef->id;
+        condition.value = valueData;
+        if(valueDef == RasterizationStyle::builtinValueDefinitions.INPUT_MINZOOM)
+            condition.type = LessOrEqual;
+        else if(valueDef == RasterizationStyle::builtinValueDefinitions.INPUT_MAXZOOM)
+            condition.type = GreaterOrEqual;
+        else if(valueDef == RasterizationStyle::builtinValueDefinitions.INPUT_ADDITIONAL)
+        {
+            condition.type = (rule->_additionalTypeId != Model::TagValueDictionary::InvalidId) ? ContainsAdditional : Never;
+            condition.value.asUInt = rule->_additionalTypeId;
+            if(condition.type == ContainsAdditional)
+                _additionalTypeIds.insert(rule->_additionalTypeId);
+        }
+        else if(valueDef->dataType == RasterizationStyle::ValueDefinition::Float)
+            condition.type = FuzzyEqual;
+        else
+            condition.type = Equal;
+        _conditions.push_back(condition);
+    }
+    node.conditionsEnd = _conditions.size();
+    node.outputsEnd = _outputs.size();
+
+    // Children are compiled first, so that indices of each node's children are stored contiguously
+    QVector<uint32_t> ifElseChildren;
+    ifElseChildren.reserve(rule->_ifElseChildren.size());
+    for(auto itChild = rule->_ifElseChildren.begin(); itChild != rule->_ifElseChildren.end(); ++itChild)
+        ifElseChildren.push_back(compileRule(*itChild, compiledRules));
+    QVector<uint32_t> ifChildren;
+    ifChildren.reserve(rule->_ifChildren.size());
+    for(auto itChild = rule->_ifChildren.begin(); itChild != rule->_ifChildren.end(); ++itChild)
+        ifChildren.push_back(compileRule(*itChild, compiledRules));
+
+    node.ifElseChildrenBegin = _children.size();
+    _children += ifElseChildren;
+    node.ifElseChildrenEnd = _children.size();
+    node.ifChildrenBegin = _children.size();
+    _children += ifChildren;
+    node.ifChildrenEnd = _children.size();
+
+    _nodes[nodeIndex] = node;
+    return nodeIndex;
+}
@@ -2,6 +2,7 @@
 
 #include <cassert>
 #include <iostream>
+#include <limits>
 
 #include <QByteArray>
 #include <QBuffer>
@@ -11,11 +12,14 @@
 #include "OsmAndCore/Logging.h"
 #include "RasterizationStyles.h"
 #include "RasterizationRule.h"
+#include "RasterizationRulesetProgram.h"
 #include "EmbeddedResources.h"
+#include "TagValueDictionary.h"
 
 OsmAnd::RasterizationStyle::RasterizationStyle( RasterizationStyles* owner, const QString& embeddedResourceName )
     : owner(owner)
     , _firstNonBuiltinValueDefinitionIndex(0)
+    , _valueDefinitionsCount(_builtinValueDefinitionsCount)
     , _stringsIdBase(0)
     , _resourceName(embeddedResourceName)
     , resourceName(_resourceName)
@@ -23,6 +27,7 @@ OsmAnd::RasterizationStyle::RasterizationStyle( RasterizationStyles* owner, cons
     , title(_title)
     , name(_name)
     , parentName(_parentName)
+    , valueDefinitionsCount(_valueDefinitionsCount)
 {
     _name = QFileInfo(embeddedResourceName).fileName().replace(".render.xml", "");
     registerBuiltinValueDefinitions();
@@ -31,6 +36,7 @@ OsmAnd::RasterizationStyle::RasterizationStyle( RasterizationStyles* owner, cons
 OsmAnd::RasterizationStyle::RasterizationStyle( RasterizationStyles* owner, const QFileInfo& externalStyleFile )
     : owner(owner)
     , _firstNonBuiltinValueDefinitionIndex(0)
+    , _valueDefinitionsCount(_builtinValueDefinitionsCount)
     , _stringsIdBase(0)
     , resourceName(_resourceName)
     , _externalFileName(externalStyleFile.absoluteFilePath())
@@ -38,6 +44,7 @@ OsmAnd::RasterizationStyle::RasterizationStyle( RasterizationStyles* owner, cons
     , title(_title)
     , name(_name)
     , parentName(_parentName)
+    , valueDefinitionsCount(_valueDefinitionsCount)
 {
     _name = externalStyleFile.fileName().replace(".render.xml", "");
     registerBuiltinValueDefinitions();
@@ -125,6 +132,9 @@ bool OsmAnd::RasterizationStyle::resolveDependencies()
     // Obtain string ID base
     _stringsIdBase = _parent->_stringsIdBase + _parent->_stringsLUT.size();
 
+    // Own value definitions are numbered after ones of parent
+    _valueDefinitionsCount = _parent->_valueDefinitionsCount;
+
     return true;
 }
 
@@ -486,6 +496,7 @@ void OsmAnd::RasterizationStyle::registerBuiltinValue( const std::shared_ptr<Val
 std::shared_ptr<OsmAnd::RasterizationStyle::ValueDefinition> OsmAnd::RasterizationStyle::registerValue( ValueDefinition* pValueDefinition )
 {
     std::shared_ptr<ValueDefinition> valueDefinition(pValueDefinition);
+    pValueDefinition->_id = _valueDefinitionsCount++;
     _valuesDefinitions.insert(pValueDefinition->name, valueDefinition);
     return valueDefinition;
 }
@@ -729,10 +740,10 @@ const QString& OsmAnd::RasterizationStyle::lookupStringValue( uint32_t id ) cons
     return _stringsLUT[id - _stringsIdBase];
 }
 
-bool OsmAnd::RasterizationStyle::lookupStringId( const QString& value, uint32_t& id )
+bool OsmAnd::RasterizationStyle::lookupStringId( const QString& value, uint32_t& id ) const
 {
-    auto itId = _stringsRevLUT.find(value);
-    if(itId != _stringsRevLUT.end())
+    auto itId = _stringsRevLUT.constFind(value);
+    if(itId != _stringsRevLUT.cend())
     {
         id = *itId;
         return true;
@@ -753,6 +764,36 @@ uint32_t OsmAnd::RasterizationStyle::lookupStringId( const QString& value )
     return registerString(value);
 }
 
+std::shared_ptr< const QVector<OsmAnd::RasterizationStyle::TypeStringIds> > OsmAnd::RasterizationStyle::obtainTypesStringIds( uint32_t typeId )
+{
+    QMutexLocker scopeLock(&_typesStringIdsMutex);
+
+    if(_typesStringIds && typeId < static_cast<uint32_t>(_typesStringIds->size()))
+        return _typesStringIds;
+
+    // Published table may be in use, so it's never modified. Instead it's replaced with
+    // a copy that covers all types known to the dictionary at the moment.
+    const auto typesCount = qMax(typeId + 1, Model::TagValueDictionary::getIdsCount());
+    std::shared_ptr< QVector<TypeStringIds> > table(_typesStringIds
+        ? new QVector<TypeStringIds>(*_typesStringIds)
+        : new QVector<TypeStringIds>());
+    table->reserve(typesCount);
+    for(auto id = static_cast<uint32_t>(table->size()); id < typesCount; id++)
+    {
+        const auto& type = Model::TagValueDictionary::resolve(id);
+
+        TypeStringIds entry;
+        if(!lookupStringId(type.tag, entry.tagId))
+            entry.tagId = std::numeric_limits<uint32_t>::max();
+        if(!lookupStringId(type.value, entry.valueId))
+            entry.valueId = std::numeric_limits<uint32_t>::max();
+        table->push_back(entry);
+    }
+    _typesStringIds = table;
+
+    return _typesStringIds;
+}
+
 uint32_t OsmAnd::RasterizationStyle::registerString( const QString& value )
 {
     auto id = _stringsIdBase + _stringsLUT.size();
@@ -812,6 +853,59 @@ bool OsmAnd::RasterizationStyle::mergeInherited()
     return true;
 }
 
+std::shared_ptr<const OsmAnd::RasterizationRulesetProgram>& OsmAnd::RasterizationStyle::obtainProgram( RulesetType type )
+{
+    switch (type)
+    {
+    case OsmAnd::RasterizationStyle::Point:
+        return _pointProgram;
+    case OsmAnd::RasterizationStyle::Line:
+        return _lineProgram;
+    case OsmAnd::RasterizationStyle::Polygon:
+        return _polygonProgram;
+    case OsmAnd::RasterizationStyle::Text:
+        return _textProgram;
+    case OsmAnd::RasterizationStyle::Order:
+        return _orderProgram;
+    }
+
+    assert(type >= Point && type <= Order);
+    return *(std::shared_ptr<const RasterizationRulesetProgram>*)(nullptr);
+}
+
+const std::shared_ptr<const OsmAnd::RasterizationRulesetProgram>& OsmAnd::RasterizationStyle::obtainProgram( RulesetType type ) const
+{
+    switch (type)
+    {
+    case OsmAnd::RasterizationStyle::Point:
+        return _pointProgram;
+    case OsmAnd::RasterizationStyle::Line:
+        return _lineProgram;
+    case OsmAnd::RasterizationStyle::Polygon:
+        return _polygonProgram;
+    case OsmAnd::RasterizationStyle::Text:
+        return _textProgram;
+    case OsmAnd::RasterizationStyle::Order:
+        return _orderProgram;
+    }
+
+    assert(type >= Point && type <= Order);
+    return *(std::shared_ptr<const RasterizationRulesetProgram>*)(nullptr);
+}
+
+bool OsmAnd::RasterizationStyle::compileRulesets()
+{
+    const RulesetType types[] = { Point, Line, Polygon, Text, Order };
+    for(auto idx = 0u; idx < sizeof(types) / sizeof(types[0]); idx++)
+    {
+        const auto& type = types[idx];
+
+        obtainProgram(type) = RasterizationRulesetProgram::compile(obtainRules(type));
+    }
+
+    return true;
+}
+
 bool OsmAnd::RasterizationStyle::mergeInheritedRules( RulesetType type )
 {
     if(!_parent)
@@ -881,10 +975,12 @@ bool OsmAnd::RasterizationStyle::resolveAttribute( const QString& name, std::sha
     return false;
 }
 
-OsmAnd::RasterizationStyle::ValueDefinition::ValueDefinition( ValueDefinition::Type type_, ValueDefinition::DataType dataType_, const QString& name_ )
-    : type(type_)
+OsmAnd::RasterizationStyle::ValueDefinition::ValueDefinition( ValueDefinition::Type type_, ValueDefinition::DataType dataType_, const QString& name_, uint32_t id_ )
+    : _id(id_)
+    , type(type_)
     , dataType(dataType_)
     , name(name_)
+    , id(_id)
 {
 }
 
@@ -893,7 +989,7 @@ OsmAnd::RasterizationStyle::ValueDefinition::~ValueDefinition()
 }
 
 OsmAnd::RasterizationStyle::ConfigurableInputValue::ConfigurableInputValue( ValueDefinition::DataType type_, const QString& name_, const QString& title_, const QString& description_, const QStringList& possibleValues_ )
-    : ValueDefinition(Input, type_, name_)
+    : ValueDefinition(Input, type_, name_, std::numeric_limits<uint32_t>::max())
     , title(title_)
     , description(description_)
     , possibleValues(possibleValues_)
@@ -904,13 +1000,15 @@ OsmAnd::RasterizationStyle::ConfigurableInputValue::~ConfigurableInputValue()
 {
 }
 
+uint32_t OsmAnd::RasterizationStyle::_builtinValueDefinitionsCount = 0;
 const OsmAnd::RasterizationStyle::_builtinValueDefinitions OsmAnd::RasterizationStyle::builtinValueDefinitions;
 
 #define DECLARE_BUILTIN_VALUEDEF(varname, type, dataType, name) \
     varname(new OsmAnd::RasterizationStyle::ValueDefinition( \
         OsmAnd::RasterizationStyle::ValueDefinition::type, \
         OsmAnd::RasterizationStyle::ValueDefinition::dataType, \
-        name \
+        name, \
+        OsmAnd::RasterizationStyle::_builtinValueDefinitionsCount++ \
     ))
 
 OsmAnd::RasterizationStyle::_builtinValueDefinitions::_builtinValueDefinitions()
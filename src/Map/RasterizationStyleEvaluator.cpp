@@ -1,23 +1,33 @@
 #include "RasterizationStyleEvaluator.h"
 
 #include <cassert>
+#include <limits>
+
+#include <QSet>
 
 #include "RasterizationRule.h"
+#include "RasterizationRulesetProgram.h"
 #include "MapObject.h"
+#include "TagValueDictionary.h"
 #include "OsmAndCore/Logging.h"
 
 OsmAnd::RasterizationStyleEvaluator::RasterizationStyleEvaluator( const std::shared_ptr<RasterizationStyle>& style_, RasterizationStyle::RulesetType ruleset_, const std::shared_ptr<OsmAnd::Model::MapObject>& mapObject_ /*= std::shared_ptr<OsmAnd::Model::MapObject>()*/ )
-    : style(style_)
-    , mapObject(mapObject_)
+    : _mapObject(mapObject_)
+    , _values(style_->valueDefinitionsCount)
+    , _valuesSetMask(style_->valueDefinitionsCount)
+    , style(style_)
+    , mapObject(_mapObject)
     , ruleset(ruleset_)
 {
 }
 
 OsmAnd::RasterizationStyleEvaluator::RasterizationStyleEvaluator( const std::shared_ptr<RasterizationStyle>& style_, const std::shared_ptr<RasterizationRule>& singleRule_ )
-    : style(style_)
-    , singleRule(singleRule_)
-    , mapObject()
+    : _values(style_->valueDefinitionsCount)
+    , _valuesSetMask(style_->valueDefinitionsCount)
+    , style(style_)
+    , mapObject(_mapObject)
     , ruleset(RasterizationStyle::RulesetType::Invalid)
+    , singleRule(singleRule_)
 {
 }
 
@@ -25,89 +35,118 @@ OsmAnd::RasterizationStyleEvaluator::~RasterizationStyleEvaluator()
 {
 }
 
+const OsmAnd::RasterizationRule::Value& OsmAnd::RasterizationStyleEvaluator::readValue( uint32_t id ) const
+{
+    assert(id < static_cast<uint32_t>(_values.size()));
+
+    static const RasterizationRule::Value zero = { 0 };
+    if(!_valuesSetMask.testBit(id))
+        return zero;
+    return _values[id];
+}
+
+void OsmAnd::RasterizationStyleEvaluator::writeValue( uint32_t id, const OsmAnd::RasterizationRule::Value& value )
+{
+    assert(id < static_cast<uint32_t>(_values.size()));
+
+    _values[id] = value;
+    _valuesSetMask.setBit(id);
+}
+
 void OsmAnd::RasterizationStyleEvaluator::setValue( const std::shared_ptr<OsmAnd::RasterizationStyle::ValueDefinition>& ref, const OsmAnd::RasterizationRule::Value& value )
 {
-    _values[ref.get()] = value;
+    writeValue(ref->id, value);
 }
 
 void OsmAnd::RasterizationStyleEvaluator::setBooleanValue( const std::shared_ptr<OsmAnd::RasterizationStyle::ValueDefinition>& ref, const bool& value )
 {
-    _values[ref.get()].asInt = value ? 1 : 0;
+    RasterizationRule::Value data;
+    data.asInt = value ? 1 : 0;
+    writeValue(ref->id, data);
 }
 
 void OsmAnd::RasterizationStyleEvaluator::setIntegerValue( const std::shared_ptr<OsmAnd::RasterizationStyle::ValueDefinition>& ref, const int& value )
 {
-    _values[ref.get()].asInt = value;
+    RasterizationRule::Value data;
+    data.asInt = value;
+    writeValue(ref->id, data);
 }
 
 void OsmAnd::RasterizationStyleEvaluator::setIntegerValue( const std::shared_ptr<OsmAnd::RasterizationStyle::ValueDefinition>& ref, const unsigned int& value )
 {
-    _values[ref.get()].asUInt = value;
+    RasterizationRule::Value data;
+    data.asUInt = value;
+    writeValue(ref->id, data);
 }
 
 void OsmAnd::RasterizationStyleEvaluator::setFloatValue( const std::shared_ptr<OsmAnd::RasterizationStyle::ValueDefinition>& ref, const float& value )
 {
-    _values[ref.get()].asFloat = value;
+    RasterizationRule::Value data;
+    data.asFloat = value;
+    writeValue(ref->id, data);
 }
 
 void OsmAnd::RasterizationStyleEvaluator::setStringValue( const std::shared_ptr<OsmAnd::RasterizationStyle::ValueDefinition>& ref, const QString& value )
 {
-    bool ok = style->lookupStringId(value, _values[ref.get()].asUInt);
+    RasterizationRule::Value data;
+    bool ok = style->lookupStringId(value, data.asUInt);
     if(!ok)
-        _values[ref.get()].asUInt = std::numeric_limits<uint32_t>::max();
+        data.asUInt = std::numeric_limits<uint32_t>::max();
+    writeValue(ref->id, data);
 }
 
 bool OsmAnd::RasterizationStyleEvaluator::getBooleanValue( const std::shared_ptr<OsmAnd::RasterizationStyle::ValueDefinition>& ref, bool& value ) const
 {
-    const auto& itValue = _values.find(ref.get());
-    if(itValue == _values.end())
+    if(!_valuesSetMask.testBit(ref->id))
         return false;
-    value = (*itValue).asInt == 1;
+    value = _values[ref->id].asInt == 1;
     return true;
 }
 
 bool OsmAnd::RasterizationStyleEvaluator::getIntegerValue( const std::shared_ptr<OsmAnd::RasterizationStyle::ValueDefinition>& ref, int& value ) const
 {
-    const auto& itValue = _values.find(ref.get());
-    if(itValue == _values.end())
+    if(!_valuesSetMask.testBit(ref->id))
         return false;
-    value = (*itValue).asInt;
+    value = _values[ref->id].asInt;
     return true;
 }
 
 bool OsmAnd::RasterizationStyleEvaluator::getIntegerValue( const std::shared_ptr<OsmAnd::RasterizationStyle::ValueDefinition>& ref, unsigned int& value ) const
 {
-    const auto& itValue = _values.find(ref.get());
-    if(itValue == _values.end())
+    if(!_valuesSetMask.testBit(ref->id))
         return false;
-    value = (*itValue).asUInt;
+    value = _values[ref->id].asUInt;
     return true;
 }
 
 bool OsmAnd::RasterizationStyleEvaluator::getFloatValue( const std::shared_ptr<OsmAnd::RasterizationStyle::ValueDefinition>& ref, float& value ) const
 {
-    const auto& itValue = _values.find(ref.get());
-    if(itValue == _values.end())
+    if(!_valuesSetMask.testBit(ref->id))
         return false;
-    value = (*itValue).asFloat;
+    value = _values[ref->id].asFloat;
     return true;
 }
 
 bool OsmAnd::RasterizationStyleEvaluator::getStringValue( const std::shared_ptr<OsmAnd::RasterizationStyle::ValueDefinition>& ref, QString& value ) const
 {
-    const auto& itValue = _values.find(ref.get());
-    if(itValue == _values.end())
+    if(!_valuesSetMask.testBit(ref->id))
         return false;
-    value = style->lookupStringValue((*itValue).asUInt);
+    value = style->lookupStringValue(_values[ref->id].asUInt);
     return true;
 }
 
 void OsmAnd::RasterizationStyleEvaluator::clearValue( const std::shared_ptr<OsmAnd::RasterizationStyle::ValueDefinition>& ref )
 {
-    _values.remove(ref.get());
+    _valuesSetMask.clearBit(ref->id);
+}
+
+void OsmAnd::RasterizationStyleEvaluator::reset( const std::shared_ptr<OsmAnd::Model::MapObject>& mapObject_ /*= std::shared_ptr<OsmAnd::Model::MapObject>()*/ )
+{
+    _mapObject = mapObject_;
+    _valuesSetMask.fill(false);
 }
 
-bool OsmAnd::RasterizationStyleEvaluator::evaluate( bool fillOutput /*= true*/, bool evaluateChildren /*=true*/ )
+bool OsmAnd::RasterizationStyleEvaluator::evaluate( bool fillOutput /*= true*/, bool evaluateChildren /*= true*/, bool interpretRules /*= false*/ )
 {
     if(singleRule)
     {
@@ -119,18 +158,18 @@ bool OsmAnd::RasterizationStyleEvaluator::evaluate( bool fillOutput /*= true*/,
     }
     else
     {
-        auto tagKey = _values[RasterizationStyle::builtinValueDefinitions.INPUT_TAG.get()].asUInt;
-        auto valueKey = _values[RasterizationStyle::builtinValueDefinitions.INPUT_VALUE.get()].asUInt;
+        auto tagKey = readValue(RasterizationStyle::builtinValueDefinitions.INPUT_TAG->id).asUInt;
+        auto valueKey = readValue(RasterizationStyle::builtinValueDefinitions.INPUT_VALUE->id).asUInt;
 
-        auto evaluationResult = evaluate(tagKey, valueKey, fillOutput, evaluateChildren);
+        auto evaluationResult = evaluate(tagKey, valueKey, fillOutput, evaluateChildren, interpretRules);
         if(evaluationResult)
             return true;
 
-        evaluationResult = evaluate(tagKey, 0, fillOutput, evaluateChildren);
+        evaluationResult = evaluate(tagKey, 0, fillOutput, evaluateChildren, interpretRules);
         if(evaluationResult)
             return true;
 
-        evaluationResult = evaluate(0, 0, fillOutput, evaluateChildren);
+        evaluationResult = evaluate(0, 0, fillOutput, evaluateChildren, interpretRules);
         if(evaluationResult)
             return true;
 
@@ -138,13 +177,102 @@ bool OsmAnd::RasterizationStyleEvaluator::evaluate( bool fillOutput /*= true*/,
     }
 }
 
-bool OsmAnd::RasterizationStyleEvaluator::evaluate( uint32_t tagKey, uint32_t valueKey, bool fillOutput, bool evaluateChildren )
+bool OsmAnd::RasterizationStyleEvaluator::evaluate( ResultsCache& cache )
 {
-    _values[RasterizationStyle::builtinValueDefinitions.INPUT_TAG.get()].asUInt = tagKey;
-    _values[RasterizationStyle::builtinValueDefinitions.INPUT_VALUE.get()].asUInt = valueKey;
-    
-    const auto& rules = static_cast<const RasterizationStyle*>(style.get())->obtainRules(ruleset);
+    if(singleRule)
+        return evaluate();
+
+    const auto& signature = calculateSignature();
+    const auto pEntry = cache.entries.object(signature);
+    if(pEntry)
+    {
+        for(auto itValue = pEntry->writtenValues.cbegin(); itValue != pEntry->writtenValues.cend(); ++itValue)
+            writeValue(itValue->first, itValue->second);
+        return pEntry->result;
+    }
+
+    // Evaluation only writes values, so these are found by comparing with state before evaluation
+    const auto valuesBefore = _values;
+    const auto valuesSetMaskBefore = _valuesSetMask;
+
+    const auto entry = new ResultsCache::Entry();
+    entry->result = evaluate();
+    for(auto id = 0; id < _values.size(); id++)
+    {
+        if(!_valuesSetMask.testBit(id))
+            continue;
+        if(valuesSetMaskBefore.testBit(id) && valuesBefore[id].asUInt == _values[id].asUInt)
+            continue;
+
+        entry->writtenValues.push_back(qMakePair(static_cast<uint32_t>(id), _values[id]));
+    }
+    const auto result = entry->result;
+    cache.entries.insert(signature, entry, entry->writtenValues.size() + 1);
+
+    return result;
+}
+
+OsmAnd::RasterizationStyleEvaluator::ResultsCache::ResultsCache()
+    : entries(DefaultCapacity)
+{
+}
+
+QByteArray OsmAnd::RasterizationStyleEvaluator::calculateSignature() const
+{
+    QByteArray signature;
+    const auto append = [&signature](const uint32_t value)
+    {
+        signature.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    };
+
+    // Result depends only on values that are set, and on those additional types of map object
+    // that are checked by the ruleset
+    append(ruleset);
+    for(auto id = 0; id < _values.size(); id++)
+    {
+        if(!_valuesSetMask.testBit(id))
+            continue;
+
+        append(id);
+        append(_values[id].asUInt);
+    }
+    append(std::numeric_limits<uint32_t>::max());
+
+    if(mapObject)
+    {
+        const auto& program = static_cast<const RasterizationStyle*>(style.get())->obtainProgram(ruleset);
+        for(auto itType = mapObject->_extraTypes.begin(); itType != mapObject->_extraTypes.end(); ++itType)
+        {
+            const auto& typeId = *itType;
+
+            if(!program || program->_additionalTypeIds.contains(typeId))
+                append(typeId);
+        }
+    }
+
+    return signature;
+}
+
+bool OsmAnd::RasterizationStyleEvaluator::evaluate( uint32_t tagKey, uint32_t valueKey, bool fillOutput, bool evaluateChildren, bool interpretRules )
+{
+    RasterizationRule::Value data;
+    data.asUInt = tagKey;
+    writeValue(RasterizationStyle::builtinValueDefinitions.INPUT_TAG->id, data);
+    data.asUInt = valueKey;
+    writeValue(RasterizationStyle::builtinValueDefinitions.INPUT_VALUE->id, data);
+
     uint64_t ruleId = RasterizationStyle::encodeRuleId(tagKey, valueKey);
+
+    const auto& program = static_cast<const RasterizationStyle*>(style.get())->obtainProgram(ruleset);
+    if(program && !interpretRules)
+    {
+        auto itRoot = program->_roots.constFind(ruleId);
+        if(itRoot == program->_roots.cend())
+            return false;
+        return evaluate(*program, *itRoot, fillOutput, evaluateChildren);
+    }
+
+    const auto& rules = static_cast<const RasterizationStyle*>(style.get())->obtainRules(ruleset);
     auto itRule = rules.find(ruleId);
     if(itRule == rules.end())
         return false;
@@ -155,7 +283,7 @@ bool OsmAnd::RasterizationStyleEvaluator::evaluate( uint32_t tagKey, uint32_t va
 bool OsmAnd::RasterizationStyleEvaluator::evaluate( const std::shared_ptr<OsmAnd::RasterizationRule>& rule, bool fillOutput, bool evaluateChildren )
 {
     auto itValueDef = rule->_valueDefinitionsRefs.begin();
-    auto itValueData = rule->_values.begin();
+    auto itValueData = rule->_orderedValues.begin();
     for(; itValueDef != rule->_valueDefinitionsRefs.end(); ++itValueDef, ++itValueData)
     {
         const auto& valueDef = *itValueDef;
@@ -164,7 +292,7 @@ bool OsmAnd::RasterizationStyleEvaluator::evaluate( const std::shared_ptr<OsmAnd
             continue;
 
         const auto& valueData = *itValueData;
-        const auto& stackValue = _values[valueDef.get()];
+        const auto& stackValue = readValue(valueDef->id);
 
         bool evaluationResult = false;
         if(valueDef == RasterizationStyle::builtinValueDefinitions.INPUT_MINZOOM)
@@ -179,19 +307,8 @@ bool OsmAnd::RasterizationStyleEvaluator::evaluate( const std::shared_ptr<OsmAnd
         {
             if(!mapObject)
                 evaluationResult;
-            else
-            {
-                const auto& strValue = style->lookupStringValue(valueData.asUInt);
-                auto equalSignIdx = strValue.indexOf('=');
-                if(equalSignIdx >= 0)
-                {
-                    const auto& tag = strValue.mid(0, equalSignIdx);
-                    const auto& value = strValue.mid(equalSignIdx + 1);
-                    evaluationResult = mapObject->containsType(tag, value, true);
-                }
-                else
-                    evaluationResult = false;
-            }
+            else if(rule->_additionalTypeId != Model::TagValueDictionary::InvalidId)
+                evaluationResult = mapObject->containsType(rule->_additionalTypeId, true);
         }
         else if(valueDef->dataType == RasterizationStyle::ValueDefinition::Float)
         {
@@ -209,7 +326,7 @@ bool OsmAnd::RasterizationStyleEvaluator::evaluate( const std::shared_ptr<OsmAnd
     if (fillOutput || evaluateChildren)
     {
         auto itValueDef = rule->_valueDefinitionsRefs.begin();
-        auto itValueData = rule->_values.begin();
+        auto itValueData = rule->_orderedValues.begin();
         for(; itValueDef != rule->_valueDefinitionsRefs.end(); ++itValueDef, ++itValueData)
         {
             const auto& valueDef = *itValueDef;
@@ -218,7 +335,7 @@ bool OsmAnd::RasterizationStyleEvaluator::evaluate( const std::shared_ptr<OsmAnd
             if(valueDef->type != RasterizationStyle::ValueDefinition::Output)
                 continue;
 
-            _values[valueDef.get()] = valueData;
+            writeValue(valueDef->id, valueData);
         }
     }
 
@@ -240,35 +357,109 @@ bool OsmAnd::RasterizationStyleEvaluator::evaluate( const std::shared_ptr<OsmAnd
     return true;
 }
 
-void OsmAnd::RasterizationStyleEvaluator::dump( bool input /*= true*/, bool output /*= true*/, const QString& prefix /*= QString()*/ ) const
+bool OsmAnd::RasterizationStyleEvaluator::evaluate( const RasterizationRulesetProgram& program, uint32_t nodeIndex, bool fillOutput, bool evaluateChildren )
 {
-    for(auto itValue = _values.begin(); itValue != _values.end(); ++itValue)
+    const auto& node = program._nodes[nodeIndex];
+
+    const auto pConditions = program._conditions.constData();
+    for(auto idx = node.conditionsBegin; idx < node.conditionsEnd; idx++)
     {
-        auto pValueDef = itValue.key();
-        const auto& value = itValue.value();
+        const auto& condition = pConditions[idx];
+        const auto& stackValue = readValue(condition.valueDefinitionId);
+
+        bool evaluationResult = false;
+        switch(condition.type)
+        {
+        case RasterizationRulesetProgram::Equal:
+            evaluationResult = condition.value.asInt == stackValue.asInt;
+            break;
+        case RasterizationRulesetProgram::FuzzyEqual:
+            evaluationResult = qFuzzyCompare(condition.value.asFloat, stackValue.asFloat);
+            break;
+        case RasterizationRulesetProgram::LessOrEqual:
+            evaluationResult = condition.value.asInt <= stackValue.asInt;
+            break;
+        case RasterizationRulesetProgram::GreaterOrEqual:
+            evaluationResult = condition.value.asInt >= stackValue.asInt;
+            break;
+        case RasterizationRulesetProgram::ContainsAdditional:
+            evaluationResult = mapObject && mapObject->containsType(condition.value.asUInt, true);
+            break;
+        case RasterizationRulesetProgram::Never:
+            break;
+        }
 
-        if((pValueDef->type == RasterizationStyle::ValueDefinition::Input && input) || (pValueDef->type == RasterizationStyle::ValueDefinition::Output && output))
+        if(!evaluationResult)
+            return false;
+    }
+
+    if (fillOutput || evaluateChildren)
+    {
+        const auto pOutputs = program._outputs.constData();
+        for(auto idx = node.outputsBegin; idx < node.outputsEnd; idx++)
         {
-            auto strType = pValueDef->type == RasterizationStyle::ValueDefinition::Input ? ">" : "<";
-            OsmAnd::LogPrintf(LogSeverityLevel::Debug, "%s%s%s = ", prefix.toStdString().c_str(), strType, pValueDef->name.toStdString().c_str());
+            const auto& output = pOutputs[idx];
 
-            switch (pValueDef->dataType)
-            {
-            case RasterizationStyle::ValueDefinition::Boolean:
-                OsmAnd::LogPrintf(LogSeverityLevel::Debug, "%s", value.asUInt == 1 ? "true" : "false");
-                break;
-            case RasterizationStyle::ValueDefinition::Integer:
-                OsmAnd::LogPrintf(LogSeverityLevel::Debug, "%d", value.asInt);
-                break;
-            case RasterizationStyle::ValueDefinition::Float:
-                OsmAnd::LogPrintf(LogSeverityLevel::Debug, "%f", value.asFloat);
-                break;
-            case RasterizationStyle::ValueDefinition::String:
-                OsmAnd::LogPrintf(LogSeverityLevel::Debug, "%s", style->lookupStringValue(value.asUInt).toStdString().c_str());
-                break;
-            case RasterizationStyle::ValueDefinition::Color:
-                OsmAnd::LogPrintf(LogSeverityLevel::Debug, "#%s", QString::number(value.asUInt, 16).toStdString().c_str());
+            writeValue(output.valueDefinitionId, output.value);
+        }
+    }
+
+    if(evaluateChildren)
+    {
+        const auto pChildren = program._children.constData();
+        for(auto idx = node.ifElseChildrenBegin; idx < node.ifElseChildrenEnd; idx++)
+        {
+            auto evaluationResult = evaluate(program, pChildren[idx], fillOutput, true);
+            if(evaluationResult)
                 break;
+        }
+
+        for(auto idx = node.ifChildrenBegin; idx < node.ifChildrenEnd; idx++)
+        {
+            evaluate(program, pChildren[idx], fillOutput, true);
+        }
+    }
+
+    return true;
+}
+
+void OsmAnd::RasterizationStyleEvaluator::dump( bool input /*= true*/, bool output /*= true*/, const QString& prefix /*= QString()*/ ) const
+{
+    // Definitions are collected from style and all styles it inherits, builtin ones are present in each of them
+    QSet<uint32_t> processedIds;
+    for(auto pStyle = style.get(); pStyle; pStyle = pStyle->_parent.get())
+    {
+        for(auto itValueDef = pStyle->_valuesDefinitions.begin(); itValueDef != pStyle->_valuesDefinitions.end(); ++itValueDef)
+        {
+            auto pValueDef = itValueDef->get();
+            if(processedIds.contains(pValueDef->id) || !_valuesSetMask.testBit(pValueDef->id))
+                continue;
+            processedIds.insert(pValueDef->id);
+            const auto& value = _values[pValueDef->id];
+
+            if((pValueDef->type == RasterizationStyle::ValueDefinition::Input && input) || (pValueDef->type == RasterizationStyle::ValueDefinition::Output && output))
+            {
+                auto strType = pValueDef->type == RasterizationStyle::ValueDefinition::Input ? ">" : "<";
+                OsmAnd::LogPrintf(LogSeverityLevel::Debug, "%s%s%s = ", prefix.toStdString().c_str(), strType, pValueDef->name.toStdString().c_str());
+
+                switch (pValueDef->dataType)
+                {
+                case RasterizationStyle::ValueDefinition::Boolean:
+                    OsmAnd::LogPrintf(LogSeverityLevel::Debug, "%s", value.asUInt == 1 ? "true" : "false");
+                    break;
+                case RasterizationStyle::ValueDefinition::Integer:
+                    OsmAnd::LogPrintf(LogSeverityLevel::Debug, "%d", value.asInt);
+                    break;
+                case RasterizationStyle::ValueDefinition::Float:
+                    OsmAnd::LogPrintf(LogSeverityLevel::Debug, "%f", value.asFloat);
+                    break;
+                case RasterizationStyle::ValueDefinition::String:
+                    OsmAnd::LogPrintf(LogSeverityLevel::Debug, "%s", style->lookupStringValue(value.asUInt).toStdString().c_str());
+                    break;
+                case RasterizationStyle::ValueDefinition::Color:
+                    OsmAnd::LogPrintf(LogSeverityLevel::Debug, "#%s", QString::number(value.asUInt, 16).toStdString().c_str());
+                    break;
+                }
             }
         }
     }
@@ -63,6 +63,9 @@ bool OsmAnd::RasterizationStyles::obtainStyle( const QString& name, std::shared_
     if(!style->isStandalone())
         style->mergeInherited();
 
+    if(!style->compileRulesets())
+        return false;
+
     outStyle = style;
     return true;
 }
@@ -1,18 +1,29 @@
 #include "Rasterizer.h"
 
 #include <set>
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+#include <limits>
 
 #include <QtGlobal>
+#include <QHash>
+#include <qmath.h>
 
 #include "OsmAndCore/Logging.h"
 #include "OsmAndCore/Utilities.h"
 #include "RasterizationStyleEvaluator.h"
 #include "ObfMapSection.h"
+#include "TagValueDictionary.h"
 #include "RasterizerContext.h"
+#include "RasterizerGeometriesCache.h"
+#include "StyleBitmapsCache.h"
 
+#include <SkBitmapProcShader.h>
 #include <SkBlurDrawLooper.h>
 #include <SkColorFilter.h>
 #include <SkDashPathEffect.h>
+#include <SkPathMeasure.h>
 
 OsmAnd::Rasterizer::Rasterizer()
 {
@@ -71,7 +82,7 @@ void OsmAnd::Rasterizer::update(
             if(zoom < ZoomOnlyForBasemaps && !mapObject->section->isBaseMap)
                 continue;
 
-            if(mapObject->containsType("natural", "coastline"))
+            if(mapObject->containsType(Model::TagValueDictionary::NaturalCoastline))
             {
                 if (mapObject->section->isBaseMap)
                     context._basemapCoastlineObjects.push_back(mapObject);
@@ -96,6 +107,7 @@ void OsmAnd::Rasterizer::update(
     if(repolygonizeCoastlines)
     {
         context._triangulatedCoastlineObjects.clear();
+        const std::shared_ptr<Model::MapObjectsArena> coastlinesArena(new Model::MapObjectsArena());
 
         bool addBasemapCoastlines = true;
         
@@ -103,7 +115,7 @@ void OsmAnd::Rasterizer::update(
         const bool detailedLandData = zoom >= DetailedLandDataZoom && !context._mapObjects.isEmpty();
         if(!context._coastlineObjects.empty())
         {
-            const bool coastlinesWereAdded = polygonizeCoastlines(context,
+            const bool coastlinesWereAdded = polygonizeCoastlines(context, coastlinesArena,
                 context._coastlineObjects,
                 context._triangulatedCoastlineObjects,
                 !context._basemapCoastlineObjects.isEmpty(),
@@ -116,7 +128,7 @@ void OsmAnd::Rasterizer::update(
         }
         if (addBasemapCoastlines)
         {
-            const bool coastlinesWereAdded = polygonizeCoastlines(context,
+            const bool coastlinesWereAdded = polygonizeCoastlines(context, coastlinesArena,
                 context._basemapCoastlineObjects,
                 context._triangulatedCoastlineObjects,
                 false,
@@ -126,16 +138,15 @@ void OsmAnd::Rasterizer::update(
 
         if (addBasemapCoastlines)
         {
-            std::shared_ptr<Model::MapObject> bgMapObject(new Model::MapObject(nullptr));
-            bgMapObject->_points31.push_back(PointI(area31.left, area31.top));
-            bgMapObject->_points31.push_back(PointI(area31.right, area31.top));
-            bgMapObject->_points31.push_back(PointI(area31.right, area31.bottom));
-            bgMapObject->_points31.push_back(PointI(area31.left, area31.bottom));
-            bgMapObject->_points31.push_back(bgMapObject->_points31.first());
-            if (context._hasWater && !context._hasLand)
-                bgMapObject->_types.push_back(TagValue("natural", "coastline"));
-            else
-                bgMapObject->_types.push_back(TagValue("natural", "land"));
+            QVector< PointI > points31;
+            points31.reserve(5);
+            points31.push_back(PointI(area31.left, area31.top));
+            points31.push_back(PointI(area31.right, area31.top));
+            points31.push_back(PointI(area31.right, area31.bottom));
+            points31.push_back(PointI(area31.left, area31.bottom));
+            points31.push_back(points31.first());
+            const auto bgMapObject = createCoastlineObject(coastlinesArena, points31,
+                (context._hasWater && !context._hasLand) ? Model::TagValueDictionary::NaturalCoastline : Model::TagValueDictionary::NaturalLand);
 
             context._triangulatedCoastlineObjects.push_back(bgMapObject);
         }
@@ -215,14 +226,51 @@ bool OsmAnd::Rasterizer::rasterizeMap(
 
     rasterizeMapPrimitives(context, canvas, context._lines, Lines, controller);
 
+    rasterizeMapIcons(context, canvas, controller);
+
     return true;
 }
 
+void OsmAnd::Rasterizer::rasterizeMapIcons( RasterizerContext& context, SkCanvas& canvas, IQueryController* controller )
+{
+    for(auto itPrimitive = context._points.cbegin(); itPrimitive != context._points.cend(); ++itPrimitive)
+    {
+        if(controller && controller->isAborted())
+            return;
+
+        const auto& primitive = *itPrimitive;
+        const auto& typeId = primitive.mapObject->_types[primitive.typeIndex];
+
+        RasterizationStyleEvaluator evaluator(context.style, RasterizationStyle::RulesetType::Point, primitive.mapObject);
+        context.applyTo(evaluator);
+        context.applyTypeTo(evaluator, typeId);
+        evaluator.setIntegerValue(RasterizationStyle::builtinValueDefinitions.INPUT_MINZOOM, context._zoom);
+        evaluator.setIntegerValue(RasterizationStyle::builtinValueDefinitions.INPUT_MAXZOOM, context._zoom);
+        if(!evaluator.evaluate(context._evaluationResultsCache))
+            continue;
+
+        QString iconName;
+        if(!evaluator.getStringValue(RasterizationStyle::builtinValueDefinitions.OUTPUT_ICON, iconName) || iconName.isEmpty())
+            continue;
+        const auto icon = StyleBitmapsCache::obtain(StyleBitmapsCache::Kind::Icon, iconName, context._densityFactor);
+        if(!icon)
+            continue;
+
+        PointF center;
+        if(!obtainPointCenter(context, primitive, center))
+            continue;
+
+        // Icons are already scaled to density, so they are drawn 1:1 centered at the point
+        canvas.drawBitmap(*icon, center.x - icon->width() / 2.0f, center.y - icon->height() / 2.0f);
+    }
+}
+
 void OsmAnd::Rasterizer::obtainPrimitives(RasterizerContext& context, IQueryController* controller)
 {
     auto area31toPixelDivisor = context._precomputed31toPixelDivisor * context._precomputed31toPixelDivisor;
     
     QVector< Primitive > unfilteredLines;
+    RasterizationStyleEvaluator evaluator(context.style, RasterizationStyle::RulesetType::Order);
     for(auto itMapObject = context._combinedMapObjects.begin(); itMapObject != context._combinedMapObjects.end(); ++itMapObject)
     {
         if(controller && controller->isAborted())
@@ -233,20 +281,19 @@ void OsmAnd::Rasterizer::obtainPrimitives(RasterizerContext& context, IQueryCont
         uint32_t typeIdx = 0;
         for(auto itType = mapObject->_types.begin(); itType != mapObject->_types.end(); ++itType, typeIdx++)
         {
-            const auto& type = *itType;
+            const auto& typeId = *itType;
             auto layer = mapObject->getSimpleLayerValue();
 
-            RasterizationStyleEvaluator evaluator(context.style, RasterizationStyle::RulesetType::Order, mapObject);
+            evaluator.reset(mapObject);
             context.applyTo(evaluator);
-            evaluator.setStringValue(RasterizationStyle::builtinValueDefinitions.INPUT_TAG, type.tag);
-            evaluator.setStringValue(RasterizationStyle::builtinValueDefinitions.INPUT_VALUE, type.value);
+            context.applyTypeTo(evaluator, typeId);
             evaluator.setIntegerValue(RasterizationStyle::builtinValueDefinitions.INPUT_MINZOOM, context._zoom);
             evaluator.setIntegerValue(RasterizationStyle::builtinValueDefinitions.INPUT_MAXZOOM, context._zoom);
             evaluator.setIntegerValue(RasterizationStyle::builtinValueDefinitions.INPUT_LAYER, layer);
             evaluator.setBooleanValue(RasterizationStyle::builtinValueDefinitions.INPUT_AREA, mapObject->_isArea);
             evaluator.setBooleanValue(RasterizationStyle::builtinValueDefinitions.INPUT_POINT, mapObject->_points31.size() == 1);
             evaluator.setBooleanValue(RasterizationStyle::builtinValueDefinitions.INPUT_CYCLE, mapObject->isClosedFigure());
-            if(evaluator.evaluate())
+            if(evaluator.evaluate(context._evaluationResultsCache))
             {
                 int objectType;
                 if(!evaluator.getIntegerValue(RasterizationStyle::builtinValueDefinitions.OUTPUT_OBJECT_TYPE, objectType))
@@ -281,7 +328,7 @@ void OsmAnd::Rasterizer::obtainPrimitives(RasterizerContext& context, IQueryCont
 
                     Primitive pointPrimitive = primitive;
                     pointPrimitive.objectType = PrimitiveType::Point;
-                    auto polygonArea31 = Utilities::polygonArea(mapObject->_points31);
+                    auto polygonArea31 = Utilities::polygonArea(mapObject->_points31.constData(), mapObject->_points31.size());
                     primitive.zOrder = polygonArea31 / area31toPixelDivisor;
                     if(primitive.zOrder > PolygonAreaCutoffLowerThreshold * context._densityFactor)
                     {
@@ -313,35 +360,162 @@ void OsmAnd::Rasterizer::obtainPrimitives(RasterizerContext& context, IQueryCont
         }
     }
 
-    qSort(context._polygons.begin(), context._polygons.end(), [](const Primitive& l, const Primitive& r) -> bool
-    {
-        if( qFuzzyCompare(l.zOrder, r.zOrder) )
-            return l.typeIndex < r.typeIndex;
-        return l.zOrder > r.zOrder;
-    });
-    qSort(unfilteredLines.begin(), unfilteredLines.end(), [](const Primitive& l, const Primitive& r) -> bool
-    {
-        if(qFuzzyCompare(l.zOrder, r.zOrder))
+    sortPrimitives(context, context._polygons, true);
+    sortPrimitives(context, unfilteredLines, false);
+    filterOutLinesByDensity(context, unfilteredLines, context._lines, controller);
+    sortPrimitives(context, context._points, false);
+}
+
+void OsmAnd::Rasterizer::sortPrimitives( RasterizerContext& context, QVector< Primitive >& primitives, bool byDescendingArea )
+{
+    const auto count = primitives.size();
+    if(count < 2)
+        return;
+
+    // Polygons are ordered by descending area and then by type index. Other primitives are ordered
+    // by ascending z-order, type index and points count. Z-order is biased to fit 24 bits, and
+    // non-negative area is ordered same as bits of its float representation.
+    auto& entries = context._primitivesSortEntries;
+    auto& buffer = context._primitivesSortBuffer;
+    entries.resize(count);
+    buffer.resize(count);
+    uint32_t histograms[8][256] = { { 0 } };
+    for(auto idx = 0; idx < count; idx++)
+    {
+        auto& primitive = primitives[idx];
+
+        const uint64_t typeIndex = qMin(primitive.typeIndex, 0xFFu);
+        uint64_t key;
+        if(byDescendingArea)
         {
-            if(l.typeIndex == r.typeIndex)
-                return l.mapObject->_points31.size() < r.mapObject->_points31.size();
-            return l.typeIndex < r.typeIndex;
+            const auto area = static_cast<float>(qMax(primitive.zOrder, 0.0));
+            uint32_t areaBits;
+            memcpy(&areaBits, &area, sizeof(areaBits));
+            key = (static_cast<uint64_t>(~areaBits) << 32) | (typeIndex << 24);
         }
-        return l.zOrder < r.zOrder;
-    });
-    filterOutLinesByDensity(context, unfilteredLines, context._lines, controller);
-    qSort(context._points.begin(), context._points.end(), [](const Primitive& l, const Primitive& r) -> bool
+        else
+        {
+            const auto zOrder = qBound(-(1 << 23), static_cast<int>(primitive.zOrder), (1 << 23) - 1) + (1 << 23);
+            const uint64_t pointsCount = static_cast<uint32_t>(primitive.mapObject->_points31.size());
+            key = (static_cast<uint64_t>(zOrder) << 40) | (typeIndex << 32) | pointsCount;
+        }
+        primitive.sortKey = key;
+
+        entries[idx].key = key;
+        entries[idx].index = idx;
+        for(auto digit = 0; digit < 8; digit++)
+            histograms[digit][(key >> (digit * 8)) & 0xFF]++;
+    }
+
+    // Stable LSD radix sort, 8 bits per pass. Passes where all keys have same digit are skipped.
+    auto pSrc = entries.data();
+    auto pDst = buffer.data();
+    for(auto digit = 0; digit < 8; digit++)
     {
-        if(qFuzzyCompare(l.zOrder, r.zOrder))
+        auto& histogram = histograms[digit];
+        const auto shift = digit * 8;
+        if(histogram[(pSrc[0].key >> shift) & 0xFF] == static_cast<uint32_t>(count))
+            continue;
+
+        uint32_t offset = 0;
+        for(auto bucket = 0; bucket < 256; bucket++)
         {
-            if(l.typeIndex == r.typeIndex)
-                return l.mapObject->_points31.size() < r.mapObject->_points31.size();
-            return l.typeIndex < r.typeIndex;
+            const auto bucketSize = histogram[bucket];
+            histogram[bucket] = offset;
+            offset += bucketSize;
         }
-        return l.zOrder < r.zOrder;
-    });
+        for(auto idx = 0; idx < count; idx++)
+            pDst[histogram[(pSrc[idx].key >> shift) & 0xFF]++] = pSrc[idx];
+        std::swap(pSrc, pDst);
+    }
+
+    QVector< Primitive > sorted;
+    sorted.reserve(count);
+    for(auto idx = 0; idx < count; idx++)
+        sorted.push_back(primitives[pSrc[idx].index]);
+    primitives.swap(sorted);
 }
 
+namespace OsmAnd {
+
+    // Counters of lines per density cell, in open-addressing table with linear probing
+    class DensityCellsCounters
+    {
+    public:
+        DensityCellsCounters(uint32_t expectedCellsCount)
+            : _count(0)
+        {
+            auto capacity = 64u;
+            while(capacity < expectedCellsCount * 2)
+                capacity <<= 1;
+            allocate(capacity);
+        }
+
+        uint32_t& obtain(uint64_t cellId)
+        {
+            if((_count + 1) * 2 > static_cast<uint32_t>(_keys.size()))
+                grow();
+
+            auto idx = slotOf(cellId);
+            while(_keys[idx] != cellId)
+            {
+                if(_keys[idx] == EmptyKey)
+                {
+                    _keys[idx] = cellId;
+                    _count++;
+                    break;
+                }
+                idx = (idx + 1) & _mask;
+            }
+            return _counters[idx];
+        }
+
+        enum : uint64_t {
+            EmptyKey = 0xFFFFFFFFFFFFFFFFull,
+        };
+    private:
+        QVector<uint64_t> _keys;
+        QVector<uint32_t> _counters;
+        uint32_t _mask;
+        uint32_t _shift;
+        uint32_t _count;
+
+        void allocate(uint32_t capacity)
+        {
+            _keys.fill(EmptyKey, capacity);
+            _counters.fill(0, capacity);
+            _mask = capacity - 1;
+            _shift = 64;
+            for(auto c = capacity; c > 1; c >>= 1)
+                _shift--;
+        }
+
+        uint32_t slotOf(uint64_t cellId) const
+        {
+            return static_cast<uint32_t>((cellId * 0x9E3779B97F4A7C15ull) >> _shift);
+        }
+
+        void grow()
+        {
+            const auto oldKeys = _keys;
+            const auto oldCounters = _counters;
+            allocate(static_cast<uint32_t>(oldKeys.size()) * 2);
+            for(auto idx = 0; idx < oldKeys.size(); idx++)
+            {
+                if(oldKeys[idx] == EmptyKey)
+                    continue;
+
+                auto newIdx = slotOf(oldKeys[idx]);
+                while(_keys[newIdx] != EmptyKey)
+                    newIdx = (newIdx + 1) & _mask;
+                _keys[newIdx] = oldKeys[idx];
+                _counters[newIdx] = oldCounters[idx];
+            }
+        }
+    };
+
+} // namespace OsmAnd
+
 void OsmAnd::Rasterizer::filterOutLinesByDensity( RasterizerContext& context, const QVector< Primitive >& in, QVector< Primitive >& out, IQueryController* controller )
 {
     if(context._roadDensityZoomTile == 0 || context._roadsDensityLimitPerTile == 0)
@@ -350,10 +524,14 @@ void OsmAnd::Rasterizer::filterOutLinesByDensity( RasterizerContext& context, co
         return;
     }
 
-    const auto dZ = context._zoom + context._roadDensityZoomTile;
-    QMap< uint64_t, std::pair<uint32_t, double> > densityMap;
+    const auto dZ = qMin(context._zoom + context._roadDensityZoomTile, 31u);
+    DensityCellsCounters densityCells(in.size());
+
+    // Lines are processed from last to first, so that ones with higher z-order take the cells first.
+    // Accepted lines are appended in that order, and reversed once all lines were processed.
+    out.clear();
     out.reserve(in.size());
-    for(int lineIdx = in.size() - 1; lineIdx >= 0; lineIdx--)
+    for(auto lineIdx = in.size() - 1; lineIdx >= 0; lineIdx--)
     {
         if(controller && controller->isAborted())
             return;
@@ -361,40 +539,37 @@ void OsmAnd::Rasterizer::filterOutLinesByDensity( RasterizerContext& context, co
         bool accept = true;
         const auto& primitive = in[lineIdx];
 
-        const auto& type = primitive.mapObject->_types[primitive.typeIndex];
-        if (type.tag == "highway")
+        const auto& typeId = primitive.mapObject->_types[primitive.typeIndex];
+        if (Model::TagValueDictionary::resolveTagId(typeId) == Model::TagValueDictionary::HighwayTag)
         {
             accept = false;
 
-            uint64_t prevId = 0;
+            uint64_t prevId = DensityCellsCounters::EmptyKey;
             for(auto itPoint = primitive.mapObject->_points31.begin(); itPoint != primitive.mapObject->_points31.end(); ++itPoint)
             {
-                if(controller && controller->isAborted())
-                    return;
-
                 const auto& point = *itPoint;
 
-                auto x = point.x >> (31 - dZ);
-                auto y = point.y >> (31 - dZ);
-                uint64_t id = (static_cast<uint64_t>(x) << dZ) | y;
+                const auto x = static_cast<uint32_t>(point.x) >> (31 - dZ);
+                const auto y = static_cast<uint32_t>(point.y) >> (31 - dZ);
+                const uint64_t id = (static_cast<uint64_t>(x) << dZ) | y;
                 if(prevId != id)
                 {
                     prevId = id;
 
-                    auto& mapEntry = densityMap[id];
-                    if (mapEntry.first < context._roadsDensityLimitPerTile /*&& p.second > o */)
+                    auto& linesCount = densityCells.obtain(id);
+                    if (linesCount < context._roadsDensityLimitPerTile)
                     {
                         accept = true;
-                        mapEntry.first += 1;
-                        mapEntry.second = primitive.zOrder;
+                        linesCount++;
                     }
                 }
             }
         }
 
         if(accept)
-            out.push_front(primitive);
+            out.push_back(primitive);
     }
+    std::reverse(out.begin(), out.end());
 }
 
 void OsmAnd::Rasterizer::rasterizeMapPrimitives( RasterizerContext& context, SkCanvas& canvas, const QVector< Primitive >& primitives, PrimitivesType type, IQueryController* controller )
@@ -524,11 +699,19 @@ bool OsmAnd::Rasterizer::updatePaint( RasterizerContext& context, const Rasteriz
         ok = evaluator.getStringValue(RasterizationStyle::builtinValueDefinitions.OUTPUT_SHADER, shader);
         if(ok && !shader.isEmpty())
         {
-            assert(false);
-            int i = 5;
-            /*TODO:SkBitmap* bmp = getCachedBitmap(rc, shader);
-            if (bmp != NULL)
-            paint->setShader(new SkBitmapProcShader(*bmp, SkShader::kRepeat_TileMode, SkShader::kRepeat_TileMode))->unref();*/
+            const auto shaderBitmap = StyleBitmapsCache::obtain(StyleBitmapsCache::Kind::Shader, shader, context._densityFactor);
+            if(shaderBitmap)
+            {
+                // Pattern is aligned to map pixels rather than to the tile, so that it's continuous across tiles
+                context._mapPaintShaderMatrix.setTranslate(
+                    context._renderViewport.left - static_cast<float>(std::fmod(context._area31.left / context._precomputed31toPixelDivisor, static_cast<double>(shaderBitmap->width()))),
+                    context._renderViewport.top - static_cast<float>(std::fmod(context._area31.top / context._precomputed31toPixelDivisor, static_cast<double>(shaderBitmap->height()))));
+                SkMatrix localMatrix(context._mapPaintShaderMatrix);
+                localMatrix.postTranslate(-context._mapPaintOffset.x, -context._mapPaintOffset.y);
+                const auto bitmapShader = new SkBitmapProcShader(*shaderBitmap, SkShader::kRepeat_TileMode, SkShader::kRepeat_TileMode);
+                bitmapShader->setLocalMatrix(localMatrix);
+                context._mapPaint.setShader(bitmapShader)->unref();
+            }
         }
     }
 
@@ -569,100 +752,33 @@ void OsmAnd::Rasterizer::rasterizePolygon( RasterizerContext& context, SkCanvas&
         return;
     }
 
-    const auto& type = primitive.mapObject->_types[primitive.typeIndex];
+    const auto& typeId = primitive.mapObject->_types[primitive.typeIndex];
 
     RasterizationStyleEvaluator evaluator(context.style, RasterizationStyle::RulesetType::Polygon, primitive.mapObject);
     context.applyTo(evaluator);
-    evaluator.setStringValue(RasterizationStyle::builtinValueDefinitions.INPUT_TAG, type.tag);
-    evaluator.setStringValue(RasterizationStyle::builtinValueDefinitions.INPUT_VALUE, type.value);
+    context.applyTypeTo(evaluator, typeId);
     evaluator.setIntegerValue(RasterizationStyle::builtinValueDefinitions.INPUT_MINZOOM, context._zoom);
     evaluator.setIntegerValue(RasterizationStyle::builtinValueDefinitions.INPUT_MAXZOOM, context._zoom);
-    if(!evaluator.evaluate())
+    if(!evaluator.evaluate(context._evaluationResultsCache))
         return;
     if(!updatePaint(context, evaluator, Set_0, true))
         return;
 
-    SkPath path;
-    bool containsPoint = false;
-    int pointIdx = 0;
-    PointF vertex;
-    int bounds = 0;
-    QVector< PointF > outsideBounds;
-    for(auto itPoint = primitive.mapObject->_points31.begin(); itPoint != primitive.mapObject->_points31.end(); ++itPoint, pointIdx++)
-    {
-        const auto& point = *itPoint;
-
-        calculateVertex(context, point, vertex);
-
-        if(pointIdx == 0)
-        {
-            path.moveTo(vertex.x, vertex.y);
-        }
-        else
-        {
-            path.lineTo(vertex.x, vertex.y);
-        }
-
-        if (!containsPoint)
-        {
-            if(context._renderViewport.contains(vertex))
-            {
-                containsPoint = true;
-            }
-            else
-            {
-                outsideBounds.push_back(vertex);
-            }
-            bounds |= (vertex.x < context._renderViewport.left ? 1 : 0);
-            bounds |= (vertex.x > context._renderViewport.right ? 2 : 0);
-            bounds |= (vertex.y < context._renderViewport.top ? 4 : 0);
-            bounds |= (vertex.y > context._renderViewport.bottom ? 8 : 0);
-        }
-    }
-
-    if(!containsPoint)
-    {
-        // fast check for polygons
-        if((bounds & 3) != 3 || (bounds >> 2) != 3)
-            return;
-
-        bool ok = true;
-        ok = ok || contains(outsideBounds, context._renderViewport.topLeft);
-        ok = ok || contains(outsideBounds, context._renderViewport.bottomRight);
-        ok = ok || contains(outsideBounds, PointF(0, context._renderViewport.bottom));
-        ok = ok || contains(outsideBounds, PointF(context._renderViewport.right, 0));
-        if(!ok)
-            return;
-    }
+    // Artificial edges created by clipping must stay out of sight, as well as anything that is culled
+    const auto paintMargin = obtainPaintMargin(context, evaluator);
+    const auto& geometry = isClippingAllowed(evaluator)
+        ? obtainGeometry(context, primitive.mapObject, true, paintMargin)
+        : obtainGeometry(context, primitive.mapObject);
 
-    if(!primitive.mapObject->_innerPolygonsPoints31.isEmpty())
+    canvas.save();
+    if(translateToGeometry(context, canvas, *geometry, geometry->polygonPath, paintMargin))
     {
-        path.setFillType(SkPath::kEvenOdd_FillType);
-        for(auto itPolygon = primitive.mapObject->_innerPolygonsPoints31.begin(); itPolygon != primitive.mapObject->_innerPolygonsPoints31.end(); ++itPolygon)
-        {
-            const auto& polygon = *itPolygon;
-
-            pointIdx = 0;
-            for(auto itVertex = polygon.begin(); itVertex != polygon.end(); ++itVertex, pointIdx++)
-            {
-                const auto& point = *itVertex;
-                calculateVertex(context, point, vertex);
-
-                if(pointIdx == 0)
-                {
-                    path.moveTo(vertex.x, vertex.y);
-                }
-                else
-                {
-                    path.lineTo(vertex.x, vertex.y);
-                }
-            }
-        }
+        canvas.drawPath(geometry->polygonPath, context._mapPaint);
+        if(updatePaint(context, evaluator, Set_1, false))
+            canvas.drawPath(geometry->polygonPath, context._mapPaint);
     }
-
-    canvas.drawPath(path, context._mapPaint);
-    if(updatePaint(context, evaluator, Set_1, false))
-        canvas.drawPath(path, context._mapPaint);
+    canvas.restore();
+    context._mapPaintOffset = PointF();
 }
 
 void OsmAnd::Rasterizer::rasterizeLine( RasterizerContext& context, SkCanvas& canvas, const Primitive& primitive, bool drawOnlyShadow )
@@ -674,16 +790,15 @@ void OsmAnd::Rasterizer::rasterizeLine( RasterizerContext& context, SkCanvas& ca
     }
 
     bool ok;
-    const auto& type = primitive.mapObject->_types[primitive.typeIndex];
+    const auto& typeId = primitive.mapObject->_types[primitive.typeIndex];
 
     RasterizationStyleEvaluator evaluator(context.style, RasterizationStyle::RulesetType::Line, primitive.mapObject);
     context.applyTo(evaluator);
-    evaluator.setStringValue(RasterizationStyle::builtinValueDefinitions.INPUT_TAG, type.tag);
-    evaluator.setStringValue(RasterizationStyle::builtinValueDefinitions.INPUT_VALUE, type.value);
+    context.applyTypeTo(evaluator, typeId);
     evaluator.setIntegerValue(RasterizationStyle::builtinValueDefinitions.INPUT_MINZOOM, context._zoom);
     evaluator.setIntegerValue(RasterizationStyle::builtinValueDefinitions.INPUT_MAXZOOM, context._zoom);
     evaluator.setIntegerValue(RasterizationStyle::builtinValueDefinitions.INPUT_LAYER, primitive.mapObject->getSimpleLayerValue());
-    if(!evaluator.evaluate())
+    if(!evaluator.evaluate(context._evaluationResultsCache))
         return;
     if(!updatePaint(context, evaluator, Set_0, false))
         return;
@@ -699,101 +814,63 @@ void OsmAnd::Rasterizer::rasterizeLine( RasterizerContext& context, SkCanvas& ca
         return;
     
     int oneway = 0;
-    if (context._zoom >= 16 && type.tag == "highway")
+    if (context._zoom >= 16 && Model::TagValueDictionary::resolveTagId(typeId) == Model::TagValueDictionary::HighwayTag)
     {
-        if (primitive.mapObject->containsType("oneway", "yes", true))
+        if (primitive.mapObject->containsType(Model::TagValueDictionary::OnewayYes, true))
             oneway = 1;
-        else if (primitive.mapObject->containsType("oneway", "-1", true))
+        else if (primitive.mapObject->containsType(Model::TagValueDictionary::OnewayReverse, true))
             oneway = -1;
     }
 
-    SkPath path;
-    int pointIdx = 0;
-    const auto middleIdx = primitive.mapObject->_points31.size() >> 1;
-    bool intersect = false;
-    int prevCross = 0;
-    PointF vertex, middleVertex;
-    for(auto itPoint = primitive.mapObject->_points31.begin(); itPoint != primitive.mapObject->_points31.end(); ++itPoint, pointIdx++)
-    {
-        const auto& point = *itPoint;
+    // One-way arrows are dashes too, so lines that have them are never clipped
+    const auto paintMargin = obtainPaintMargin(context, evaluator);
+    const auto& geometry = (!oneway && isClippingAllowed(evaluator))
+        ? obtainGeometry(context, primitive.mapObject, false, paintMargin)
+        : obtainGeometry(context, primitive.mapObject);
+    const auto& path = geometry->linePath;
 
-        calculateVertex(context, point, vertex);
+    canvas.save();
+    if(!translateToGeometry(context, canvas, *geometry, path, paintMargin))
+    {
+        canvas.restore();
+        context._mapPaintOffset = PointF();
+        return;
+    }
 
-        if(pointIdx == 0)
+    if (drawOnlyShadow)
+    {
+        rasterizeLineShadow(context, canvas, path, shadowColor, shadowRadius);
+    }
+    else
+    {
+        if (updatePaint(context, evaluator, Set_minus2, false))
         {
-            path.moveTo(vertex.x, vertex.y);
+            canvas.drawPath(path, context._mapPaint);
         }
-        else
+        if (updatePaint(context, evaluator, Set_minus1, false))
         {
-            if(pointIdx == middleIdx)
-                middleVertex = vertex;
-
-            path.lineTo(vertex.x, vertex.y);
+            canvas.drawPath(path, context._mapPaint);
         }
-
-        if (!intersect)
+        if (updatePaint(context, evaluator, Set_0, false))
         {
-            if(context._renderViewport.contains(vertex))
-            {
-                intersect = true;
-            }
-            else
-            {
-                int cross = 0;
-                cross |= (vertex.x < context._renderViewport.left ? 1 : 0);
-                cross |= (vertex.x > context._renderViewport.right ? 2 : 0);
-                cross |= (vertex.y < context._renderViewport.top ? 4 : 0);
-                cross |= (vertex.y > context._renderViewport.bottom ? 8 : 0);
-                if(pointIdx > 0)
-                {
-                    if((prevCross & cross) == 0)
-                    {
-                        intersect = true;
-                    }
-                }
-                prevCross = cross;
-            }
+            canvas.drawPath(path, context._mapPaint);
         }
-    }
-
-    if (!intersect)
-        return;
-
-    if (pointIdx > 0)
-    {
-        if (drawOnlyShadow)
+        canvas.drawPath(path, context._mapPaint);
+        if (updatePaint(context, evaluator, Set_1, false))
         {
-            rasterizeLineShadow(context, canvas, path, shadowColor, shadowRadius);
+            canvas.drawPath(path, context._mapPaint);
         }
-        else
+        if (updatePaint(context, evaluator, Set_3, false))
         {
-            if (updatePaint(context, evaluator, Set_minus2, false))
-            {
-                canvas.drawPath(path, context._mapPaint);
-            }
-            if (updatePaint(context, evaluator, Set_minus1, false))
-            {
-                canvas.drawPath(path, context._mapPaint);
-            }
-            if (updatePaint(context, evaluator, Set_0, false))
-            {
-                canvas.drawPath(path, context._mapPaint);
-            }
             canvas.drawPath(path, context._mapPaint);
-            if (updatePaint(context, evaluator, Set_1, false))
-            {
-                canvas.drawPath(path, context._mapPaint);
-            }
-            if (updatePaint(context, evaluator, Set_3, false))
-            {
-                canvas.drawPath(path, context._mapPaint);
-            }
-            if (oneway && !drawOnlyShadow)
-            {
-                rasterizeLine_OneWay(context, canvas, path, oneway);
-            }
+        }
+        if (oneway && !drawOnlyShadow)
+        {
+            rasterizeLine_OneWay(context, canvas, path, oneway);
         }
     }
+    canvas.restore();
+    context._mapPaintOffset = PointF();
 }
 
 void OsmAnd::Rasterizer::rasterizeLineShadow( RasterizerContext& context, SkCanvas& canvas, const SkPath& path, uint32_t shadowColor, int shadowRadius )
@@ -837,6 +914,223 @@ void OsmAnd::Rasterizer::rasterizeLine_OneWay( RasterizerContext& context, SkCan
     }
 }
 
+namespace OsmAnd {
+
+    static void appendToPath(SkPath& path, const PointI* pPoints31, const int pointsCount, const RasterizerCachedGeometry& geometry, QVector< PointI >& simplifiedPoints31)
+    {
+        // Vertices that deviate from the simplified outline by less than half a pixel can not be told apart
+        const auto tolerance31 = static_cast<int64_t>(geometry.pixelDivisor / 2.0);
+        Utilities::simplifyPolyline(pPoints31, pointsCount, tolerance31, simplifiedPoints31);
+        if(simplifiedPoints31.isEmpty())
+            return;
+
+        auto itPoint = simplifiedPoints31.cbegin();
+        path.moveTo(
+            static_cast<float>((itPoint->x - geometry.origin31.x) / geometry.pixelDivisor),
+            static_cast<float>((itPoint->y - geometry.origin31.y) / geometry.pixelDivisor));
+        for(++itPoint; itPoint != simplifiedPoints31.cend(); ++itPoint)
+        {
+            path.lineTo(
+                static_cast<float>((itPoint->x - geometry.origin31.x) / geometry.pixelDivisor),
+                static_cast<float>((itPoint->y - geometry.origin31.y) / geometry.pixelDivisor));
+        }
+    }
+
+} // namespace OsmAnd
+
+float OsmAnd::Rasterizer::obtainPaintMargin( RasterizerContext& context, const RasterizationStyleEvaluator& evaluator )
+{
+    static const std::shared_ptr<RasterizationStyle::ValueDefinition>* const strokeWidths[] =
+    {
+        &RasterizationStyle::builtinValueDefinitions.OUTPUT_STROKE_WIDTH__1,
+        &RasterizationStyle::builtinValueDefinitions.OUTPUT_STROKE_WIDTH_0,
+        &RasterizationStyle::builtinValueDefinitions.OUTPUT_STROKE_WIDTH,
+        &RasterizationStyle::builtinValueDefinitions.OUTPUT_STROKE_WIDTH_2,
+        &RasterizationStyle::builtinValueDefinitions.OUTPUT_STROKE_WIDTH_3,
+    };
+
+    // Widest stroke of all value sets (casings included) and its shadow
+    auto maxStrokeWidth = 0.0f;
+    for(auto idx = 0; idx < 5; idx++)
+    {
+        float strokeWidth;
+        if(evaluator.getFloatValue(*strokeWidths[idx], strokeWidth))
+            maxStrokeWidth = qMax(maxStrokeWidth, strokeWidth);
+    }
+    int shadowRadius;
+    if(!evaluator.getIntegerValue(RasterizationStyle::builtinValueDefinitions.OUTPUT_SHADOW_RADIUS, shadowRadius))
+        shadowRadius = 0;
+    return (maxStrokeWidth + 2 * qMax(shadowRadius, 0) + 1.0f) * context._densityFactor;
+}
+
+bool OsmAnd::Rasterizer::isClippingAllowed( const RasterizationStyleEvaluator& evaluator )
+{
+    static const std::shared_ptr<RasterizationStyle::ValueDefinition>* const pathEffects[] =
+    {
+        &RasterizationStyle::builtinValueDefinitions.OUTPUT_PATH_EFFECT__1,
+        &RasterizationStyle::builtinValueDefinitions.OUTPUT_PATH_EFFECT_0,
+        &RasterizationStyle::builtinValueDefinitions.OUTPUT_PATH_EFFECT,
+        &RasterizationStyle::builtinValueDefinitions.OUTPUT_PATH_EFFECT_2,
+        &RasterizationStyle::builtinValueDefinitions.OUTPUT_PATH_EFFECT_3,
+    };
+
+    // Dashes start over at each end of a path, so clipped paths would have their dashes shifted
+    // differently on each tile
+    for(auto idx = 0; idx < 5; idx++)
+    {
+        QString pathEffect;
+        if(evaluator.getStringValue(*pathEffects[idx], pathEffect) && !pathEffect.isEmpty())
+            return false;
+    }
+
+    return true;
+}
+
+std::shared_ptr<const OsmAnd::RasterizerCachedGeometry> OsmAnd::Rasterizer::obtainGeometry( RasterizerContext& context, const std::shared_ptr<OsmAnd::Model::MapObject>& mapObject )
+{
+    const auto& cachedGeometry = context._geometriesCache->obtain(mapObject, context._precomputed31toPixelDivisor, RasterizerGeometriesCache::Kind::Unclipped);
+    if(cachedGeometry)
+        return cachedGeometry;
+
+    std::shared_ptr<RasterizerCachedGeometry> geometry(new RasterizerCachedGeometry());
+    geometry->pixelDivisor = context._precomputed31toPixelDivisor;
+    if(mapObject->_points31.isEmpty())
+        return geometry;
+    geometry->origin31 = mapObject->_points31.first();
+    geometry->bbox31 = AreaI(geometry->origin31, geometry->origin31);
+    for(auto itPoint = mapObject->_points31.cbegin(); itPoint != mapObject->_points31.cend(); ++itPoint)
+    {
+        geometry->bbox31.left = qMin(geometry->bbox31.left, itPoint->x);
+        geometry->bbox31.right = qMax(geometry->bbox31.right, itPoint->x);
+        geometry->bbox31.top = qMin(geometry->bbox31.top, itPoint->y);
+        geometry->bbox31.bottom = qMax(geometry->bbox31.bottom, itPoint->y);
+    }
+
+    QVector< PointI > simplifiedPoints31;
+    appendToPath(geometry->linePath, mapObject->_points31.constData(), mapObject->_points31.size(), *geometry, simplifiedPoints31);
+
+    // Path data is shared between copies of SkPath until one of them is modified
+    geometry->polygonPath = geometry->linePath;
+    if(!mapObject->_innerPolygonsPoints31.isEmpty())
+    {
+        geometry->polygonPath.setFillType(SkPath::kEvenOdd_FillType);
+        for(auto itPolygon = mapObject->_innerPolygonsPoints31.begin(); itPolygon != mapObject->_innerPolygonsPoints31.end(); ++itPolygon)
+        {
+            const auto& polygon = *itPolygon;
+            if(polygon.isEmpty())
+                continue;
+
+            appendToPath(geometry->polygonPath, polygon.constData(), polygon.size(), *geometry, simplifiedPoints31);
+        }
+    }
+
+    context._geometriesCache->insert(mapObject, context._precomputed31toPixelDivisor, RasterizerGeometriesCache::Kind::Unclipped, AreaI(), geometry);
+
+    return geometry;
+}
+
+std::shared_ptr<const OsmAnd::RasterizerCachedGeometry> OsmAnd::Rasterizer::obtainGeometry( RasterizerContext& context, const std::shared_ptr<OsmAnd::Model::MapObject>& mapObject, bool asPolygon, float clippingMargin )
+{
+    const auto& cachedGeometry = obtainGeometry(context, mapObject);
+
+    // Area being rasterized is extended to cell boundaries and then by a tile, unless margin is even larger,
+    // so that all tiles of a cell clip geometry the same way
+    const auto tileSize31 = static_cast<int64_t>(context._tileDivisor);
+    const auto cellSize31 = tileSize31 * ClippingCellSizeInTiles;
+    const auto margin31 = qMax(static_cast<int64_t>(clippingMargin * context._precomputed31toPixelDivisor), tileSize31);
+    const auto alignDown = [cellSize31](int64_t value31) -> int64_t
+    {
+        return (value31 / cellSize31) * cellSize31;
+    };
+    const auto alignUp = [cellSize31](int64_t value31) -> int64_t
+    {
+        return ((value31 + cellSize31) / cellSize31) * cellSize31 - 1;
+    };
+    const AreaI clipArea31(
+        static_cast<int32_t>(qMax<int64_t>(alignDown(context._area31.top) - margin31, std::numeric_limits<int32_t>::min())),
+        static_cast<int32_t>(qMax<int64_t>(alignDown(context._area31.left) - margin31, std::numeric_limits<int32_t>::min())),
+        static_cast<int32_t>(qMin<int64_t>(alignUp(context._area31.bottom) + margin31, std::numeric_limits<int32_t>::max())),
+        static_cast<int32_t>(qMin<int64_t>(alignUp(context._area31.right) + margin31, std::numeric_limits<int32_t>::max())));
+
+    // Geometry that is not much larger than clipping area is cheaper to translate as a whole
+    const auto& bbox31 = cachedGeometry->bbox31;
+    const auto clipWidth31 = static_cast<int64_t>(clipArea31.right) - clipArea31.left;
+    const auto clipHeight31 = static_cast<int64_t>(clipArea31.bottom) - clipArea31.top;
+    const auto isWide = static_cast<int64_t>(bbox31.width()) > ClippingSizeRatioThreshold * clipWidth31;
+    const auto isHigh = static_cast<int64_t>(bbox31.height()) > ClippingSizeRatioThreshold * clipHeight31;
+    if(!isWide && !isHigh)
+        return cachedGeometry;
+
+    const auto kind = asPolygon ? RasterizerGeometriesCache::Kind::ClippedPolygon : RasterizerGeometriesCache::Kind::ClippedLine;
+    const auto& cachedClippedGeometry = context._geometriesCache->obtain(mapObject, context._precomputed31toPixelDivisor, kind, clipArea31);
+    if(cachedClippedGeometry)
+        return cachedClippedGeometry;
+
+    std::shared_ptr<RasterizerCachedGeometry> geometry(new RasterizerCachedGeometry());
+    geometry->pixelDivisor = context._precomputed31toPixelDivisor;
+    geometry->origin31 = clipArea31.topLeft;
+    geometry->bbox31 = clipArea31;
+
+    QVector< PointI > simplifiedPoints31;
+    if(asPolygon)
+    {
+        QVector< PointI > clippedPolygon;
+        Utilities::clipPolygon(mapObject->_points31.constData(), mapObject->_points31.size(), clipArea31, clippedPolygon);
+        appendToPath(geometry->polygonPath, clippedPolygon.constData(), clippedPolygon.size(), *geometry, simplifiedPoints31);
+        if(!mapObject->_innerPolygonsPoints31.isEmpty())
+        {
+            geometry->polygonPath.setFillType(SkPath::kEvenOdd_FillType);
+            for(auto itPolygon = mapObject->_innerPolygonsPoints31.begin(); itPolygon != mapObject->_innerPolygonsPoints31.end(); ++itPolygon)
+            {
+                Utilities::clipPolygon(itPolygon->constData(), itPolygon->size(), clipArea31, clippedPolygon);
+                appendToPath(geometry->polygonPath, clippedPolygon.constData(), clippedPolygon.size(), *geometry, simplifiedPoints31);
+            }
+        }
+    }
+    else
+    {
+        QList< QVector< PointI > > clippedPolylines;
+        Utilities::clipPolyline(mapObject->_points31.constData(), mapObject->_points31.size(), clipArea31, clippedPolylines);
+        for(auto itPolyline = clippedPolylines.cbegin(); itPolyline != clippedPolylines.cend(); ++itPolyline)
+            appendToPath(geometry->linePath, itPolyline->constData(), itPolyline->size(), *geometry, simplifiedPoints31);
+    }
+
+    context._geometriesCache->insert(mapObject, context._precomputed31toPixelDivisor, kind, clipArea31, geometry);
+
+    return geometry;
+}
+
+bool OsmAnd::Rasterizer::translateToGeometry( RasterizerContext& context, SkCanvas& canvas, const RasterizerCachedGeometry& geometry, const SkPath& path, float paintMargin )
+{
+    if(path.isEmpty())
+        return false;
+
+    const auto dx = static_cast<float>((geometry.origin31.x - context._area31.left) / context._precomputed31toPixelDivisor) + context._renderViewport.left;
+    const auto dy = static_cast<float>((geometry.origin31.y - context._area31.top) / context._precomputed31toPixelDivisor) + context._renderViewport.top;
+
+    // Skip paths that, including widest stroke and shadow of all value sets, do not reach the viewport
+    auto bounds = path.getBounds();
+    bounds.offset(dx, dy);
+    bounds.outset(paintMargin, paintMargin);
+    if(bounds.fRight < context._renderViewport.left || bounds.fLeft > context._renderViewport.right ||
+        bounds.fBottom < context._renderViewport.top || bounds.fTop > context._renderViewport.bottom)
+        return false;
+
+    // Shader pattern stays aligned to the canvas, not to the object. Shaders that are set up by updatePaint()
+    // after this point are compensated by the same offset.
+    context._mapPaintOffset = PointF(dx, dy);
+    const auto shader = context._mapPaint.getShader();
+    if(shader)
+    {
+        SkMatrix localMatrix(context._mapPaintShaderMatrix);
+        localMatrix.postTranslate(-dx, -dy);
+        shader->setLocalMatrix(localMatrix);
+    }
+
+    canvas.translate(dx, dy);
+    return true;
+}
+
 void OsmAnd::Rasterizer::calculateVertex( RasterizerContext& context, const PointI& point31, PointF& vertex )
 {
     vertex.x = static_cast<float>(point31.x - context._area31.left) / context._precomputed31toPixelDivisor + context._renderViewport.left;
@@ -868,8 +1162,20 @@ bool OsmAnd::Rasterizer::contains( const QVector< PointF >& vertices, const Poin
     return intersections % 2 == 1;
 }
 
+std::shared_ptr<OsmAnd::Model::MapObject> OsmAnd::Rasterizer::createCoastlineObject(
+    const std::shared_ptr<Model::MapObjectsArena>& arena,
+    const QVector< PointI >& points31,
+    uint32_t typeId )
+{
+    const auto mapObject = Model::MapObject::create(nullptr, arena);
+    mapObject->_points31 = arena->copyArray(points31);
+    mapObject->_types = arena->copyArray(&typeId, 1);
+    return mapObject;
+}
+
 bool OsmAnd::Rasterizer::polygonizeCoastlines(
     RasterizerContext& context,
+    const std::shared_ptr<Model::MapObjectsArena>& arena,
     const QList< std::shared_ptr<OsmAnd::Model::MapObject> >& coastlines,
     QList< std::shared_ptr<OsmAnd::Model::MapObject> >& outVectorized,
     bool abortIfBrokenCoastlinesExist,
@@ -941,9 +1247,7 @@ bool OsmAnd::Rasterizer::polygonizeCoastlines(
         {
             const auto& polygon = *itPolygon;
 
-            std::shared_ptr<Model::MapObject> mapObject(new Model::MapObject(nullptr));
-            mapObject->_points31 = polygon;
-            mapObject->_types.push_back(TagValue("natural", "coastline_broken"));
+            const auto mapObject = createCoastlineObject(arena, polygon, Model::TagValueDictionary::NaturalCoastlineBroken);
 
             outVectorized.push_back(mapObject);
         }
@@ -952,9 +1256,7 @@ bool OsmAnd::Rasterizer::polygonizeCoastlines(
         {
             const auto& polygon = *itPolygon;
 
-            std::shared_ptr<Model::MapObject> mapObject(new Model::MapObject(nullptr));
-            mapObject->_points31 = polygon;
-            mapObject->_types.push_back(TagValue("natural", "coastline_line"));
+            const auto mapObject = createCoastlineObject(arena, polygon, Model::TagValueDictionary::NaturalCoastlineLine);
 
             outVectorized.push_back(mapObject);
         }
@@ -972,9 +1274,8 @@ bool OsmAnd::Rasterizer::polygonizeCoastlines(
         bool clockwise = isClockwiseCoastlinePolygon(polygon);
         clockwiseFound = clockwiseFound || clockwise;
 
-        std::shared_ptr<Model::MapObject> mapObject(new Model::MapObject(nullptr));
-        mapObject->_points31 = polygon;
-        mapObject->_types.push_back(TagValue("natural", clockwise ? "coastline" : "land"));
+        const auto mapObject = createCoastlineObject(arena, polygon,
+            clockwise ? Model::TagValueDictionary::NaturalCoastline : Model::TagValueDictionary::NaturalLand);
         mapObject->_id = osmId;
         mapObject->_isArea = true;
 
@@ -991,14 +1292,15 @@ bool OsmAnd::Rasterizer::polygonizeCoastlines(
             context._zoom);
 
         // add complete water tile
-        std::shared_ptr<Model::MapObject> mapObject(new Model::MapObject(nullptr));
-        mapObject->_points31.push_back(PointI(context._area31.left, context._area31.top));
-        mapObject->_points31.push_back(PointI(context._area31.right, context._area31.top));
-        mapObject->_points31.push_back(PointI(context._area31.right, context._area31.bottom));
-        mapObject->_points31.push_back(PointI(context._area31.left, context._area31.bottom));
-        mapObject->_points31.push_back(PointI(context._area31.left, context._area31.top));
-
-        mapObject->_types.push_back(TagValue("natural", "coastline"));
+        QVector< PointI > points31;
+        points31.reserve(5);
+        points31.push_back(PointI(context._area31.left, context._area31.top));
+        points31.push_back(PointI(context._area31.right, context._area31.top));
+        points31.push_back(PointI(context._area31.right, context._area31.bottom));
+        points31.push_back(PointI(context._area31.left, context._area31.bottom));
+        points31.push_back(PointI(context._area31.left, context._area31.top));
+
+        const auto mapObject = createCoastlineObject(arena, points31, Model::TagValueDictionary::NaturalCoastline);
         mapObject->_id = osmId;
         mapObject->_isArea = true;
 
@@ -1426,12 +1728,89 @@ void OsmAnd::Rasterizer::obtainPrimitivesTexts( RasterizerContext& context, IQue
     collectPrimitivesTexts(context, context._lines, Lines, controller);
     collectPrimitivesTexts(context, context._points, Points, controller);
 
-    qSort(context._texts.begin(), context._texts.end(), [](const TextPrimitive& l, const TextPrimitive& r) -> bool
+    qStableSort(context._texts.begin(), context._texts.end(), [](const TextPrimitive& l, const TextPrimitive& r) -> bool
     {
         return l.order < r.order;
     });
 }
 
+namespace OsmAnd {
+
+    // Uniform grid of placed label bounds. Each bounds rectangle is registered in all cells it overlaps,
+    // so a candidate is only tested against labels that are near it.
+    class TextCollisionGrid
+    {
+    public:
+        TextCollisionGrid(const AreaF& area, float cellSize)
+            : _origin(area.topLeft)
+            , _cellSize(cellSize)
+        {
+            // Labels that stick out of the viewport still may collide with each other, so grid covers one more cell around it
+            _columns = static_cast<int>(qCeil(area.width() / cellSize)) + 2;
+            _rows = static_cast<int>(qCeil(area.height() / cellSize)) + 2;
+            _cells.resize(_columns * _rows);
+        }
+
+        bool intersects(const QVector< SkRect >& bounds) const
+        {
+            for(auto itRect = bounds.cbegin(); itRect != bounds.cend(); ++itRect)
+            {
+                const auto& rect = *itRect;
+
+                int left, top, right, bottom;
+                obtainCellsRange(rect, left, top, right, bottom);
+                for(auto row = top; row <= bottom; row++)
+                {
+                    for(auto column = left; column <= right; column++)
+                    {
+                        const auto& cell = _cells[row * _columns + column];
+                        for(auto itIdx = cell.cbegin(); itIdx != cell.cend(); ++itIdx)
+                        {
+                            if(SkRect::Intersects(_placedBounds[*itIdx], rect))
+                                return true;
+                        }
+                    }
+                }
+            }
+            return false;
+        }
+
+        void insert(const QVector< SkRect >& bounds)
+        {
+            for(auto itRect = bounds.cbegin(); itRect != bounds.cend(); ++itRect)
+            {
+                const auto& rect = *itRect;
+                const auto idx = _placedBounds.size();
+                _placedBounds.push_back(rect);
+
+                int left, top, right, bottom;
+                obtainCellsRange(rect, left, top, right, bottom);
+                for(auto row = top; row <= bottom; row++)
+                {
+                    for(auto column = left; column <= right; column++)
+                        _cells[row * _columns + column].push_back(idx);
+                }
+            }
+        }
+    private:
+        const PointF _origin;
+        const float _cellSize;
+        int _columns;
+        int _rows;
+        QVector< QVector<int> > _cells;
+        QVector< SkRect > _placedBounds;
+
+        void obtainCellsRange(const SkRect& rect, int& left, int& top, int& right, int& bottom) const
+        {
+            left = qBound(0, static_cast<int>(qFloor((rect.fLeft - _origin.x) / _cellSize)) + 1, _columns - 1);
+            right = qBound(0, static_cast<int>(qFloor((rect.fRight - _origin.x) / _cellSize)) + 1, _columns - 1);
+            top = qBound(0, static_cast<int>(qFloor((rect.fTop - _origin.y) / _cellSize)) + 1, _rows - 1);
+            bottom = qBound(0, static_cast<int>(qFloor((rect.fBottom - _origin.y) / _cellSize)) + 1, _rows - 1);
+        }
+    };
+
+} // namespace OsmAnd
+
 void OsmAnd::Rasterizer::rasterizeText( RasterizerContext& context, bool fillBackground, SkCanvas& canvas, IQueryController* controller /*= nullptr*/ )
 {
     if(fillBackground)
@@ -1441,18 +1820,12 @@ void OsmAnd::Rasterizer::rasterizeText( RasterizerContext& context, bool fillBac
         bgPaint.setStyle(SkPaint::kFill_Style);
         canvas.drawRectCoords(context._renderViewport.top, context._renderViewport.left, context._renderViewport.right, context._renderViewport.bottom, bgPaint);
     }
-    /*
-    SkRect r = SkRect::MakeLTRB(0, 0, rc->getWidth(), rc->getHeight());
-    r.inset(-100, -100);
-    quad_tree<TextDrawInfo*> boundsIntersect(r, 4, 0.6);
-    */
-    /*
-#if defined(ANDROID)
-    //TODO: This is never released because of always +1 of reference counter
-    if(!sDefaultTypeface)
-        sDefaultTypeface = SkTypeface::CreateFromName("Droid Serif", SkTypeface::kNormal);
-#endif
-        */
+
+    // Texts are already ordered by priority, so each one is placed only if it does not overlap any
+    // of already placed ones and if there's no text with same content closer than its minimal distance
+    TextCollisionGrid collisionGrid(context._renderViewport, TextCollisionGridCellSize * context._densityFactor);
+    QHash< QString, QVector<PointF> > placedTextsCenters;
+    QVector< SkRect > bounds;
     SkPaint::FontMetrics fontMetrics;
     for(auto itText = context._texts.begin(); itText != context._texts.end(); ++itText)
     {
@@ -1465,46 +1838,153 @@ void OsmAnd::Rasterizer::rasterizeText( RasterizerContext& context, bool fillBac
         context._textPaint.setFakeBoldText(text.isBold);//TODO: use special typeface!
         context._textPaint.setColor(text.color);
         context._textPaint.getFontMetrics(&fontMetrics);
-        /*textDrawInfo->centerY += (-fm.fAscent);
 
-        // calculate if there is intersection
-        bool intersects = findTextIntersection(cv, rc, boundsIntersect, textDrawInfo, &paintText, &paintIcon);
-        if(intersects)
+        float hOffset = 0.0f;
+        bounds.clear();
+        if(!calculateTextBounds(context, text, fontMetrics, hOffset, bounds))
+            continue;
+        if(collisionGrid.intersects(bounds))
             continue;
 
-        if (textDrawInfo->drawOnPath && textDrawInfo->path != NULL) {
-            if (textDrawInfo->textShadow > 0) {
-                paintText.setColor(0xFFFFFFFF);
-                paintText.setStyle(SkPaint::kStroke_Style);
-                paintText.setStrokeWidth(2 + textDrawInfo->textShadow);
-                rc->nativeOperations.Pause();
-                cv->drawTextOnPathHV(textDrawInfo->text.c_str(), textDrawInfo->text.length(), *textDrawInfo->path, textDrawInfo->hOffset,
-                    textDrawInfo->vOffset, paintText);
-                rc->nativeOperations.Start();
-                // reset
-                paintText.setStyle(SkPaint::kFill_Style);
-                paintText.setStrokeWidth(2);
-                paintText.setColor(textDrawInfo->textColor);
-            }
-            rc->nativeOperations.Pause();
-            cv->drawTextOnPathHV(textDrawInfo->text.c_str(), textDrawInfo->text.length(), *textDrawInfo->path, textDrawInfo->hOffset,
-                textDrawInfo->vOffset, paintText);
-            rc->nativeOperations.Start();
-        } else {
-            if (textDrawInfo->shieldRes.length() > 0) {
-                SkBitmap* ico = getCachedBitmap(rc, textDrawInfo->shieldRes);
-                if (ico != NULL) {
-                    float left = textDrawInfo->centerX - rc->getDensityValue(ico->width() / 2) - 0.5f;
-                    float top = textDrawInfo->centerY - rc->getDensityValue(ico->height() / 2)
-                        - rc->getDensityValue(4.5f);
-                    SkRect r = SkRect::MakeXYWH(left, top, rc->getDensityValue(ico->width()),
-                        rc->getDensityValue(ico->height()));
-                    PROFILE_NATIVE_OPERATION(rc, cv->drawBitmapRect(*ico, (SkIRect*) NULL, r, &paintIcon));
+        SkRect extent = bounds.first();
+        for(auto itRect = bounds.cbegin() + 1; itRect != bounds.cend(); ++itRect)
+            extent.join(*itRect);
+        const PointF center(extent.centerX(), extent.centerY());
+        if(text.minDistance > 0)
+        {
+            const auto minDistance = text.minDistance * context._densityFactor;
+            const auto squaredMinDistance = minDistance * minDistance;
+
+            auto isTooClose = false;
+            const auto& sameTextsCenters = placedTextsCenters[text.content];
+            for(auto itCenter = sameTextsCenters.cbegin(); itCenter != sameTextsCenters.cend(); ++itCenter)
+            {
+                const auto dx = itCenter->x - center.x;
+                const auto dy = itCenter->y - center.y;
+                if(dx*dx + dy*dy < squaredMinDistance)
+                {
+                    isTooClose = true;
+                    break;
                 }
             }
-            drawWrappedText(rc, cv, textDrawInfo, textSize, paintText);
-        }*/
+            if(isTooClose)
+                continue;
+        }
+
+        collisionGrid.insert(bounds);
+        placedTextsCenters[text.content].push_back(center);
+
+        drawText(context, canvas, text, fontMetrics, hOffset);
+    }
+}
+
+bool OsmAnd::Rasterizer::calculateTextBounds( RasterizerContext& context, const TextPrimitive& text, const SkPaint::FontMetrics& fontMetrics, float& outHOffset, QVector< SkRect >& outBounds )
+{
+    const auto& shapedText = *text.shapedContent;
+    const auto textWidth = shapedText.width;
+    const auto halo = text.shadowRadius * context._densityFactor;
+    const auto vOffset = text.vOffset * context._densityFactor;
+    const auto baselineOffset = vOffset - (fontMetrics.fAscent + fontMetrics.fDescent) / 2.0f;
+
+    if(text.drawOnPath && text.path)
+    {
+        // Text is centered on the path, and its bounds are squares around ink of each glyph placed where that
+        // glyph is drawn on the path, so that rotated and curved texts are covered closely
+        SkPathMeasure pathMeasure(*text.path, false);
+        const auto pathLength = pathMeasure.getLength();
+        if(pathLength < textWidth)
+            return false;
+        // Text paint is center-aligned, so offset points to the middle of the text
+        outHOffset = pathLength / 2.0f;
+        const auto textStart = (pathLength - textWidth) / 2.0f;
+
+        auto penPosition = textStart;
+        for(auto glyphIdx = 0; glyphIdx < shapedText.glyphs.size(); glyphIdx++)
+        {
+            const auto& glyphBounds = shapedText.glyphsBounds[glyphIdx];
+            const auto glyphStart = penPosition;
+            penPosition += shapedText.advances[glyphIdx];
+
+            // Glyphs without ink, like spaces, do not collide with anything
+            if(glyphBounds.isEmpty())
+                continue;
+
+            SkPoint position;
+            SkVector tangent;
+            if(!pathMeasure.getPosTan(qMin(glyphStart + glyphBounds.centerX(), pathLength), &position, &tangent))
+                return false;
+
+            // Glyph baseline is shifted along the normal of the path
+            const auto normalOffset = baselineOffset + glyphBounds.centerY();
+            const auto x = position.fX - tangent.fY * normalOffset;
+            const auto y = position.fY + tangent.fX * normalOffset;
+            const auto halfSide = qMax(glyphBounds.width(), glyphBounds.height()) / 2.0f + halo;
+            outBounds.push_back(SkRect::MakeLTRB(x - halfSide, y - halfSide, x + halfSide, y + halfSide));
+        }
+        if(outBounds.isEmpty())
+            return false;
+    }
+    else
+    {
+        // Ink bounds of the run are relative to its start, and text paint is center-aligned
+        auto bounds = shapedText.bounds;
+        bounds.offset(text.center.x - textWidth / 2.0f, text.center.y + baselineOffset);
+        bounds.outset(halo, halo);
+        if(text.shield)
+            bounds.join(obtainShieldRect(context, text));
+        if(bounds.isEmpty())
+            return false;
+        outBounds.push_back(bounds);
     }
+
+    // Texts that are completely out of viewport are not placed at all
+    SkRect viewport = SkRect::MakeLTRB(context._renderViewport.left, context._renderViewport.top, context._renderViewport.right, context._renderViewport.bottom);
+    for(auto itRect = outBounds.cbegin(); itRect != outBounds.cend(); ++itRect)
+    {
+        if(SkRect::Intersects(*itRect, viewport))
+            return true;
+    }
+    return false;
+}
+
+SkRect OsmAnd::Rasterizer::obtainShieldRect( RasterizerContext& context, const TextPrimitive& text )
+{
+    // Shield is already scaled to density, and is centered on the text
+    const auto width = static_cast<float>(text.shield->width());
+    const auto height = static_cast<float>(text.shield->height());
+    const auto centerY = text.center.y + text.vOffset * context._densityFactor;
+    return SkRect::MakeXYWH(text.center.x - width / 2.0f, centerY - height / 2.0f, width, height);
+}
+
+void OsmAnd::Rasterizer::drawText( RasterizerContext& context, SkCanvas& canvas, const TextPrimitive& text, const SkPaint::FontMetrics& fontMetrics, float hOffset )
+{
+    const auto& glyphs = text.shapedContent->glyphs;
+    const auto pText = glyphs.constData();
+    const auto textLength = glyphs.size() * sizeof(uint16_t);
+    const auto vOffset = text.vOffset * context._densityFactor;
+
+    const auto draw = [&]()
+    {
+        if(text.drawOnPath && text.path)
+            canvas.drawTextOnPathHV(pText, textLength, *text.path, hOffset, vOffset - (fontMetrics.fAscent + fontMetrics.fDescent) / 2.0f, context._textPaint);
+        else
+            canvas.drawText(pText, textLength, text.center.x, text.center.y + vOffset - (fontMetrics.fAscent + fontMetrics.fDescent) / 2.0f, context._textPaint);
+    };
+
+    if(text.shield && !(text.drawOnPath && text.path))
+        canvas.drawBitmapRect(*text.shield, nullptr, obtainShieldRect(context, text), &context._shieldPaint);
+
+    if(text.shadowRadius > 0)
+    {
+        context._textPaint.setColor(SK_ColorWHITE);
+        context._textPaint.setStyle(SkPaint::kStroke_Style);
+        context._textPaint.setStrokeWidth(2 + text.shadowRadius * context._densityFactor);
+        draw();
+        context._textPaint.setStyle(SkPaint::kFill_Style);
+        context._textPaint.setStrokeWidth(1);
+        context._textPaint.setColor(text.color);
+    }
+    draw();
 }
 
 void OsmAnd::Rasterizer::collectPrimitivesTexts( RasterizerContext& context, const QVector< Rasterizer::Primitive >& primitives, PrimitivesType type, IQueryController* controller )
@@ -1522,9 +2002,9 @@ void OsmAnd::Rasterizer::collectPrimitivesTexts( RasterizerContext& context, con
         if(primitive.mapObject->names.isEmpty())
             continue;
         bool hasNonEmptyNames = false;
-        for(auto itName = primitive.mapObject->names.begin(); itName != primitive.mapObject->names.end(); ++itName)
+        for(auto itName = primitive.mapObject->names.cbegin(); itName != primitive.mapObject->names.cend(); ++itName)
         {
-            const auto& name = itName.value();
+            const auto& name = primitive.mapObject->getNameValue(*itName);
 
             if(!name.isEmpty())
             {
@@ -1575,14 +2055,13 @@ void OsmAnd::Rasterizer::collectPolygonText( RasterizerContext& context, const P
     }
 
     {
-        const auto& type = primitive.mapObject->_types[primitive.typeIndex];
+        const auto& typeId = primitive.mapObject->_types[primitive.typeIndex];
         RasterizationStyleEvaluator evaluator(context.style, RasterizationStyle::RulesetType::Polygon, primitive.mapObject);
         context.applyTo(evaluator);
-        evaluator.setStringValue(RasterizationStyle::builtinValueDefinitions.INPUT_TAG, type.tag);
-        evaluator.setStringValue(RasterizationStyle::builtinValueDefinitions.INPUT_VALUE, type.value);
+        context.applyTypeTo(evaluator, typeId);
         evaluator.setIntegerValue(RasterizationStyle::builtinValueDefinitions.INPUT_MINZOOM, context._zoom);
         evaluator.setIntegerValue(RasterizationStyle::builtinValueDefinitions.INPUT_MAXZOOM, context._zoom);
-        if(!evaluator.evaluate())
+        if(!evaluator.evaluate(context._evaluationResultsCache))
             return;
         if(!updatePaint(context, evaluator, Set_0, true))
             return;
@@ -1657,15 +2136,14 @@ void OsmAnd::Rasterizer::collectLineText( RasterizerContext& context, const Prim
     }
 
     {
-        const auto& type = primitive.mapObject->_types[primitive.typeIndex];
+        const auto& typeId = primitive.mapObject->_types[primitive.typeIndex];
         RasterizationStyleEvaluator evaluator(context.style, RasterizationStyle::RulesetType::Line, primitive.mapObject);
         context.applyTo(evaluator);
-        evaluator.setStringValue(RasterizationStyle::builtinValueDefinitions.INPUT_TAG, type.tag);
-        evaluator.setStringValue(RasterizationStyle::builtinValueDefinitions.INPUT_VALUE, type.value);
+        context.applyTypeTo(evaluator, typeId);
         evaluator.setIntegerValue(RasterizationStyle::builtinValueDefinitions.INPUT_MINZOOM, context._zoom);
         evaluator.setIntegerValue(RasterizationStyle::builtinValueDefinitions.INPUT_MAXZOOM, context._zoom);
         evaluator.setIntegerValue(RasterizationStyle::builtinValueDefinitions.INPUT_LAYER, primitive.mapObject->getSimpleLayerValue());
-        if(!evaluator.evaluate())
+        if(!evaluator.evaluate(context._evaluationResultsCache))
             return;
         if(!updatePaint(context, evaluator, Set_0, false))
             return;
@@ -1738,57 +2216,58 @@ void OsmAnd::Rasterizer::collectPointText( RasterizerContext& context, const Pri
     }
 
     PointF textPoint;
-    if(primitive.mapObject->_points31.size() == 1)
-    {
-        const auto& p = primitive.mapObject->_points31.first();
-        textPoint.x = p.x;
-        textPoint.y = p.y;
-    }
-    else
-    {
-        auto verticesCount = primitive.mapObject->_points31.size();
+    obtainPointCenter(context, primitive, textPoint);
+    
+    preparePrimitiveText(context, primitive, textPoint, nullptr);
+}
 
-        PointF vertex;
-        for(auto itPoint = primitive.mapObject->_points31.begin(); itPoint != primitive.mapObject->_points31.end(); ++itPoint)
-        {
-            const auto& point = *itPoint;
+bool OsmAnd::Rasterizer::obtainPointCenter( RasterizerContext& context, const Primitive& primitive, PointF& center )
+{
+    const auto& points31 = primitive.mapObject->_points31;
+    if(points31.isEmpty())
+        return false;
 
-            calculateVertex(context, point, vertex);
+    if(points31.size() == 1)
+    {
+        calculateVertex(context, points31.first(), center);
+        return true;
+    }
 
-            textPoint += vertex;
-        }
+    center = PointF();
+    PointF vertex;
+    for(auto itPoint = points31.cbegin(); itPoint != points31.cend(); ++itPoint)
+    {
+        calculateVertex(context, *itPoint, vertex);
 
-        textPoint.x /= verticesCount;
-        textPoint.y /= verticesCount;
+        center += vertex;
     }
-    
-    preparePrimitiveText(context, primitive, textPoint, nullptr);
+    center.x /= points31.size();
+    center.y /= points31.size();
+    return true;
 }
 
 void OsmAnd::Rasterizer::preparePrimitiveText( RasterizerContext& context, const Primitive& primitive, const PointF& point, SkPath* path )
 {
-    const auto& type = primitive.mapObject->_types[primitive.typeIndex];
+    const auto& typeId = primitive.mapObject->_types[primitive.typeIndex];
 
-    for(auto itName = primitive.mapObject->names.begin(); itName != primitive.mapObject->names.end(); ++itName)
+    for(auto itName = primitive.mapObject->names.cbegin(); itName != primitive.mapObject->names.cend(); ++itName)
     {
-        const auto& name = itName.value();
+        const auto& name = primitive.mapObject->getNameValue(*itName);
 
         //TODO:name =rc->getTranslatedString(name);
         //TODO:name =rc->getReshapedString(name);
 
-        const auto& type = primitive.mapObject->_types[primitive.typeIndex];
         RasterizationStyleEvaluator evaluator(context.style, RasterizationStyle::RulesetType::Text, primitive.mapObject);
         context.applyTo(evaluator);
-        evaluator.setStringValue(RasterizationStyle::builtinValueDefinitions.INPUT_TAG, type.tag);
-        evaluator.setStringValue(RasterizationStyle::builtinValueDefinitions.INPUT_VALUE, type.value);
+        context.applyTypeTo(evaluator, typeId);
         evaluator.setIntegerValue(RasterizationStyle::builtinValueDefinitions.INPUT_MINZOOM, context._zoom);
         evaluator.setIntegerValue(RasterizationStyle::builtinValueDefinitions.INPUT_MAXZOOM, context._zoom);
         evaluator.setIntegerValue(RasterizationStyle::builtinValueDefinitions.INPUT_TEXT_LENGTH, name.length());
-        auto nameTag = itName.key();
+        auto nameTag = primitive.mapObject->getNameTag(*itName);
         if(nameTag == "name")
             nameTag.clear();
         evaluator.setStringValue(RasterizationStyle::builtinValueDefinitions.INPUT_NAME_TAG, nameTag);
-        if(!evaluator.evaluate())
+        if(!evaluator.evaluate(context._evaluationResultsCache))
             continue;
 
         bool ok;
@@ -1824,9 +2303,18 @@ void OsmAnd::Rasterizer::preparePrimitiveText( RasterizerContext& context, const
         text.minDistance = 0;
         evaluator.getIntegerValue(RasterizationStyle::builtinValueDefinitions.OUTPUT_TEXT_MIN_DISTANCE, text.minDistance);
         evaluator.getStringValue(RasterizationStyle::builtinValueDefinitions.OUTPUT_TEXT_SHIELD, text.shieldResource);
+        if(!text.shieldResource.isEmpty() && !text.drawOnPath)
+            text.shield = StyleBitmapsCache::obtain(StyleBitmapsCache::Kind::Shield, text.shieldResource, context._densityFactor);
         text.order = 100;
         evaluator.getIntegerValue(RasterizationStyle::builtinValueDefinitions.OUTPUT_TEXT_ORDER, text.order);
 
+        // Text is shaped and measured here once, placement and drawing reuse that glyph run
+        context._textPaint.setTextSize(text.size * context._densityFactor);
+        context._textPaint.setFakeBoldText(text.isBold);
+        text.shapedContent = ShapedTextsCache::obtain(context._textPaint, text.content);
+        if(text.shapedContent->glyphs.isEmpty())
+            continue;
+
         context._texts.push_back(text);
     }
 }
@@ -8,14 +8,17 @@
 
 OsmAnd::RasterizerContext::RasterizerContext( const std::shared_ptr<RasterizationStyle>& style_ )
     : style(style_)
+    , _zoom(std::numeric_limits<uint32_t>::max())
+    , _geometriesCache(new RasterizerGeometriesCache())
 {
     initialize();
 }
 
-OsmAnd::RasterizerContext::RasterizerContext( const std::shared_ptr<RasterizationStyle>& style_, const QMap< std::shared_ptr<RasterizationStyle::ValueDefinition>, RasterizationRule::Value >& styleInitialSettings )
+OsmAnd::RasterizerContext::RasterizerContext( const std::shared_ptr<RasterizationStyle>& style_, const QMap< std::shared_ptr<RasterizationStyle::ValueDefinition>, RasterizationRule::Value >& styleInitialSettings, const std::shared_ptr<RasterizerGeometriesCache>& geometriesCache /*= std::shared_ptr<RasterizerGeometriesCache>()*/ )
     : style(style_)
     , _zoom(std::numeric_limits<uint32_t>::max())
     , _styleInitialSettings(styleInitialSettings)
+    , _geometriesCache(geometriesCache ? geometriesCache : std::shared_ptr<RasterizerGeometriesCache>(new RasterizerGeometriesCache()))
 {
     initialize();
 }
@@ -151,7 +154,10 @@ void OsmAnd::RasterizerContext::initialize()
     _textPaint.setStrokeWidth(1);
     _textPaint.setColor(SK_ColorBLACK);
     _textPaint.setTextAlign(SkPaint::kCenter_Align);
+    _textPaint.setTextEncoding(SkPaint::kGlyphID_TextEncoding);
     _textPaint.setAntiAlias(true);
+
+    _shieldPaint.setFilterBitmap(true);
 }
 
 bool OsmAnd::RasterizerContext::update( const AreaI& area31, uint32_t zoom, const PointF& tlOriginOffset, uint32_t tileSidePixelLength, float densityFactor )
@@ -168,6 +174,8 @@ bool OsmAnd::RasterizerContext::update( const AreaI& area31, uint32_t zoom, cons
 
     if(evaluateAttributes)
     {
+        _evaluationResultsCache.entries.clear();
+
         _tileDivisor = Utilities::getPowZoom(31 - zoom);
         if(attributeRule_defaultColor)
         {
@@ -248,6 +256,19 @@ void OsmAnd::RasterizerContext::applyTo( RasterizationStyleEvaluator& evaluator
     }
 }
 
+void OsmAnd::RasterizerContext::applyTypeTo( RasterizationStyleEvaluator& evaluator, uint32_t typeId )
+{
+    if(!_typesStringIds || typeId >= static_cast<uint32_t>(_typesStringIds->size()))
+        _typesStringIds = style->obtainTypesStringIds(typeId);
+    const auto& typeStringIds = (*_typesStringIds)[typeId];
+
+    RasterizationRule::Value value;
+    value.asUInt = typeStringIds.tagId;
+    evaluator.setValue(RasterizationStyle::builtinValueDefinitions.INPUT_TAG, value);
+    value.asUInt = typeStringIds.valueId;
+    evaluator.setValue(RasterizationStyle::builtinValueDefinitions.INPUT_VALUE, value);
+}
+
 SkPathEffect* OsmAnd::RasterizerContext::obtainPathEffect( const QString& pathEffect )
 {
     auto itEffect = _pathEffects.find(pathEffect);
@@ -0,0 +1,75 @@
+#include "RasterizerGeometriesCache.h"
+
+OsmAnd::RasterizerGeometriesCache::RasterizerGeometriesCache( const uint32_t capacity /*= DefaultCapacity*/ )
+    : _cache(static_cast<int>(capacity))
+{
+}
+
+OsmAnd::RasterizerGeometriesCache::~RasterizerGeometriesCache()
+{
+}
+
+bool OsmAnd::RasterizerGeometriesCache::makeKey( const std::shared_ptr<const Model::MapObject>& mapObject, double pixelDivisor, Kind kind, const AreaI& clipArea31, Key& outKey )
+{
+    // Ids are unique only within map section
+    if(!mapObject->section)
+        return false;
+
+    outKey.section = mapObject->section;
+    outKey.objectId = mapObject->id;
+    outKey.pixelDivisor = pixelDivisor;
+    outKey.kind = kind;
+    outKey.clipArea31 = (kind == Kind::Unclipped) ? AreaI() : clipArea31;
+    return true;
+}
+
+std::shared_ptr<const OsmAnd::RasterizerCachedGeometry> OsmAnd::RasterizerGeometriesCache::obtain( const std::shared_ptr<const Model::MapObject>& mapObject, double pixelDivisor, Kind kind, const AreaI& clipArea31 /*= AreaI()*/ )
+{
+    Key key;
+    if(!makeKey(mapObject, pixelDivisor, kind, clipArea31, key))
+        return std::shared_ptr<const RasterizerCachedGeometry>();
+
+    QMutexLocker scopeLock(&_mutex);
+
+    const auto pGeometry = _cache.object(key);
+    if(!pGeometry)
+        return std::shared_ptr<const RasterizerCachedGeometry>();
+    return *pGeometry;
+}
+
+void OsmAnd::RasterizerGeometriesCache::insert( const std::shared_ptr<const Model::MapObject>& mapObject, double pixelDivisor, Kind kind, const AreaI& clipArea31, const std::shared_ptr<const RasterizerCachedGeometry>& geometry )
+{
+    Key key;
+    if(!makeKey(mapObject, pixelDivisor, kind, clipArea31, key))
+        return;
+
+    // Polygon path shares points with line path unless it has inner polygons or was clipped separately
+    auto pointsCount = geometry->linePath.countPoints();
+    if(geometry->polygonPath.countPoints() != pointsCount)
+        pointsCount += geometry->polygonPath.countPoints();
+
+    QMutexLocker scopeLock(&_mutex);
+
+    _cache.insert(key, new std::shared_ptr<const RasterizerCachedGeometry>(geometry), qMax(pointsCount, 1));
+}
+
+uint32_t OsmAnd::RasterizerGeometriesCache::getCapacity()
+{
+    QMutexLocker scopeLock(&_mutex);
+
+    return static_cast<uint32_t>(_cache.maxCost());
+}
+
+void OsmAnd::RasterizerGeometriesCache::setCapacity( const uint32_t capacity )
+{
+    QMutexLocker scopeLock(&_mutex);
+
+    _cache.setMaxCost(static_cast<int>(capacity));
+}
+
+void OsmAnd::RasterizerGeometriesCache::clear()
+{
+    QMutexLocker scopeLock(&_mutex);
+
+    _cache.clear();
+}
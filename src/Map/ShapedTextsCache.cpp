@@ -0,0 +1,136 @@
+#include "ShapedTextsCache.h"
+
+#include <cstring>
+
+#include <QMutex>
+#include <QCache>
+
+#include <SkTypeface.h>
+
+namespace OsmAnd {
+
+    namespace {
+
+        struct Key
+        {
+            QString text;
+            uint32_t typefaceId;
+            SkScalar size;
+            bool isBold;
+
+            bool operator==(const Key& that) const
+            {
+                return
+                    typefaceId == that.typefaceId &&
+                    size == that.size &&
+                    isBold == that.isBold &&
+                    text == that.text;
+            }
+        };
+
+        uint qHash(const Key& key)
+        {
+            uint32_t sizeBits;
+            static_assert(sizeof(sizeBits) == sizeof(key.size), "SkScalar is expected to be a float");
+            std::memcpy(&sizeBits, &key.size, sizeof(sizeBits));
+
+            auto hash = ::qHash(key.text);
+            hash = hash * 31 + key.typefaceId;
+            hash = hash * 31 + sizeBits;
+            hash = hash * 31 + (key.isBold ? 1 : 0);
+            return hash;
+        }
+
+        enum {
+            DefaultCapacity = 256 * 1024,
+        };
+
+        struct Storage
+        {
+            Storage();
+
+            QMutex mutex;
+            QCache< Key, std::shared_ptr<const ShapedTextsCache::ShapedText> > cache;
+        };
+
+        Storage storage;
+
+        Storage::Storage()
+            : cache(DefaultCapacity)
+        {
+        }
+
+    } // namespace
+
+} // namespace OsmAnd
+
+OsmAnd::ShapedTextsCache::ShapedTextsCache()
+{
+}
+
+std::shared_ptr<const OsmAnd::ShapedTextsCache::ShapedText> OsmAnd::ShapedTextsCache::obtain( const SkPaint& paint, const QString& text )
+{
+    Key key;
+    key.text = text;
+    key.typefaceId = SkTypeface::UniqueID(paint.getTypeface());
+    key.size = paint.getTextSize();
+    key.isBold = paint.isFakeBoldText();
+
+    {
+        QMutexLocker scopeLock(&storage.mutex);
+
+        const auto pCached = storage.cache.object(key);
+        if(pCached)
+            return *pCached;
+    }
+
+    // Shaping is done outside of lock, so that contexts do not wait for each other. If same text
+    // is shaped concurrently by several contexts, only one of results gets into the cache.
+    const std::shared_ptr<ShapedText> shapedText(new ShapedText());
+    SkPaint shapingPaint(paint);
+    shapingPaint.setTextEncoding(SkPaint::kUTF16_TextEncoding);
+    const auto textLength = text.length() * sizeof(QChar);
+    const auto glyphsCount = shapingPaint.textToGlyphs(text.constData(), textLength, nullptr);
+    shapedText->glyphs.resize(glyphsCount);
+    shapingPaint.textToGlyphs(text.constData(), textLength, shapedText->glyphs.data());
+
+    shapingPaint.setTextEncoding(SkPaint::kGlyphID_TextEncoding);
+    const auto glyphsLength = glyphsCount * sizeof(uint16_t);
+    shapedText->advances.resize(glyphsCount);
+    shapedText->glyphsBounds.resize(glyphsCount);
+    shapingPaint.getTextWidths(shapedText->glyphs.constData(), glyphsLength, shapedText->advances.data(), shapedText->glyphsBounds.data());
+    shapedText->width = 0;
+    shapedText->bounds.setEmpty();
+    for(auto glyphIdx = 0; glyphIdx < glyphsCount; glyphIdx++)
+    {
+        auto glyphBounds = shapedText->glyphsBounds[glyphIdx];
+        glyphBounds.offset(shapedText->width, 0);
+        shapedText->bounds.join(glyphBounds);
+        shapedText->width += shapedText->advances[glyphIdx];
+    }
+
+    {
+        QMutexLocker scopeLock(&storage.mutex);
+
+        const auto pCached = storage.cache.object(key);
+        if(pCached)
+            return *pCached;
+        storage.cache.insert(key, new std::shared_ptr<const ShapedText>(shapedText), qMax(glyphsCount, 1));
+    }
+
+    return shapedText;
+}
+
+uint32_t OsmAnd::ShapedTextsCache::getCapacity()
+{
+    QMutexLocker scopeLock(&storage.mutex);
+
+    return static_cast<uint32_t>(storage.cache.maxCost());
+}
+
+void OsmAnd::ShapedTextsCache::setCapacity( const uint32_t capacity )
+{
+    QMutexLocker scopeLock(&storage.mutex);
+
+    storage.cache.setMaxCost(static_cast<int>(capacity));
+}
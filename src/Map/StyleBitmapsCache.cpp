@@ -0,0 +1,251 @@
+#include "StyleBitmapsCache.h"
+
+#include <cstring>
+
+#include <QMutex>
+#include <QHash>
+#include <QList>
+#include <QByteArray>
+
+#include <SkBitmap.h>
+#include <SkCanvas.h>
+#include <SkDevice.h>
+#include <SkImageDecoder.h>
+
+#include "EmbeddedResources.h"
+#include "Logging.h"
+
+namespace OsmAnd {
+
+    namespace {
+
+        struct Key
+        {
+            StyleBitmapsCache::Kind kind;
+            QString name;
+            float densityFactor;
+
+            bool operator==(const Key& that) const
+            {
+                return
+                    kind == that.kind &&
+                    densityFactor == that.densityFactor &&
+                    name == that.name;
+            }
+        };
+
+        uint qHash(const Key& key)
+        {
+            uint32_t densityFactorBits;
+            static_assert(sizeof(densityFactorBits) == sizeof(key.densityFactor), "float is expected to be 32-bit");
+            std::memcpy(&densityFactorBits, &key.densityFactor, sizeof(densityFactorBits));
+
+            auto hash = ::qHash(key.name);
+            hash = hash * 31 + static_cast<uint>(key.kind);
+            hash = hash * 31 + densityFactorBits;
+            return hash;
+        }
+
+        enum {
+            // Transparent gap between bitmaps in atlas, so that filtering never picks pixels of a neighbour
+            AtlasPadding = 1,
+        };
+
+        // Bitmaps are packed into atlas on shelves: rows of bitmaps that are filled from left to right,
+        // and a new row is started below the tallest bitmap of current one
+        struct Atlas
+        {
+            Atlas();
+
+            SkBitmap bitmap;
+            int shelfTop;
+            int shelfHeight;
+            int shelfFilledWidth;
+
+            bool allocate(const int width, const int height, int& outX, int& outY);
+        };
+
+        struct Storage
+        {
+            QMutex mutex;
+            QHash< Key, std::shared_ptr<const SkBitmap> > bitmaps;
+            QList< std::shared_ptr<Atlas> > atlases;
+
+            std::shared_ptr<const SkBitmap> pack(const SkBitmap& bitmap);
+        };
+
+        Storage storage;
+
+        Atlas::Atlas()
+            : shelfTop(0)
+            , shelfHeight(0)
+            , shelfFilledWidth(0)
+        {
+        }
+
+        bool Atlas::allocate( const int width, const int height, int& outX, int& outY )
+        {
+            if(shelfFilledWidth + width <= StyleBitmapsCache::AtlasSize && shelfTop + qMax(shelfHeight, height) <= StyleBitmapsCache::AtlasSize)
+            {
+                outX = shelfFilledWidth;
+                outY = shelfTop;
+                shelfFilledWidth += width;
+                shelfHeight = qMax(shelfHeight, height);
+                return true;
+            }
+
+            if(width <= StyleBitmapsCache::AtlasSize && shelfTop + shelfHeight + height <= StyleBitmapsCache::AtlasSize)
+            {
+                shelfTop += shelfHeight;
+                shelfHeight = height;
+                shelfFilledWidth = width;
+                outX = 0;
+                outY = shelfTop;
+                return true;
+            }
+
+            return false;
+        }
+
+        std::shared_ptr<const SkBitmap> Storage::pack( const SkBitmap& bitmap )
+        {
+            const auto width = bitmap.width();
+            const auto height = bitmap.height();
+            if(width > StyleBitmapsCache::AtlasedBitmapMaxSize || height > StyleBitmapsCache::AtlasedBitmapMaxSize)
+                return std::shared_ptr<const SkBitmap>(new SkBitmap(bitmap));
+
+            // Only last atlas is filled, previous ones are considered full
+            int x, y;
+            if(atlases.isEmpty() || !atlases.last()->allocate(width + AtlasPadding, height + AtlasPadding, x, y))
+            {
+                std::shared_ptr<Atlas> atlas(new Atlas());
+                atlas->bitmap.setConfig(SkBitmap::kARGB_8888_Config, StyleBitmapsCache::AtlasSize, StyleBitmapsCache::AtlasSize);
+                if(!atlas->bitmap.allocPixels())
+                {
+                    LogPrintf(LogSeverityLevel::Error, "Failed to allocate %dx%d atlas bitmap\n", StyleBitmapsCache::AtlasSize, StyleBitmapsCache::AtlasSize);
+                    return std::shared_ptr<const SkBitmap>(new SkBitmap(bitmap));
+                }
+                atlas->bitmap.eraseColor(SK_ColorTRANSPARENT);
+                atlas->allocate(width + AtlasPadding, height + AtlasPadding, x, y);
+                atlases.push_back(atlas);
+            }
+            const auto& atlas = atlases.last();
+
+            {
+                SkDevice target(atlas->bitmap);
+                SkCanvas canvas(&target);
+
+                SkPaint paint;
+                paint.setXfermodeMode(SkXfermode::kSrc_Mode);
+                canvas.drawBitmap(bitmap, static_cast<SkScalar>(x), static_cast<SkScalar>(y), &paint);
+            }
+
+            // Subset shares pixels of the atlas, so atlas memory is released only when last subset is gone
+            std::shared_ptr<SkBitmap> subset(new SkBitmap());
+            if(!atlas->bitmap.extractSubset(subset.get(), SkIRect::MakeXYWH(x, y, width, height)))
+                return std::shared_ptr<const SkBitmap>(new SkBitmap(bitmap));
+            return subset;
+        }
+
+        QString obtainResourceId(const StyleBitmapsCache::Kind kind, const QString& name)
+        {
+            switch(kind)
+            {
+            case StyleBitmapsCache::Kind::Icon:
+                return QString::fromLatin1("map/icons/%1.png").arg(name);
+            case StyleBitmapsCache::Kind::Shader:
+                return QString::fromLatin1("map/shaders/%1.png").arg(name);
+            case StyleBitmapsCache::Kind::Shield:
+                return QString::fromLatin1("map/shields/%1.png").arg(name);
+            }
+            return QString();
+        }
+
+        bool decodeResource(const QString& resourceId, const float densityFactor, SkBitmap& outBitmap)
+        {
+            if(!EmbeddedResources::containsResource(resourceId))
+                return false;
+
+            const auto data = EmbeddedResources::decompressResource(resourceId);
+            SkBitmap decodedBitmap;
+            if(!SkImageDecoder::DecodeMemory(data.constData(), data.size(), &decodedBitmap, SkBitmap::kARGB_8888_Config, SkImageDecoder::kDecodePixels_Mode))
+            {
+                LogPrintf(LogSeverityLevel::Error, "Failed to decode '%s'\n", qPrintable(resourceId));
+                return false;
+            }
+
+            const auto width = qMax(1, qRound(decodedBitmap.width() * densityFactor));
+            const auto height = qMax(1, qRound(decodedBitmap.height() * densityFactor));
+            if(width == decodedBitmap.width() && height == decodedBitmap.height())
+            {
+                outBitmap = decodedBitmap;
+                return true;
+            }
+
+            outBitmap.setConfig(SkBitmap::kARGB_8888_Config, width, height);
+            if(!outBitmap.allocPixels())
+            {
+                LogPrintf(LogSeverityLevel::Error, "Failed to allocate %dx%d bitmap for '%s'\n", width, height, qPrintable(resourceId));
+                return false;
+            }
+            outBitmap.eraseColor(SK_ColorTRANSPARENT);
+            {
+                SkDevice target(outBitmap);
+                SkCanvas canvas(&target);
+
+                SkPaint paint;
+                paint.setFilterBitmap(true);
+                canvas.drawBitmapRect(decodedBitmap, nullptr, SkRect::MakeWH(static_cast<SkScalar>(width), static_cast<SkScalar>(height)), &paint);
+            }
+            return true;
+        }
+
+    } // namespace
+
+} // namespace OsmAnd
+
+OsmAnd::StyleBitmapsCache::StyleBitmapsCache()
+{
+}
+
+std::shared_ptr<const SkBitmap> OsmAnd::StyleBitmapsCache::obtain( const Kind kind, const QString& name, const float densityFactor )
+{
+    Key key;
+    key.kind = kind;
+    key.name = name;
+    key.densityFactor = densityFactor;
+
+    {
+        QMutexLocker scopeLock(&storage.mutex);
+
+        const auto itBitmap = storage.bitmaps.constFind(key);
+        if(itBitmap != storage.bitmaps.cend())
+            return *itBitmap;
+    }
+
+    // Decoding is done outside of lock, only packing into atlas is serialized
+    SkBitmap bitmap;
+    const auto decoded = decodeResource(obtainResourceId(kind, name), densityFactor, bitmap);
+
+    QMutexLocker scopeLock(&storage.mutex);
+
+    const auto itBitmap = storage.bitmaps.constFind(key);
+    if(itBitmap != storage.bitmaps.cend())
+        return *itBitmap;
+
+    std::shared_ptr<const SkBitmap> cachedBitmap;
+    if(decoded)
+        cachedBitmap = storage.pack(bitmap);
+    else
+        LogPrintf(LogSeverityLevel::Warning, "Style bitmap '%s' is not available\n", qPrintable(name));
+    storage.bitmaps.insert(key, cachedBitmap);
+    return cachedBitmap;
+}
+
+void OsmAnd::StyleBitmapsCache::clear()
+{
+    QMutexLocker scopeLock(&storage.mutex);
+
+    storage.bitmaps.clear();
+    storage.atlases.clear();
+}
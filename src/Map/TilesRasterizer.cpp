@@ -0,0 +1,278 @@
+#include "TilesRasterizer.h"
+
+#include <assert.h>
+#include <tuple>
+
+#include <QThread>
+#include <QThreadPool>
+#include <QWaitCondition>
+
+#include <SkBitmap.h>
+#include <SkCanvas.h>
+#include <SkDevice.h>
+
+#include "Concurrent.h"
+#include "MapDataCache.h"
+#include "Rasterizer.h"
+#include "RasterizerContext.h"
+#include "RasterizerGeometriesCache.h"
+#include "OsmAndCore/Logging.h"
+
+OsmAnd::TilesRasterizer::TilesRasterizer(
+    const std::shared_ptr<RasterizationStyle>& style_,
+    const std::shared_ptr<MapDataCache>& dataCache_,
+    const QMap< std::shared_ptr<RasterizationStyle::ValueDefinition>, RasterizationRule::Value >& styleInitialSettings_ /*= QMap()*/,
+    QThreadPool* threadPool /*= nullptr*/ )
+    : _ownThreadPool(threadPool ? nullptr : new QThreadPool())
+    , _threadPool(threadPool ? threadPool : _ownThreadPool.get())
+    , _geometriesCache(new RasterizerGeometriesCache())
+    , style(style_)
+    , dataCache(dataCache_)
+    , styleInitialSettings(styleInitialSettings_)
+{
+    assert(style);
+    assert(dataCache);
+
+    if(_ownThreadPool)
+        _ownThreadPool->setMaxThreadCount(QThread::idealThreadCount());
+}
+
+OsmAnd::TilesRasterizer::~TilesRasterizer()
+{
+    if(_ownThreadPool)
+        _ownThreadPool->waitForDone();
+}
+
+std::shared_ptr<OsmAnd::RasterizerContext> OsmAnd::TilesRasterizer::obtainContext()
+{
+    {
+        QMutexLocker scopeLock(&_contextsMutex);
+
+        if(!_freeContexts.isEmpty())
+            return _freeContexts.takeLast();
+    }
+
+    // Contexts are never destroyed until rasterizer is, so their count is bound by maximal
+    // number of tiles that were rasterized at the same time
+    return std::shared_ptr<RasterizerContext>(new RasterizerContext(style, styleInitialSettings, _geometriesCache));
+}
+
+void OsmAnd::TilesRasterizer::releaseContext( const std::shared_ptr<RasterizerContext>& context )
+{
+    QMutexLocker scopeLock(&_contextsMutex);
+
+    _freeContexts.push_back(context);
+}
+
+OsmAnd::AreaI OsmAnd::TilesRasterizer::getTileArea31( const TileId& tileId, uint32_t zoom )
+{
+    const auto tileShift = 31 - zoom;
+
+    AreaI area31;
+    area31.left = static_cast<int32_t>(static_cast<uint32_t>(tileId.x) << tileShift);
+    area31.top = static_cast<int32_t>(static_cast<uint32_t>(tileId.y) << tileShift);
+    area31.right = static_cast<int32_t>((static_cast<uint32_t>(tileId.x + 1) << tileShift) - 1);
+    area31.bottom = static_cast<int32_t>((static_cast<uint32_t>(tileId.y + 1) << tileShift) - 1);
+    return area31;
+}
+
+bool OsmAnd::TilesRasterizer::rasterizeArea( const AreaI& area31, uint32_t zoom, uint32_t tileSize, float densityFactor, uint32_t width, uint32_t height, std::shared_ptr<SkBitmap>& outBitmap, IQueryController* controller )
+{
+    QList< std::shared_ptr<OsmAnd::Model::MapObject> > mapObjects;
+    dataCache->obtainObjects(mapObjects, area31, zoom, controller);
+    if(controller && controller->isAborted())
+        return false;
+
+    const auto context = obtainContext();
+
+    bool nothingToRender = false;
+    Rasterizer::update(*context, area31, zoom, tileSize, densityFactor, &mapObjects, PointF(), &nothingToRender, controller);
+    if(controller && controller->isAborted())
+    {
+        releaseContext(context);
+        return false;
+    }
+
+    std::shared_ptr<SkBitmap> bitmap(new SkBitmap());
+    bitmap->setConfig(SkBitmap::kARGB_8888_Config, width, height);
+    if(!bitmap->allocPixels())
+    {
+        LogPrintf(LogSeverityLevel::Error, "Failed to allocate %dx%d bitmap\n", width, height);
+        releaseContext(context);
+        return false;
+    }
+
+    {
+        SkDevice target(*bitmap);
+        SkCanvas canvas(&target);
+
+        Rasterizer::rasterizeMap(*context, true, canvas, controller);
+        if(!controller || !controller->isAborted())
+            Rasterizer::rasterizeText(*context, false, canvas, controller);
+    }
+    releaseContext(context);
+
+    if(controller && controller->isAborted())
+        return false;
+
+    outBitmap = bitmap;
+    return true;
+}
+
+bool OsmAnd::TilesRasterizer::rasterize( const Tile& tile, std::shared_ptr<SkBitmap>& outBitmap, IQueryController* controller /*= nullptr*/ )
+{
+    assert(tile.zoom <= 31);
+
+    return rasterizeArea(getTileArea31(tile.tileId, tile.zoom), tile.zoom, tile.tileSize, tile.densityFactor, tile.tileSize, tile.tileSize, outBitmap, controller);
+}
+
+bool OsmAnd::TilesRasterizer::rasterizeMetatile( const Tile& originTile, uint32_t metatileSize, QMap< TileId, std::shared_ptr<SkBitmap> >& outBitmaps, IQueryController* controller /*= nullptr*/ )
+{
+    assert(originTile.zoom <= 31);
+    assert(metatileSize > 0);
+
+    const auto tilesPerSide = static_cast<int64_t>(1) << originTile.zoom;
+    const auto columns = static_cast<uint32_t>(qMin<int64_t>(metatileSize, tilesPerSide - originTile.tileId.x));
+    const auto rows = static_cast<uint32_t>(qMin<int64_t>(metatileSize, tilesPerSide - originTile.tileId.y));
+    if(columns == 0 || rows == 0)
+        return false;
+
+    TileId bottomRightTileId;
+    bottomRightTileId.x = originTile.tileId.x + columns - 1;
+    bottomRightTileId.y = originTile.tileId.y + rows - 1;
+    const AreaI area31(
+        getTileArea31(originTile.tileId, originTile.zoom).topLeft,
+        getTileArea31(bottomRightTileId, originTile.zoom).bottomRight);
+
+    std::shared_ptr<SkBitmap> metatileBitmap;
+    if(!rasterizeArea(area31, originTile.zoom, originTile.tileSize, originTile.densityFactor, columns * originTile.tileSize, rows * originTile.tileSize, metatileBitmap, controller))
+        return false;
+
+    // Slice metatile into tiles. Each tile gets own copy of pixels, so that it does not keep entire metatile alive
+    for(auto row = 0u; row < rows; row++)
+    {
+        for(auto column = 0u; column < columns; column++)
+        {
+            const auto subset = SkIRect::MakeXYWH(column * originTile.tileSize, row * originTile.tileSize, originTile.tileSize, originTile.tileSize);
+
+            SkBitmap subsetBitmap;
+            std::shared_ptr<SkBitmap> tileBitmap(new SkBitmap());
+            if(!metatileBitmap->extractSubset(&subsetBitmap, subset) || !subsetBitmap.copyTo(tileBitmap.get(), SkBitmap::kARGB_8888_Config))
+            {
+                LogPrintf(LogSeverityLevel::Error, "Failed to slice tile %dx%d from metatile\n", originTile.tileId.x + column, originTile.tileId.y + row);
+                return false;
+            }
+
+            TileId tileId;
+            tileId.x = originTile.tileId.x + column;
+            tileId.y = originTile.tileId.y + row;
+            outBitmaps.insert(tileId, tileBitmap);
+        }
+    }
+
+    return true;
+}
+
+void OsmAnd::TilesRasterizer::rasterize( const QList<Tile>& tiles, TileRasterizedCallback callback, IQueryController* controller /*= nullptr*/, uint32_t metatileSize /*= 1*/ )
+{
+    assert(callback != nullptr);
+    assert(metatileSize > 0);
+
+    if(tiles.isEmpty())
+        return;
+
+    struct Metatile
+    {
+        TileId id;
+        QList<Tile> tiles;
+    };
+
+    // Group tiles by aligned metatile they belong to. Tiles of different size or density are never grouped together.
+    // Tile that is requested several times is rasterized once, but it's reported to callback for each request.
+    typedef std::tuple<uint32_t, uint32_t, float, uint64_t> MetatileKey;
+    QMap< MetatileKey, Metatile > metatiles;
+    for(auto itTile = tiles.begin(); itTile != tiles.end(); ++itTile)
+    {
+        const auto& tile = *itTile;
+
+        TileId metatileId;
+        metatileId.x = tile.tileId.x - (tile.tileId.x % metatileSize);
+        metatileId.y = tile.tileId.y - (tile.tileId.y % metatileSize);
+        auto& metatile = metatiles[MetatileKey(tile.zoom, tile.tileSize, tile.densityFactor, metatileId.id)];
+        metatile.id = metatileId;
+        metatile.tiles.push_back(tile);
+    }
+
+    // Metatiles are taken from shared queue both by workers and by calling thread, so batch completes even if
+    // it was started from a worker of the same pool while all other workers are busy. Workers that start after
+    // queue is empty exit right away, so state they refer to is shared rather than kept on this stack.
+    struct Batch
+    {
+        QMutex mutex;
+        QWaitCondition metatilesProcessed;
+        QList<Metatile> pendingMetatiles;
+        int processingMetatilesCount;
+    };
+    const std::shared_ptr<Batch> batch(new Batch());
+    batch->pendingMetatiles = metatiles.values();
+    batch->processingMetatilesCount = 0;
+
+    const auto processMetatile = [this, metatileSize, callback, controller](const Metatile& metatile)
+    {
+        std::shared_ptr<SkBitmap> singleBitmap;
+        QMap< TileId, std::shared_ptr<SkBitmap> > bitmaps;
+        bool success = (!controller || !controller->isAborted());
+        if(success && metatileSize == 1)
+            success = rasterize(metatile.tiles.first(), singleBitmap, controller);
+        else if(success)
+        {
+            auto originTile = metatile.tiles.first();
+            originTile.tileId = metatile.id;
+            success = rasterizeMetatile(originTile, metatileSize, bitmaps, controller);
+        }
+
+        for(auto itTile = metatile.tiles.cbegin(); itTile != metatile.tiles.cend(); ++itTile)
+        {
+            const auto& tile = *itTile;
+
+            const auto& bitmap = (metatileSize == 1) ? singleBitmap : bitmaps.value(tile.tileId);
+            callback(tile, bitmap, success && bitmap);
+        }
+    };
+    const auto processPendingMetatiles = [batch, processMetatile]()
+    {
+        for(;;)
+        {
+            Metatile metatile;
+            {
+                QMutexLocker scopeLock(&batch->mutex);
+                if(batch->pendingMetatiles.isEmpty())
+                    return;
+                metatile = batch->pendingMetatiles.takeFirst();
+                batch->processingMetatilesCount++;
+            }
+
+            processMetatile(metatile);
+
+            QMutexLocker scopeLock(&batch->mutex);
+            if(--batch->processingMetatilesCount == 0 && batch->pendingMetatiles.isEmpty())
+                batch->metatilesProcessed.wakeAll();
+        }
+    };
+
+    const auto workersCount = qMin(metatiles.size() - 1, _threadPool->maxThreadCount());
+    for(auto workerIdx = 0; workerIdx < workersCount; workerIdx++)
+    {
+        _threadPool->start(new Concurrent::Task(
+            [processPendingMetatiles](const Concurrent::Task* task, QEventLoop& eventLoop)
+            {
+                processPendingMetatiles();
+            }));
+    }
+    processPendingMetatiles();
+
+    // Only metatiles that are already taken by running workers are waited for
+    QMutexLocker scopeLock(&batch->mutex);
+    while(batch->processingMetatilesCount > 0)
+        batch->metatilesProcessed.wait(&batch->mutex);
+}
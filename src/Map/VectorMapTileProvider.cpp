@@ -0,0 +1,352 @@
+#include "VectorMapTileProvider.h"
+
+#include <assert.h>
+
+#include <QThread>
+#include <QThreadPool>
+
+#include <SkBitmap.h>
+
+#include "Concurrent.h"
+#include "MapDataCache.h"
+#include "TilesRasterizer.h"
+#include "OsmAndCore/Logging.h"
+
+namespace OsmAnd {
+
+    namespace {
+
+        class FunctorQueryController : public IQueryController
+        {
+        public:
+            FunctorQueryController(const std::function<bool ()>& isAbortedFunctor)
+                : _isAbortedFunctor(isAbortedFunctor)
+            {
+            }
+
+            virtual bool isAborted()
+            {
+                return _isAbortedFunctor();
+            }
+        private:
+            const std::function<bool ()> _isAbortedFunctor;
+        };
+
+    } // namespace
+
+} // namespace OsmAnd
+
+OsmAnd::VectorMapTileProvider::VectorMapTileProvider(
+    const std::shared_ptr<RasterizationStyle>& style,
+    const std::shared_ptr<MapDataCache>& dataCache_,
+    const QMap< std::shared_ptr<RasterizationStyle::ValueDefinition>, RasterizationRule::Value >& styleInitialSettings /*= QMap()*/,
+    uint32_t tileSize_ /*= 256*/,
+    float densityFactor_ /*= 1.0f*/,
+    size_t bitmapsCacheMemoryLimit /*= 64 * 1024 * 1024*/ )
+    : _rasterizationPool(new QThreadPool())
+    , _rasterizer(new TilesRasterizer(style, dataCache_, styleInitialSettings, _rasterizationPool.get()))
+    , _lastInterestTime(0)
+    , _lastInterestZoom(0)
+    , _tasksCount(0)
+    , _isDestroying(false)
+    , _bitmapsCache(static_cast<int>(qMax<size_t>(bitmapsCacheMemoryLimit / 1024, 1)))
+    , dataCache(dataCache_)
+    , tileSize(tileSize_)
+    , densityFactor(densityFactor_)
+{
+    _rasterizationPool->setMaxThreadCount(QThread::idealThreadCount());
+    _interestTimer.start();
+}
+
+OsmAnd::VectorMapTileProvider::~VectorMapTileProvider()
+{
+    // Tasks that are already enqueued refer to this provider, so wait until all of them are gone
+    QMutexLocker scopeLock(&_requestsMutex);
+    _isDestroying = true;
+    while(_tasksCount > 0)
+        _tasksFinishedCondition.wait(&_requestsMutex);
+}
+
+float OsmAnd::VectorMapTileProvider::getTileDensity() const
+{
+    return densityFactor;
+}
+
+uint32_t OsmAnd::VectorMapTileProvider::getTileSize() const
+{
+    return tileSize;
+}
+
+bool OsmAnd::VectorMapTileProvider::obtainTileImmediate( const TileId& tileId, uint32_t zoom, std::shared_ptr<IMapTileProvider::Tile>& tile )
+{
+    assert(zoom < _requests.size());
+    if(zoom >= _requests.size())
+        return false;
+
+    // Renderer asks for every visible tile it does not have yet, so that's what keeps requests of visible tiles fresh
+    {
+        QMutexLocker scopeLock(&_requestsMutex);
+
+        _lastInterestTime = _interestTimer.elapsed();
+        _lastInterestZoom = zoom;
+
+        const auto itRequest = _requests[zoom].constFind(tileId);
+        if(itRequest != _requests[zoom].cend())
+            registerInterest(*itRequest);
+    }
+
+    const auto bitmap = obtainCachedBitmap(tileId, zoom);
+    if(!bitmap)
+        return false;
+
+    tile.reset(new Tile(bitmap));
+    return true;
+}
+
+void OsmAnd::VectorMapTileProvider::obtainTileDeffered( const TileId& tileId, uint32_t zoom, TileReadyCallback readyCallback )
+{
+    assert(readyCallback != nullptr);
+    assert(zoom < _requests.size());
+    if(zoom >= _requests.size())
+    {
+        readyCallback(tileId, zoom, std::shared_ptr<IMapTileProvider::Tile>(), false);
+        return;
+    }
+
+    QMutexLocker scopeLock(&_requestsMutex);
+
+    // Duplicate request is served together with the one that is already in progress
+    const auto itRequest = _requests[zoom].constFind(tileId);
+    if(itRequest != _requests[zoom].cend())
+    {
+        const auto& request = *itRequest;
+
+        request->callbacks.push_back(readyCallback);
+        registerInterest(request);
+        return;
+    }
+
+    std::shared_ptr<TileRequest> request(new TileRequest());
+    request->tileId = tileId;
+    request->zoom = zoom;
+    request->state = RequestState::Processing;
+    request->isDataLoaded = false;
+    request->callbacks.push_back(readyCallback);
+    _requests[zoom].insert(tileId, request);
+
+    registerInterest(request);
+    schedule(request);
+}
+
+void OsmAnd::VectorMapTileProvider::registerInterest( const std::shared_ptr<TileRequest>& request )
+{
+    const auto now = _interestTimer.elapsed();
+    request->lastInterestTime = now;
+    _lastInterestTime = now;
+    _lastInterestZoom = request->zoom;
+
+    if(request->state == RequestState::Postponed)
+        schedule(request);
+}
+
+void OsmAnd::VectorMapTileProvider::schedule( const std::shared_ptr<TileRequest>& request )
+{
+    // Each task takes most recently requested tile at the moment it starts, rather than one it was enqueued for
+    _tasksCount++;
+    if(request->isDataLoaded)
+    {
+        request->state = RequestState::PendingRasterization;
+        _pendingRasterization.push_back(request);
+        _rasterizationPool->start(new Concurrent::Task(
+            [this](const Concurrent::Task* task, QEventLoop& eventLoop)
+            {
+                processRasterization();
+            }));
+    }
+    else
+    {
+        request->state = RequestState::PendingDataLoading;
+        _pendingDataLoading.push_back(request);
+        Concurrent::instance()->localStoragePool->start(new Concurrent::Task(
+            [this](const Concurrent::Task* task, QEventLoop& eventLoop)
+            {
+                processDataLoading();
+            }));
+    }
+}
+
+bool OsmAnd::VectorMapTileProvider::isStale( const TileRequest& request ) const
+{
+    return request.zoom != _lastInterestZoom || request.lastInterestTime < _lastInterestTime - StaleRequestTimeout;
+}
+
+std::shared_ptr<OsmAnd::VectorMapTileProvider::TileRequest> OsmAnd::VectorMapTileProvider::takeNextRequest( QList< std::shared_ptr<TileRequest> >& pendingRequests )
+{
+    std::shared_ptr<TileRequest> nextRequest;
+    for(auto itRequest = pendingRequests.begin(); itRequest != pendingRequests.end();)
+    {
+        const auto& request = *itRequest;
+
+        if(isStale(*request))
+        {
+            request->state = RequestState::Postponed;
+            itRequest = pendingRequests.erase(itRequest);
+            continue;
+        }
+
+        if(!nextRequest || request->lastInterestTime > nextRequest->lastInterestTime)
+            nextRequest = request;
+        ++itRequest;
+    }
+
+    if(nextRequest)
+    {
+        pendingRequests.removeOne(nextRequest);
+        nextRequest->state = RequestState::Processing;
+    }
+    return nextRequest;
+}
+
+void OsmAnd::VectorMapTileProvider::processDataLoading()
+{
+    std::shared_ptr<TileRequest> request;
+    {
+        QMutexLocker scopeLock(&_requestsMutex);
+        if(!_isDestroying)
+            request = takeNextRequest(_pendingDataLoading);
+    }
+
+    if(request)
+    {
+        // Tile may have been rasterized for previous request of it since this one was made
+        const auto bitmap = obtainCachedBitmap(request->tileId, request->zoom);
+        if(bitmap)
+        {
+            completeRequest(request, bitmap, true);
+        }
+        else
+        {
+            FunctorQueryController controller([this]() -> bool
+            {
+                return _isDestroying;
+            });
+            dataCache->cacheObjects(TilesRasterizer::getTileArea31(request->tileId, request->zoom), request->zoom, &controller);
+
+            QMutexLocker scopeLock(&_requestsMutex);
+            request->isDataLoaded = true;
+            if(!_isDestroying)
+                schedule(request);
+        }
+    }
+
+    finishTask();
+}
+
+void OsmAnd::VectorMapTileProvider::processRasterization()
+{
+    std::shared_ptr<TileRequest> request;
+    {
+        QMutexLocker scopeLock(&_requestsMutex);
+        if(!_isDestroying)
+            request = takeNextRequest(_pendingRasterization);
+    }
+
+    if(request)
+    {
+        // Rasterization is aborted if zoom has changed, and tile is rasterized again on next interest in it
+        const auto zoom = request->zoom;
+        FunctorQueryController controller([this, zoom]() -> bool
+        {
+            return _isDestroying || _lastInterestZoom != zoom;
+        });
+
+        TilesRasterizer::Tile tile;
+        tile.tileId = request->tileId;
+        tile.zoom = request->zoom;
+        tile.tileSize = tileSize;
+        tile.densityFactor = densityFactor;
+
+        std::shared_ptr<SkBitmap> bitmap;
+        if(_rasterizer->rasterize(tile, bitmap, &controller))
+        {
+            {
+                QMutexLocker scopeLock(&_bitmapsCacheMutex);
+
+                CachedBitmapKey key;
+                key.tileId = request->tileId;
+                key.zoom = request->zoom;
+                const auto cost = static_cast<int>(qMax<size_t>(bitmap->getSize() / 1024, 1));
+                _bitmapsCache.insert(key, new std::shared_ptr<SkBitmap>(bitmap), cost);
+            }
+
+            completeRequest(request, bitmap, true);
+        }
+        else if(controller.isAborted())
+        {
+            QMutexLocker scopeLock(&_requestsMutex);
+            if(_isDestroying || isStale(*request))
+                request->state = RequestState::Postponed;
+            else
+                schedule(request);
+        }
+        else
+        {
+            LogPrintf(LogSeverityLevel::Error, "Failed to rasterize tile %dx%d@%d\n", request->tileId.x, request->tileId.y, request->zoom);
+            completeRequest(request, std::shared_ptr<SkBitmap>(), false);
+        }
+    }
+
+    finishTask();
+}
+
+void OsmAnd::VectorMapTileProvider::completeRequest( const std::shared_ptr<TileRequest>& request, const std::shared_ptr<SkBitmap>& bitmap, bool success )
+{
+    QList<TileReadyCallback> callbacks;
+    {
+        QMutexLocker scopeLock(&_requestsMutex);
+
+        _requests[request->zoom].remove(request->tileId);
+        callbacks = request->callbacks;
+    }
+
+    std::shared_ptr<IMapTileProvider::Tile> tile;
+    if(bitmap)
+        tile.reset(new Tile(bitmap));
+    for(auto itCallback = callbacks.begin(); itCallback != callbacks.end(); ++itCallback)
+    {
+        const auto& callback = *itCallback;
+
+        callback(request->tileId, request->zoom, tile, success);
+    }
+}
+
+void OsmAnd::VectorMapTileProvider::finishTask()
+{
+    QMutexLocker scopeLock(&_requestsMutex);
+
+    if(--_tasksCount == 0)
+        _tasksFinishedCondition.wakeAll();
+}
+
+std::shared_ptr<SkBitmap> OsmAnd::VectorMapTileProvider::obtainCachedBitmap( const TileId& tileId, uint32_t zoom )
+{
+    QMutexLocker scopeLock(&_bitmapsCacheMutex);
+
+    CachedBitmapKey key;
+    key.tileId = tileId;
+    key.zoom = zoom;
+    const auto pBitmap = _bitmapsCache.object(key);
+    if(!pBitmap)
+        return std::shared_ptr<SkBitmap>();
+    return *pBitmap;
+}
+
+OsmAnd::VectorMapTileProvider::Tile::Tile( const std::shared_ptr<SkBitmap>& bitmap )
+    : IMapBitmapTileProvider::Tile(bitmap->getPixels(), bitmap->rowBytes(), bitmap->width(), bitmap->height(), IMapBitmapTileProvider::RGBA_8888)
+    , _bitmap(bitmap)
+{
+}
+
+OsmAnd::VectorMapTileProvider::Tile::~Tile()
+{
+}
@@ -16,7 +16,8 @@ const QMultiHash< QString, QString >& OsmAnd::PoiDirectory::getPoiCategories(Poi
     for(auto itSource = context->sources.cbegin(); itSource != context->sources.cend(); ++itSource)
     {
         auto source = *itSource;
-        
+        source->ensureSectionsRead(ObfReader::SectionType::Poi);
+
         for(auto itPoiSection = source->poiSections.begin(); itPoiSection != source->poiSections.end(); ++itPoiSection)
         {
             const auto& poiSection = *itPoiSection;
@@ -74,7 +75,8 @@ void OsmAnd::PoiDirectory::queryPoiAmenities(
     for(auto itSource = context->sources.cbegin(); itSource != context->sources.cend(); ++itSource)
     {
         auto source = *itSource;
-        
+        source->ensureSectionsRead(ObfReader::SectionType::Poi);
+
         for(auto itPoiSection = source->poiSections.cbegin(); itPoiSection != source->poiSections.cend(); ++itPoiSection)
         {
             const auto& poiSection = *itPoiSection;
@@ -0,0 +1,96 @@
+#include "QMemoryMappedZeroCopyInputStream.h"
+
+#include <limits>
+
+namespace gpb = google::protobuf;
+
+OsmAnd::QMemoryMappedZeroCopyInputStream::QMemoryMappedZeroCopyInputStream( const std::shared_ptr<QFileDevice>& file )
+    : _mapping(new Mapping(file))
+    , _position(0)
+{
+}
+
+OsmAnd::QMemoryMappedZeroCopyInputStream::QMemoryMappedZeroCopyInputStream( const std::shared_ptr<const Mapping>& mapping )
+    : _mapping(mapping)
+    , _position(0)
+{
+}
+
+OsmAnd::QMemoryMappedZeroCopyInputStream::~QMemoryMappedZeroCopyInputStream()
+{
+}
+
+bool OsmAnd::QMemoryMappedZeroCopyInputStream::isMapped() const
+{
+    return (_mapping->data != nullptr);
+}
+
+OsmAnd::QMemoryMappedZeroCopyInputStream* OsmAnd::QMemoryMappedZeroCopyInputStream::clone() const
+{
+    return new QMemoryMappedZeroCopyInputStream(_mapping);
+}
+
+bool OsmAnd::QMemoryMappedZeroCopyInputStream::Next( const void** data, int* size )
+{
+    if(!_mapping->data || _position >= _mapping->size)
+    {
+        *size = 0;
+        return false;
+    }
+
+    // Whole remaining mapping is given out at once, limited only by protobuf's int sizes
+    const auto available = qMin<qint64>(_mapping->size - _position, std::numeric_limits<int>::max());
+    *data = _mapping->data + _position;
+    *size = static_cast<int>(available);
+    _position += available;
+    return true;
+}
+
+void OsmAnd::QMemoryMappedZeroCopyInputStream::BackUp( int count )
+{
+    // Protobuf's Seek() patch backs up further than last Next() returned, so allow any rewind
+    if (count > _position)
+        _position = 0;
+    else
+        _position -= count;
+}
+
+bool OsmAnd::QMemoryMappedZeroCopyInputStream::Skip( int count )
+{
+    if (_position + count > _mapping->size)
+    {
+        _position = _mapping->size;
+        return false;
+    }
+
+    _position += count;
+    return true;
+}
+
+gpb::int64 OsmAnd::QMemoryMappedZeroCopyInputStream::ByteCount() const
+{
+    return _position;
+}
+
+OsmAnd::QMemoryMappedZeroCopyInputStream::Mapping::Mapping( const std::shared_ptr<QFileDevice>& file_ )
+    : file(file_)
+    , closeOnDestruction(!file_->isOpen())
+    , data(nullptr)
+    , size(0)
+{
+    if(!file->isOpen())
+        file->open(QIODevice::ReadOnly);
+    assert(file->isOpen());
+
+    size = file->size();
+    if(size > 0)
+        data = file->map(0, size);
+}
+
+OsmAnd::QMemoryMappedZeroCopyInputStream::Mapping::~Mapping()
+{
+    if(data)
+        file->unmap(data);
+    if(closeOnDestruction)
+        file->close();
+}
@@ -263,7 +263,8 @@ void OsmAnd::RoutePlanner::loadTileHeader( RoutePlannerContext* context, uint32_
     for(auto itSource = context->sources.cbegin(); itSource != context->sources.cend(); ++itSource)
     {
         auto source = *itSource;
-        
+        source->ensureSectionsRead(ObfReader::SectionType::Routing);
+
         for(auto itRoutingSection = source->routingSections.cbegin(); itRoutingSection != source->routingSections.cend(); ++itRoutingSection)
         {
             auto routingSection = *itRoutingSection;
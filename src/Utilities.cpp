@@ -1,6 +1,7 @@
 #include "OsmAndCore/Utilities.h"
 
 #include <assert.h>
+#include <algorithm>
 #include <limits>
 #include <cmath>
 
@@ -434,14 +435,21 @@ OSMAND_CORE_API void OSMAND_CORE_CALL OsmAnd::Utilities::findFiles( const QDir&
 }
 
 OSMAND_CORE_API double OSMAND_CORE_CALL OsmAnd::Utilities::polygonArea( const QVector<PointI>& points )
+{
+    return polygonArea(points.constData(), points.size());
+}
+
+OSMAND_CORE_API double OSMAND_CORE_CALL OsmAnd::Utilities::polygonArea( const PointI* pPoints, const int pointsCount )
 {
     double area = 0.0;
 
-    assert(points.first() == points.last());
+    if(pointsCount == 0)
+        return area;
+    assert(pPoints[0] == pPoints[pointsCount - 1]);
 
-    auto itPrevPoint = points.begin();
+    auto itPrevPoint = pPoints;
     auto itPoint = itPrevPoint + 1;
-    for(; itPoint != points.end(); itPrevPoint = itPoint, ++itPoint)
+    for(; itPoint != pPoints + pointsCount; itPrevPoint = itPoint, ++itPoint)
     {
         const auto& p0 = *itPrevPoint;
         const auto& p1 = *itPoint;
@@ -453,6 +461,265 @@ OSMAND_CORE_API double OSMAND_CORE_CALL OsmAnd::Utilities::polygonArea( const QV
     return area;
 }
 
+OSMAND_CORE_API void OSMAND_CORE_CALL OsmAnd::Utilities::simplifyPolyline( const QVector<PointI>& points, const int64_t tolerance, QVector<PointI>& outPoints )
+{
+    if(points.size() <= 2 || tolerance <= 0)
+    {
+        outPoints = points;
+        return;
+    }
+
+    simplifyPolyline(points.constData(), points.size(), tolerance, outPoints);
+}
+
+OSMAND_CORE_API void OSMAND_CORE_CALL OsmAnd::Utilities::simplifyPolyline( const PointI* pPoints, const int pointsCount, const int64_t tolerance, QVector<PointI>& outPoints )
+{
+    // Douglas-Peucker. Coordinates are below 2^31, so all cross products and squared lengths fit 63 bits.
+    if(pointsCount <= 2 || tolerance <= 0)
+    {
+        outPoints.resize(pointsCount);
+        if(pointsCount > 0)
+            std::copy(pPoints, pPoints + pointsCount, outPoints.begin());
+        return;
+    }
+
+    QVector<bool> keep(pointsCount, false);
+    keep[0] = true;
+    keep[pointsCount - 1] = true;
+
+    QVector< std::pair<int, int> > segments;
+    segments.push_back(std::make_pair(0, pointsCount - 1));
+    const auto squaredTolerance = tolerance * tolerance;
+    while(!segments.isEmpty())
+    {
+        const auto segment = segments.last();
+        segments.pop_back();
+        const auto& p0 = pPoints[segment.first];
+        const auto& p1 = pPoints[segment.second];
+
+        const int64_t dx = static_cast<int64_t>(p1.x) - p0.x;
+        const int64_t dy = static_cast<int64_t>(p1.y) - p0.y;
+        const auto squaredLength = dx*dx + dy*dy;
+
+        // Distance to the segment is |cross| / length, so instead of dividing each cross product,
+        // it's compared with tolerance scaled by length once. Closed rings have degenerate segment,
+        // where distance to the point itself is used.
+        const auto threshold = static_cast<int64_t>(tolerance * std::sqrt(static_cast<double>(squaredLength)));
+        auto maxDistance = (squaredLength == 0) ? squaredTolerance : threshold;
+        auto farthestIdx = -1;
+        for(auto idx = segment.first + 1; idx < segment.second; idx++)
+        {
+            const auto& p = pPoints[idx];
+            const int64_t px = static_cast<int64_t>(p.x) - p0.x;
+            const int64_t py = static_cast<int64_t>(p.y) - p0.y;
+
+            int64_t distance;
+            if(squaredLength == 0)
+                distance = px*px + py*py;
+            else
+            {
+                distance = dx*py - dy*px;
+                if(distance < 0)
+                    distance = -distance;
+            }
+
+            if(distance > maxDistance)
+            {
+                maxDistance = distance;
+                farthestIdx = idx;
+            }
+        }
+
+        if(farthestIdx < 0)
+            continue;
+
+        keep[farthestIdx] = true;
+        if(farthestIdx - segment.first > 1)
+            segments.push_back(std::make_pair(segment.first, farthestIdx));
+        if(segment.second - farthestIdx > 1)
+            segments.push_back(std::make_pair(farthestIdx, segment.second));
+    }
+
+    outPoints.clear();
+    outPoints.reserve(pointsCount);
+    for(auto idx = 0; idx < pointsCount; idx++)
+    {
+        if(keep[idx])
+            outPoints.push_back(pPoints[idx]);
+    }
+}
+
+namespace OsmAnd {
+
+    enum ClipOutcode : uint32_t
+    {
+        ClipInside = 0,
+        ClipLeft = 1 << 0,
+        ClipRight = 1 << 1,
+        ClipTop = 1 << 2,
+        ClipBottom = 1 << 3,
+    };
+
+    static inline uint32_t calculateClipOutcode(const PointI& point, const AreaI& area)
+    {
+        uint32_t outcode = ClipInside;
+        if(point.x < area.left)
+            outcode |= ClipLeft;
+        else if(point.x > area.right)
+            outcode |= ClipRight;
+        if(point.y < area.top)
+            outcode |= ClipTop;
+        else if(point.y > area.bottom)
+            outcode |= ClipBottom;
+        return outcode;
+    }
+
+    // Intersection of segment with one of area edges. Differences of 31-bit coordinates are below 2^32,
+    // so products fit 64 bits
+    static inline PointI intersectClipEdge(const PointI& p0, const PointI& p1, const AreaI& area, uint32_t edge)
+    {
+        const int64_t dx = static_cast<int64_t>(p1.x) - p0.x;
+        const int64_t dy = static_cast<int64_t>(p1.y) - p0.y;
+        if(edge == ClipLeft || edge == ClipRight)
+        {
+            const int32_t x = (edge == ClipLeft) ? area.left : area.right;
+            return PointI(x, static_cast<int32_t>(p0.y + dy * (static_cast<int64_t>(x) - p0.x) / dx));
+        }
+        else
+        {
+            const int32_t y = (edge == ClipTop) ? area.top : area.bottom;
+            return PointI(static_cast<int32_t>(p0.x + dx * (static_cast<int64_t>(y) - p0.y) / dy), y);
+        }
+    }
+
+} // namespace OsmAnd
+
+OSMAND_CORE_API void OSMAND_CORE_CALL OsmAnd::Utilities::clipPolyline( const QVector<PointI>& points, const AreaI& area, QList< QVector<PointI> >& outPolylines )
+{
+    clipPolyline(points.constData(), points.size(), area, outPolylines);
+}
+
+OSMAND_CORE_API void OSMAND_CORE_CALL OsmAnd::Utilities::clipPolyline( const PointI* pPoints, const int pointsCount, const AreaI& area, QList< QVector<PointI> >& outPolylines )
+{
+    // Cohen-Sutherland, applied to each segment. Consecutive visible segments are joined into one polyline.
+    QVector<PointI> polyline;
+    for(auto idx = 1; idx < pointsCount; idx++)
+    {
+        auto p0 = pPoints[idx - 1];
+        auto p1 = pPoints[idx];
+        auto outcode0 = calculateClipOutcode(p0, area);
+        auto outcode1 = calculateClipOutcode(p1, area);
+        const auto isEndClipped = (outcode1 != ClipInside);
+
+        auto accept = false;
+        for(;;)
+        {
+            if((outcode0 | outcode1) == ClipInside)
+            {
+                accept = true;
+                break;
+            }
+            if((outcode0 & outcode1) != ClipInside)
+                break;
+
+            const auto outcode = (outcode0 != ClipInside) ? outcode0 : outcode1;
+            uint32_t edge;
+            if(outcode & ClipTop)
+                edge = ClipTop;
+            else if(outcode & ClipBottom)
+                edge = ClipBottom;
+            else if(outcode & ClipLeft)
+                edge = ClipLeft;
+            else
+                edge = ClipRight;
+
+            if(outcode == outcode0)
+            {
+                p0 = intersectClipEdge(p0, p1, area, edge);
+                outcode0 = calculateClipOutcode(p0, area);
+            }
+            else
+            {
+                p1 = intersectClipEdge(p0, p1, area, edge);
+                outcode1 = calculateClipOutcode(p1, area);
+            }
+        }
+
+        if(!accept)
+        {
+            if(polyline.size() > 1)
+                outPolylines.push_back(polyline);
+            polyline.clear();
+            continue;
+        }
+
+        if(polyline.isEmpty() || polyline.last() != p0)
+        {
+            if(polyline.size() > 1)
+                outPolylines.push_back(polyline);
+            polyline.clear();
+            polyline.push_back(p0);
+        }
+        polyline.push_back(p1);
+
+        if(isEndClipped)
+        {
+            outPolylines.push_back(polyline);
+            polyline.clear();
+        }
+    }
+    if(polyline.size() > 1)
+        outPolylines.push_back(polyline);
+}
+
+OSMAND_CORE_API void OSMAND_CORE_CALL OsmAnd::Utilities::clipPolygon( const QVector<PointI>& points, const AreaI& area, QVector<PointI>& outPoints )
+{
+    clipPolygon(points.constData(), points.size(), area, outPoints);
+}
+
+OSMAND_CORE_API void OSMAND_CORE_CALL OsmAnd::Utilities::clipPolygon( const PointI* pPoints, const int pointsCount, const AreaI& area, QVector<PointI>& outPoints )
+{
+    // Sutherland-Hodgman over open ring, one area edge at a time
+    auto inputCount = pointsCount;
+    if(inputCount > 1 && pPoints[0] == pPoints[inputCount - 1])
+        inputCount--;
+    QVector<PointI> input(qMax(inputCount, 0));
+    if(inputCount > 0)
+        std::copy(pPoints, pPoints + inputCount, input.begin());
+
+    QVector<PointI> output;
+    const uint32_t edges[] = { ClipLeft, ClipRight, ClipTop, ClipBottom };
+    for(auto edgeIdx = 0; edgeIdx < 4 && !input.isEmpty(); edgeIdx++)
+    {
+        const auto edge = edges[edgeIdx];
+
+        output.clear();
+        output.reserve(input.size() + 4);
+        auto prevPoint = input.last();
+        auto isPrevInside = (calculateClipOutcode(prevPoint, area) & edge) == 0;
+        for(auto itPoint = input.cbegin(); itPoint != input.cend(); ++itPoint)
+        {
+            const auto& point = *itPoint;
+            const auto isInside = (calculateClipOutcode(point, area) & edge) == 0;
+
+            if(isInside != isPrevInside)
+                output.push_back(intersectClipEdge(prevPoint, point, area, edge));
+            if(isInside)
+                output.push_back(point);
+
+            prevPoint = point;
+            isPrevInside = isInside;
+        }
+        input.swap(output);
+    }
+
+    outPoints.clear();
+    if(input.size() < 3)
+        return;
+    outPoints = input;
+    outPoints.push_back(input.first());
+}
+
 OSMAND_CORE_API bool OSMAND_CORE_CALL OsmAnd::Utilities::rayIntersectX( const PointF& v0_, const PointF& v1_, float mY, float& mX )
 {
     // prev node above line
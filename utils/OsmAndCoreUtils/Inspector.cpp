@@ -250,11 +250,11 @@ void printMapDetailInfo(std::ostream& output, const OsmAnd::Inspector::Configura
         {
             auto mapObject = *itMapObject;
             output << xT("\t\t") << mapObject->id << std::endl;
-            if(mapObject->names.count() > 0)
+            if(mapObject->names.size() > 0)
             {
                 output << xT("\t\t\tNames:");
-                for(auto itName = mapObject->names.begin(); itName != mapObject->names.end(); ++itName)
-                    output << QStringToStlString(itName.value()) << xT(", ");
+                for(auto itName = mapObject->names.cbegin(); itName != mapObject->names.cend(); ++itName)
+                    output << QStringToStlString(mapObject->getNameValue(*itName)) << xT(", ");
                 output << std::endl;
             }
             else